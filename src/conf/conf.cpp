@@ -1,6 +1,9 @@
 #include "conf.hpp"
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #include <pugixml.hpp>
 
@@ -8,10 +11,12 @@
     #include "../winheader.hpp"
 #endif
 
+#include "../http/tls.hpp"
 #include "../io/file_tools.hpp"
 #include "../util/string_tools.hpp"
 
 #define LOAD_UINT_FORBID_ZERO false
+#define MAX_ACCEPT_SHARDS 256
 
 /****** EXTERNAL FIELDS ******/
 
@@ -31,18 +36,26 @@ namespace conf {
     bool IS_KEEP_ALIVE_ENABLED;
     unsigned int KEEP_ALIVE_TIMEOUT;
     unsigned int MAX_KEEP_ALIVE_REQUESTS;
+    unsigned int REQUEST_HEADER_TIMEOUT, REQUEST_BODY_TIMEOUT, REQUEST_BODY_MIN_RATE;
     unsigned int MIN_COMPRESSION_SIZE;
 
     bool ENABLE_LEGACY_HTTP;
+    bool ENABLE_HTTP2;
+    unsigned int HTTP2_MAX_CONCURRENT_STREAMS;
     unsigned short MAX_REQUEST_BACKLOG;
     unsigned int MAX_REQUEST_LINE_LENGTH;
     unsigned int REQUEST_BUFFER_SIZE, RESPONSE_BUFFER_SIZE;
     unsigned int MAX_REQUEST_BODY, MAX_RESPONSE_BODY;
+    unsigned int REQUEST_BODY_MEMORY_LIMIT;
     unsigned int IDLE_THREADS_PER_CHILD, MAX_THREADS_PER_CHILD;
-    std::vector<std::unique_ptr<Match>> matchConfigs;
-    std::vector<std::string> INDEX_FILES;
-    std::vector<std::unique_ptr<Redirect>> redirectRules;
-    std::vector<std::unique_ptr<Rewrite>> rewriteRules;
+    unsigned int MAX_QUEUED_CONNECTIONS, MAX_QUEUE_WAIT, LOAD_SHED_RETRY_AFTER;
+    unsigned int RATE_LIMIT_REQUESTS_PER_SECOND, RATE_LIMIT_BURST;
+    std::unique_ptr<RateLimiter> clientRateLimiter;
+    int CONNECTION_MODE;
+    bool ENABLE_KTLS;
+    unsigned int TLS_SESSION_CACHE_SIZE, TLS_SESSION_TIMEOUT, TLS_HANDSHAKE_TIMEOUT;
+    unsigned int ACCEPT_SHARDS;
+    unsigned int UPGRADE_DRAIN_TIMEOUT;
 
     std::filesystem::path ACCESS_LOG_FILE;
     std::filesystem::path ERROR_LOG_FILE;
@@ -51,6 +64,7 @@ namespace conf {
 
     bool USE_TLS;
     port_t TLS_PORT;
+    port_t HTTP3_PORT;
 
     bool IS_PHP_ENABLED;
     #ifdef _WIN32
@@ -64,32 +78,41 @@ namespace conf {
     std::ofstream accessLogHandle;
     std::ofstream errorLogHandle;
 
-    std::unordered_map<std::string, std::string> MIMES;
-
     // CWD in root directory of repo
     std::filesystem::path CWD, previousCWD = std::filesystem::current_path();
 
+    // The published snapshot, only swapped under the mutex
+    // Readers cache it per thread & only take the lock again once the generation changes (RCU-style)
+    std::shared_ptr<const Snapshot> pSnapshot;
+    std::mutex snapshotMutex;
+    std::atomic<unsigned int> snapshotGeneration{0};
+
+    // Kept for reloads
+    std::string confFilePath;
+
     /**********************************************************/
     /********************* STATIC METHODS *********************/
     /**********************************************************/
 
     const std::vector<std::string> mercuryNodeNames = {
-        "DocumentRoot", "BindAddressIPv4", "BindAddressIPv6", "Port", "TLSPort", "Redirect", "Rewrite",
-        "AccessLogFile", "ErrorLogFile", "ClientSecurityMode", "ClientSecurityIPSalt", "EnablePHPCGI", "WinPHPCGIPath", "EnableLegacyHTTPVersions",
-        "Match", "KeepAlive", "KeepAliveMaxTimeout", "KeepAliveMaxRequests", "IndexFiles",
-        "MaxRequestLineLength", "MaxRequestBacklog", "RequestBufferSize", "ResponseBufferSize", "MaxRequestBody", "MaxResponseBody",
-        "MinResponseCompressionSize", "IdleThreadsPerChild", "MaxThreadsPerChild", "ShowWelcomeBanner", "ShowDonationBanner", "StartupCheckLatestRelease"
+        "DocumentRoot", "BindAddressIPv4", "BindAddressIPv6", "Port", "TLSPort", "HTTP3Port", "Redirect", "Rewrite",
+        "AccessLogFile", "ErrorLogFile", "ClientSecurityMode", "ClientSecurityIPSalt", "EnablePHPCGI", "WinPHPCGIPath", "EnableLegacyHTTPVersions", "EnableHTTP2", "HTTP2MaxConcurrentStreams",
+        "Match", "KeepAlive", "KeepAliveMaxTimeout", "KeepAliveMaxRequests", "RequestHeaderTimeout", "RequestBodyTimeout", "RequestBodyMinRate", "IndexFiles",
+        "MaxRequestLineLength", "MaxRequestBacklog", "RequestBufferSize", "ResponseBufferSize", "MaxRequestBody", "RequestBodyMemoryLimit", "MaxResponseBody",
+        "MinResponseCompressionSize", "IdleThreadsPerChild", "MaxThreadsPerChild", "MaxQueuedConnections", "MaxQueueWait", "LoadShedRetryAfter", "RateLimitRequestsPerSecond", "RateLimitBurst", "ConnectionMode", "EnableKTLS", "TLSSessionCacheSize", "TLSSessionTimeout", "TLSHandshakeTimeout", "AcceptShards", "UpgradeDrainTimeout", "ShowWelcomeBanner", "ShowDonationBanner", "StartupCheckLatestRelease"
     };
 
     const std::vector<std::string> matchNodeNames = {
         "FilterIfHeaderMatch", "FilterIfNotHeaderMatch", "FilterIfHeaderExist", "FilterIfNotHeaderExist",
-        "Header", "ShowDirectoryIndexes", "Access"
+        "Header", "ShowDirectoryIndexes", "Access", "RateLimit"
     };
 
     // Forward decs
     int precheckNodeNames(pugi::xml_document& doc);
 
-    int loadMIMES();
+    int loadSnapshot(const pugi::xml_node& root, Snapshot& snapshot);
+    void publishSnapshot(std::shared_ptr<const Snapshot> pNewSnapshot);
+    int loadMIMES(std::unordered_map<std::string, std::string>& mimes);
     int loadUint(const pugi::xml_node& root, unsigned int& var, const std::string& nodeName, const bool allowZero=true);
     int loadUint(const pugi::xml_node& root, unsigned short& var, const std::string& nodeName, const bool allowZero=true);
     int loadOnOff(const pugi::xml_node& root, bool& var, const std::string& nodeName);
@@ -100,6 +123,8 @@ namespace conf {
     int loadTempFileDirectory();
     int loadClientSecurityMode(const pugi::xml_node& root, int& var);
     int loadClientSecurityIPSalt(const pugi::xml_node& root, std::string& var);
+    int loadConnectionMode(const pugi::xml_node& root, int& var);
+    int loadAcceptShards(const pugi::xml_node& root, unsigned int& var);
 
     // Loads the directory of the running executable to path
     // Returns true if successful or false otherwise
@@ -129,10 +154,11 @@ namespace conf {
         std::filesystem::current_path( CWD = CWD.parent_path() );
 
         // Read XML config file
+        confFilePath = argc > 1 ? argv[1] : CONF_FILE;
         pugi::xml_document doc;
         pugi::xml_parse_result result;
         try {
-            result = doc.load_file(argc > 1 ? argv[1] : CONF_FILE);
+            result = doc.load_file(confFilePath.c_str());
             if (!result) throw 0;
         } catch (...) {
             std::cerr << "Failed to open config file." << std::endl;
@@ -192,6 +218,9 @@ namespace conf {
         if (loadOnOff(root, ENABLE_LEGACY_HTTP, "EnableLegacyHTTPVersions") == CONF_FAILURE)
             return CONF_FAILURE;
 
+        if (loadOnOff(root, ENABLE_HTTP2, "EnableHTTP2") == CONF_FAILURE)
+            return CONF_FAILURE;
+
         if (loadOnOff(root, IS_PHP_ENABLED, "EnablePHPCGI") == CONF_FAILURE)
             return CONF_FAILURE;
 
@@ -207,27 +236,6 @@ namespace conf {
         if (loadBool(root, CHECK_LATEST_RELEASE, "StartupCheckLatestRelease") == CONF_FAILURE)
             return CONF_FAILURE;
 
-        /************************** Load IndexFiles **************************/
-
-        pugi::xml_node indexFileNode = root.child("IndexFiles");
-        if (!indexFileNode) {
-            std::cerr << "Failed to parse config file, missing IndexFiles node." << std::endl;
-            return CONF_FAILURE;
-        }
-
-        // Extract index files
-        std::string indexFilesRaw( indexFileNode.text().as_string() );
-        trimString(indexFilesRaw);
-        splitString(INDEX_FILES, indexFilesRaw, ',', true);
-
-        // Validate all index files
-        for (const std::string& str : INDEX_FILES) {
-            if (str.size() == 0 || str.find('/') != std::string::npos || str.find('\\') != std::string::npos) {
-                std::cerr << "Failed to parse config file, invalid IndexFiles value." << std::endl;
-                return CONF_FAILURE;
-            }
-        }
-
         /************ LOAD UINTS/USHORTS ************/
 
         if (loadUint(root, PORT, "Port", LOAD_UINT_FORBID_ZERO) == CONF_FAILURE)
@@ -248,6 +256,9 @@ namespace conf {
         if (loadUint(root, MAX_REQUEST_BODY, "MaxRequestBody") == CONF_FAILURE)
             return CONF_FAILURE;
 
+        if (loadUint(root, REQUEST_BODY_MEMORY_LIMIT, "RequestBodyMemoryLimit") == CONF_FAILURE)
+            return CONF_FAILURE;
+
         if (loadUint(root, MAX_RESPONSE_BODY, "MaxResponseBody") == CONF_FAILURE)
             return CONF_FAILURE;
 
@@ -257,17 +268,76 @@ namespace conf {
         if (loadUint(root, MAX_THREADS_PER_CHILD, "MaxThreadsPerChild", LOAD_UINT_FORBID_ZERO) == CONF_FAILURE)
             return CONF_FAILURE;
 
+        if (loadUint(root, MAX_QUEUED_CONNECTIONS, "MaxQueuedConnections") == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, MAX_QUEUE_WAIT, "MaxQueueWait") == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, LOAD_SHED_RETRY_AFTER, "LoadShedRetryAfter") == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, RATE_LIMIT_REQUESTS_PER_SECOND, "RateLimitRequestsPerSecond") == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, RATE_LIMIT_BURST, "RateLimitBurst", LOAD_UINT_FORBID_ZERO) == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        // Only track clients when the limit is on
+        if (RATE_LIMIT_REQUESTS_PER_SECOND != 0)
+            clientRateLimiter = std::make_unique<RateLimiter>(RATE_LIMIT_REQUESTS_PER_SECOND, RATE_LIMIT_BURST);
+
+        if (loadUint(root, HTTP2_MAX_CONCURRENT_STREAMS, "HTTP2MaxConcurrentStreams", LOAD_UINT_FORBID_ZERO) == CONF_FAILURE)
+            return CONF_FAILURE;
+
         if (MAX_THREADS_PER_CHILD <= IDLE_THREADS_PER_CHILD) {
             std::cerr << "Failed to parse config file, MaxThreadsPerChild must be greater than IdleThreadsPerChild.";
             return CONF_FAILURE;
         }
 
+        if (loadConnectionMode(root, CONNECTION_MODE) == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadOnOff(root, ENABLE_KTLS, "EnableKTLS") == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        #ifndef HAS_KTLS
+            if (ENABLE_KTLS) {
+                std::cerr << "EnableKTLS is only supported on Linux w/ an OpenSSL build that supports kTLS, using userspace TLS instead." << std::endl;
+                ENABLE_KTLS = false;
+            }
+        #endif
+
+        if (loadUint(root, TLS_SESSION_CACHE_SIZE, "TLSSessionCacheSize") == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, TLS_SESSION_TIMEOUT, "TLSSessionTimeout", LOAD_UINT_FORBID_ZERO) == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, TLS_HANDSHAKE_TIMEOUT, "TLSHandshakeTimeout", LOAD_UINT_FORBID_ZERO) == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadAcceptShards(root, ACCEPT_SHARDS) == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, UPGRADE_DRAIN_TIMEOUT, "UpgradeDrainTimeout") == CONF_FAILURE)
+            return CONF_FAILURE;
+
         if (loadUint(root, KEEP_ALIVE_TIMEOUT, "KeepAliveMaxTimeout", LOAD_UINT_FORBID_ZERO) == CONF_FAILURE)
             return CONF_FAILURE;
 
         if (loadUint(root, MAX_KEEP_ALIVE_REQUESTS, "KeepAliveMaxRequests", LOAD_UINT_FORBID_ZERO) == CONF_FAILURE)
             return CONF_FAILURE;
 
+        if (loadUint(root, REQUEST_HEADER_TIMEOUT, "RequestHeaderTimeout") == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, REQUEST_BODY_TIMEOUT, "RequestBodyTimeout") == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        if (loadUint(root, REQUEST_BODY_MIN_RATE, "RequestBodyMinRate") == CONF_FAILURE)
+            return CONF_FAILURE;
+
         if (loadUint(root, MIN_COMPRESSION_SIZE, "MinResponseCompressionSize") == CONF_FAILURE)
             return CONF_FAILURE;
 
@@ -284,35 +354,14 @@ namespace conf {
                 return CONF_FAILURE;
         #endif
 
-        /************ LOAD MATCHES, REDIRECTS/REWRITES, & MIMES ************/
-
-        pugi::xml_object_range matchNodes = root.children("Match");
-        for (pugi::xml_node& match : matchNodes) {
-            // Parse match
-            std::unique_ptr<Match> pMatch = loadMatch(match);
-            if (pMatch == nullptr) return CONF_FAILURE;
-            matchConfigs.push_back( std::move(pMatch) );
-        }
-
-        pugi::xml_object_range redirectRuleNodes = root.children("Redirect");
-        for (pugi::xml_node& redirectRule : redirectRuleNodes) {
-            // Parse match
-            std::unique_ptr<Redirect> pRedirect = loadRedirect(redirectRule);
-            if (pRedirect == nullptr) return CONF_FAILURE;
-            redirectRules.push_back( std::move(pRedirect) );
-        }
-
-        pugi::xml_object_range rewriteRuleNodes = root.children("Rewrite");
-        for (pugi::xml_node& rewriteRule : rewriteRuleNodes) {
-            // Parse match
-            std::unique_ptr<Rewrite> pRewrite = loadRewrite(rewriteRule);
-            if (pRewrite == nullptr) return CONF_FAILURE;
-            rewriteRules.push_back( std::move(pRewrite) );
-        }
+        /************ LOAD INDEX FILES, MATCHES, REDIRECTS/REWRITES, & MIMES ************/
 
-        if (loadMIMES() == CONF_FAILURE)
+        std::shared_ptr<Snapshot> pNewSnapshot = std::make_shared<Snapshot>();
+        if (loadSnapshot(root, *pNewSnapshot) == CONF_FAILURE)
             return CONF_FAILURE;
 
+        publishSnapshot(std::move(pNewSnapshot));
+
         /************************** LOAD TLS **************************/
 
         pugi::xml_node tlsPortNode = root.child("TLSPort");
@@ -336,6 +385,33 @@ namespace conf {
             return CONF_FAILURE;
         }
 
+        pugi::xml_node http3PortNode = root.child("HTTP3Port");
+        if (!http3PortNode) {
+            std::cerr << "Failed to parse config file, missing HTTP3Port node." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        std::string http3PortRaw = http3PortNode.text().as_string();
+        trimString(http3PortRaw);
+
+        // If HTTP/3 is enabled, grab the port (0 when off)
+        try {
+            // Prevent negatives
+            if (http3PortRaw.size() == 0) throw std::invalid_argument("");
+            if (http3PortRaw != "off" && http3PortRaw[0] == '-') throw std::invalid_argument("");
+            HTTP3_PORT = http3PortRaw != "off" ? std::stoul(http3PortRaw) : 0;
+        } catch (std::invalid_argument&) {
+            std::cerr << "Failed to parse config file, invalid value for HTTP3Port." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        #ifndef HAS_QUIC
+            if (HTTP3_PORT != 0) {
+                std::cerr << "HTTP3Port is only supported on Linux w/ an OpenSSL 3.5+ build that supports QUIC, HTTP/3 is disabled." << std::endl;
+                HTTP3_PORT = 0;
+            }
+        #endif
+
         /************************** Open log files **************************/
 
         accessLogHandle = std::ofstream(ACCESS_LOG_FILE, std::ios_base::app);
@@ -354,7 +430,116 @@ namespace conf {
         return CONF_SUCCESS;
     }
 
-    int loadMIMES() {
+    int reloadConfig() {
+        // Read XML config file
+        pugi::xml_document doc;
+        pugi::xml_parse_result result;
+        try {
+            result = doc.load_file(confFilePath.c_str());
+            if (!result) throw 0;
+        } catch (...) {
+            std::cerr << "Failed to open config file." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        // Precheck all nodes for invalid node names
+        if (precheckNodeNames(doc) == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        // Extract root node
+        pugi::xml_node root = doc.child("Mercury");
+        if (!root) {
+            std::cerr << "Failed to parse config file, missing root \"Mercury\" node." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        // Only publish once everything has loaded, so a bad config leaves the current one in place
+        std::shared_ptr<Snapshot> pNewSnapshot = std::make_shared<Snapshot>();
+        if (loadSnapshot(root, *pNewSnapshot) == CONF_FAILURE)
+            return CONF_FAILURE;
+
+        publishSnapshot(std::move(pNewSnapshot));
+        return CONF_SUCCESS;
+    }
+
+    std::shared_ptr<const Snapshot> getSnapshot() {
+        thread_local std::shared_ptr<const Snapshot> pCached;
+        thread_local unsigned int cachedGeneration = 0;
+
+        // No lock unless a reload happened since this thread last looked
+        if (snapshotGeneration.load(std::memory_order_acquire) != cachedGeneration) {
+            std::lock_guard<std::mutex> lock(snapshotMutex);
+            pCached = pSnapshot;
+            cachedGeneration = snapshotGeneration.load(std::memory_order_relaxed);
+        }
+
+        return pCached;
+    }
+
+    // The previous snapshot is freed once the last request (or thread cache) holding it lets go
+    void publishSnapshot(std::shared_ptr<const Snapshot> pNewSnapshot) {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        pSnapshot.swap(pNewSnapshot);
+        snapshotGeneration.fetch_add(1, std::memory_order_release);
+    }
+
+    int loadSnapshot(const pugi::xml_node& root, Snapshot& snapshot) {
+        /************************** Load IndexFiles **************************/
+
+        pugi::xml_node indexFileNode = root.child("IndexFiles");
+        if (!indexFileNode) {
+            std::cerr << "Failed to parse config file, missing IndexFiles node." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        // Extract index files
+        std::string indexFilesRaw( indexFileNode.text().as_string() );
+        trimString(indexFilesRaw);
+        splitString(snapshot.INDEX_FILES, indexFilesRaw, ',', true);
+
+        // Validate all index files
+        for (const std::string& str : snapshot.INDEX_FILES) {
+            if (str.size() == 0 || str.find('/') != std::string::npos || str.find('\\') != std::string::npos) {
+                std::cerr << "Failed to parse config file, invalid IndexFiles value." << std::endl;
+                return CONF_FAILURE;
+            }
+        }
+
+        /************************** Load Matches, Redirects/Rewrites, & MIMES **************************/
+
+        pugi::xml_object_range matchNodes = root.children("Match");
+        for (pugi::xml_node& match : matchNodes) {
+            // Parse match
+            std::unique_ptr<Match> pMatch = loadMatch(match);
+            if (pMatch == nullptr) return CONF_FAILURE;
+            snapshot.matchConfigs.push_back( std::move(pMatch) );
+        }
+
+        pugi::xml_object_range redirectRuleNodes = root.children("Redirect");
+        for (pugi::xml_node& redirectRule : redirectRuleNodes) {
+            // Parse match
+            std::unique_ptr<Redirect> pRedirect = loadRedirect(redirectRule);
+            if (pRedirect == nullptr) return CONF_FAILURE;
+            snapshot.redirectRules.push_back( std::move(pRedirect) );
+        }
+
+        pugi::xml_object_range rewriteRuleNodes = root.children("Rewrite");
+        for (pugi::xml_node& rewriteRule : rewriteRuleNodes) {
+            // Parse match
+            std::unique_ptr<Rewrite> pRewrite = loadRewrite(rewriteRule);
+            if (pRewrite == nullptr) return CONF_FAILURE;
+            snapshot.rewriteRules.push_back( std::move(pRewrite) );
+        }
+
+        if (loadMIMES(snapshot.MIMES) == CONF_FAILURE) {
+            std::cerr << "Failed to open MIMES file." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        return CONF_SUCCESS;
+    }
+
+    int loadMIMES(std::unordered_map<std::string, std::string>& mimes) {
         // Load MIMES
         std::ifstream mimeHandle(MIMES_FILE);
         if (!mimeHandle.is_open()) return CONF_FAILURE;
@@ -368,7 +553,7 @@ namespace conf {
             mimeBuf = line.substr(spaceIndex+1);
             trimString(extBuf);
             trimString(mimeBuf);
-            MIMES.insert({extBuf, mimeBuf});
+            mimes.insert({extBuf, mimeBuf});
         }
 
         mimeHandle.close();
@@ -377,8 +562,9 @@ namespace conf {
     }
 
     void cleanupConfig() {
-        // Clear match configs
-        matchConfigs.clear();
+        // Release the config snapshot
+        publishSnapshot(nullptr);
+        clientRateLimiter.reset();
 
         // Remove any stray temp files
         while (!currentTempFiles.empty())
@@ -745,6 +931,76 @@ namespace conf {
         var = valueStr;
         return CONF_SUCCESS;
     }
+
+    int loadConnectionMode(const pugi::xml_node& root, int& var) {
+        pugi::xml_node node = root.child("ConnectionMode");
+        if (!node) {
+            std::cerr << "Failed to parse config file, missing ConnectionMode node." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        // Extract and stringify
+        std::string valueStr = node.text().as_string();
+        trimString(valueStr);
+
+        // Verify valid value provided
+        if (valueStr == "threaded") {
+            var = CONN_MODE_THREADED;
+        } else if (valueStr == "event") {
+            #ifdef __linux__
+                var = CONN_MODE_EVENT;
+            #else
+                // The event-driven engine is built on epoll, fall back to threaded elsewhere
+                std::cerr << "ConnectionMode \"event\" is only supported on Linux, using \"threaded\" instead." << std::endl;
+                var = CONN_MODE_THREADED;
+            #endif
+        } else {
+            std::cerr << "Failed to parse config file, invalid value for ConnectionMode." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        // Base case
+        return CONF_SUCCESS;
+    }
+
+    int loadAcceptShards(const pugi::xml_node& root, unsigned int& var) {
+        pugi::xml_node node = root.child("AcceptShards");
+        if (!node) {
+            std::cerr << "Failed to parse config file, missing AcceptShards node." << std::endl;
+            return CONF_FAILURE;
+        }
+
+        // Extract and stringify
+        std::string valueStr = node.text().as_string();
+        trimString(valueStr);
+
+        // Verify valid value provided
+        if (valueStr == "auto") {
+            var = (std::max)(std::thread::hardware_concurrency(), 1u); // One per core
+        } else {
+            try {
+                const unsigned long value = std::stoul(valueStr);
+                if (value == 0 || value > MAX_ACCEPT_SHARDS || valueStr.find_first_not_of("0123456789") != std::string::npos)
+                    throw std::invalid_argument("AcceptShards");
+                var = static_cast<unsigned int>(value);
+            } catch (std::logic_error&) {
+                std::cerr << "Failed to parse config file, invalid value for AcceptShards." << std::endl;
+                return CONF_FAILURE;
+            }
+        }
+
+        // Only Linux load balances connections between sockets bound to the same port
+        #ifndef __linux__
+            if (var > 1) {
+                std::cerr << "AcceptShards is only supported on Linux, using 1 instead." << std::endl;
+                var = 1;
+            }
+        #endif
+
+        // Base case
+        return CONF_SUCCESS;
+    }
 }
 
 #undef LOAD_UINT_FORBID_ZERO
+#undef MAX_ACCEPT_SHARDS
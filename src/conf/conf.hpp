@@ -3,6 +3,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <optional>
 #include <string>
 
@@ -19,6 +20,9 @@
 #define CLIENT_SEC_MASKED     3
 #define CLIENT_SEC_HASHED     4
 
+#define CONN_MODE_THREADED 0
+#define CONN_MODE_EVENT    1
+
 #define CONF_FILE "conf/mercury.conf"
 #define MIMES_FILE "conf/mimes.conf"
 #define VERSION_FILE "version.txt"
@@ -43,18 +47,26 @@ namespace conf {
     extern bool IS_KEEP_ALIVE_ENABLED;
     extern unsigned int KEEP_ALIVE_TIMEOUT;
     extern unsigned int MAX_KEEP_ALIVE_REQUESTS;
+    extern unsigned int REQUEST_HEADER_TIMEOUT, REQUEST_BODY_TIMEOUT, REQUEST_BODY_MIN_RATE;
     extern unsigned int MIN_COMPRESSION_SIZE;
 
     extern bool ENABLE_LEGACY_HTTP;
+    extern bool ENABLE_HTTP2;
+    extern unsigned int HTTP2_MAX_CONCURRENT_STREAMS;
     extern unsigned short MAX_REQUEST_BACKLOG;
     extern unsigned int MAX_REQUEST_LINE_LENGTH;
     extern unsigned int REQUEST_BUFFER_SIZE, RESPONSE_BUFFER_SIZE;
     extern unsigned int MAX_REQUEST_BODY, MAX_RESPONSE_BODY;
+    extern unsigned int REQUEST_BODY_MEMORY_LIMIT;
     extern unsigned int IDLE_THREADS_PER_CHILD, MAX_THREADS_PER_CHILD;
-    extern std::vector<std::unique_ptr<Match>> matchConfigs;
-    extern std::vector<std::string> INDEX_FILES;
-    extern std::vector<std::unique_ptr<Redirect>> redirectRules;
-    extern std::vector<std::unique_ptr<Rewrite>> rewriteRules;
+    extern unsigned int MAX_QUEUED_CONNECTIONS, MAX_QUEUE_WAIT, LOAD_SHED_RETRY_AFTER;
+    extern unsigned int RATE_LIMIT_REQUESTS_PER_SECOND, RATE_LIMIT_BURST;
+    extern std::unique_ptr<RateLimiter> clientRateLimiter; // nullptr if RateLimitRequestsPerSecond is 0
+    extern int CONNECTION_MODE;
+    extern bool ENABLE_KTLS;
+    extern unsigned int TLS_SESSION_CACHE_SIZE, TLS_SESSION_TIMEOUT, TLS_HANDSHAKE_TIMEOUT;
+    extern unsigned int ACCEPT_SHARDS;
+    extern unsigned int UPGRADE_DRAIN_TIMEOUT;
 
     extern std::filesystem::path ACCESS_LOG_FILE;
     extern std::filesystem::path ERROR_LOG_FILE;
@@ -63,6 +75,7 @@ namespace conf {
 
     extern bool USE_TLS;
     extern port_t TLS_PORT;
+    extern port_t HTTP3_PORT; // 0 if HTTP/3 is off
 
     extern bool IS_PHP_ENABLED;
     #ifdef _WIN32
@@ -75,12 +88,25 @@ namespace conf {
 
     extern std::ofstream accessLogHandle;
     extern std::ofstream errorLogHandle;
-    
-    extern std::unordered_map<std::string, std::string> MIMES;
+
     extern std::filesystem::path CWD;
 
+    // Options that can be reloaded w/out a restart (w/ the reload command or SIGHUP)
+    // A snapshot is never modified once published, so requests keep the one they started w/
+    struct Snapshot {
+        std::vector<std::unique_ptr<Match>> matchConfigs;
+        std::vector<std::string> INDEX_FILES;
+        std::vector<std::unique_ptr<Redirect>> redirectRules;
+        std::vector<std::unique_ptr<Rewrite>> rewriteRules;
+        std::unordered_map<std::string, std::string> MIMES;
+    };
+
+    // Returns the latest snapshot, only locks once per thread after each reload
+    std::shared_ptr<const Snapshot> getSnapshot();
+
     // Static methods
     int loadConfig(int argc, char* argv[]);
+    int reloadConfig();
     void cleanupConfig();
     bool isVersionOutdated(const std::string& latestRemoteVersion);
 }
@@ -105,6 +105,28 @@ namespace conf {
             pMatch->setAccessControl( std::unique_ptr<Access>(new Access("allow all")) );
         }
 
+        /***************************** Extract RateLimit node *****************************/
+        pugi::xml_node rateLimitNode = root.child("RateLimit");
+
+        if (rateLimitNode) {
+            // Both attributes are required & must be positive
+            pugi::xml_attribute rateAttr = rateLimitNode.attribute("requestsPerSecond");
+            pugi::xml_attribute burstAttr = rateLimitNode.attribute("burst");
+            if (!rateAttr || !burstAttr) {
+                std::cerr << "Failed to parse config file, RateLimit node missing requestsPerSecond or burst attribute." << std::endl;
+                return nullptr;
+            }
+
+            const unsigned int rate = rateAttr.as_uint();
+            const unsigned int burst = burstAttr.as_uint();
+            if (rate == 0 || burst == 0) {
+                std::cerr << "Failed to parse config file, RateLimit node requestsPerSecond & burst must be greater than 0." << std::endl;
+                return nullptr;
+            }
+
+            pMatch->setRateLimiter(std::make_unique<RateLimiter>(rate, burst));
+        }
+
         /***************************** Extract Match Modifier Header Nodes *****************************/
 
         auto loadHeaderFilters = [&](const char* nodeName) {
@@ -10,6 +10,7 @@
 
 #include "access.hpp"
 #include "mod_headers.hpp"
+#include "../util/rate_limiter.hpp"
 
 namespace conf {
 
@@ -22,6 +23,8 @@ namespace conf {
             inline void setShowDirectoryIndexes(const bool b) { _showDirectoryIndexes = b; }
             inline void setAccessControl(std::unique_ptr<Access> pAccess) { this->pAccess = std::move(pAccess); }
             inline const std::unique_ptr<Access>& getAccessControl() const { return pAccess; };
+            inline void setRateLimiter(std::unique_ptr<RateLimiter> pRateLimiter) { this->pRateLimiter = std::move(pRateLimiter); }
+            inline const std::unique_ptr<RateLimiter>& getRateLimiter() const { return pRateLimiter; }; // nullptr if there's no RateLimit node
 
             bool doesRequestMatch(const std::string& decodedURI, const http::headers_map_t& headers) const;
             void addHeaderFilter(std::unique_ptr<IModHeader> p) { headerFilters.push_back(std::move(p)); };
@@ -30,6 +33,7 @@ namespace conf {
             std::unordered_map<std::string, std::string> headers;
             bool _showDirectoryIndexes;
             std::unique_ptr<Access> pAccess;
+            std::unique_ptr<RateLimiter> pRateLimiter;
             std::vector<std::unique_ptr<IModHeader>> headerFilters;
     };
 
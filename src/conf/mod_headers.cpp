@@ -11,13 +11,15 @@ namespace conf {
     }
 
     bool ModIfHeaderMatch::doesRequestFitCondition(const http::headers_map_t& headers) const {
-        if (!headers.contains(name)) return false;
-        return std::regex_match(headers.at(name), pattern);
+        const std::optional<std::string_view> value = headers.get(name);
+        if (!value.has_value()) return false;
+        return std::regex_match(value->begin(), value->end(), pattern);
     }
 
     bool ModIfNotHeaderMatch::doesRequestFitCondition(const http::headers_map_t& headers) const {
-        if (!headers.contains(name)) return false;
-        return !std::regex_match(headers.at(name), pattern);
+        const std::optional<std::string_view> value = headers.get(name);
+        if (!value.has_value()) return false;
+        return !std::regex_match(value->begin(), value->end(), pattern);
     }
 
     std::unique_ptr<IModHeader> loadModIfHeader(pugi::xml_node& node) {
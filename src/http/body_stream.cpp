@@ -8,6 +8,11 @@
 #include "../util/string_tools.hpp"
 #include "../io/file_tools.hpp"
 
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
 namespace http {
 
     // Adds a new byte range
@@ -60,6 +65,10 @@ namespace http {
     FileStream::~FileStream() {
         handle.close();
 
+        #ifdef __linux__
+            if (this->fd != -1) close(this->fd);
+        #endif
+
         // Remove if needed (for temp files)
         if (isTempFile) removeTempFile(path);
     }
@@ -76,21 +85,48 @@ namespace http {
     }
 
     size_t FileStream::read(char* buffer, size_t maxBytes) {
+        const size_t toRead = this->nextChunkSize(maxBytes);
+        if (toRead == 0) return 0;
+
+        return this->readHandle(buffer, toRead);
+    }
+
+    #ifdef __linux__
+        ssize_t FileStream::sendFile(const std::function<ssize_t(const int, const size_t, const size_t)>& sendFileFunc, size_t maxBytes) {
+            // Switch from the ifstream to a raw fd, keeping the read position
+            if (this->fd == -1) {
+                if ((this->fd = open(path.c_str(), O_RDONLY | O_CLOEXEC)) < 0) return -1;
+
+                const std::streamoff pos = handle.tellg();
+                this->offset = pos == -1 ? 0 : static_cast<size_t>(pos);
+                handle.close();
+            }
+
+            const size_t toSend = this->nextChunkSize(maxBytes);
+            if (toSend == 0) return 0;
+
+            const ssize_t bytesSent = sendFileFunc(this->fd, this->offset, toSend);
+            if (bytesSent <= 0) return -1;
+            this->offset += static_cast<size_t>(bytesSent);
+            return bytesSent;
+        }
+    #endif
+
+    // Aligns the read position to the current byte range & returns how many bytes can be read from it, or 0 if done
+    size_t FileStream::nextChunkSize(size_t maxBytes) {
         // Handle byte ranges
         while (byteRangeIndex < byteRanges.size() && !byteRanges.empty()) {
             byte_range_t& front = byteRanges[byteRangeIndex];
 
             // Pop file pointer if past range
-            if (handle.tellg() != -1 && static_cast<size_t>(handle.tellg()) > front.second) {
+            if (this->tell() != -1 && static_cast<size_t>(this->tell()) > front.second) {
                 ++byteRangeIndex;
                 return 0;
             }
 
             // Align file pointer to range start, if needed
-            if (handle.tellg() != -1 && static_cast<size_t>(handle.tellg()) < front.first) {
-                handle.clear(); // Clear any EOFs
-                handle.seekg(static_cast<std::streamoff>(front.first), std::ios::beg);
-            }
+            if (this->tell() != -1 && static_cast<size_t>(this->tell()) < front.first)
+                this->seek(front.first);
 
             break;
         }
@@ -102,17 +138,47 @@ namespace http {
         size_t remaining;
         if (byteRangeIndex < byteRanges.size() && !byteRanges.empty()) {
             byte_range_t& front = byteRanges[byteRangeIndex];
-            std::streamoff currentPos = handle.tellg();
+            std::streamoff currentPos = this->tell();
             if (currentPos == -1) return 0; // Internal error
             remaining = front.second - static_cast<size_t>(currentPos) + 1;
         } else {
-            remaining = originalSize - static_cast<size_t>(handle.tellg());
+            remaining = originalSize - static_cast<size_t>(this->tell());
         }
 
-        size_t toRead = (std::min)(remaining, maxBytes);
-        if (toRead == 0) return 0;
+        return (std::min)(remaining, maxBytes);
+    }
+
+    std::streamoff FileStream::tell() {
+        #ifdef __linux__
+            if (this->fd != -1) return static_cast<std::streamoff>(this->offset);
+        #endif
+
+        return handle.tellg();
+    }
+
+    void FileStream::seek(const size_t pos) {
+        #ifdef __linux__
+            if (this->fd != -1) {
+                this->offset = pos;
+                return;
+            }
+        #endif
+
+        handle.clear(); // Clear any EOFs
+        handle.seekg(static_cast<std::streamoff>(pos), std::ios::beg);
+    }
+
+    size_t FileStream::readHandle(char* buffer, size_t n) {
+        #ifdef __linux__
+            if (this->fd != -1) {
+                const ssize_t bytesRead = pread(this->fd, buffer, n, static_cast<off_t>(this->offset));
+                if (bytesRead <= 0) return 0; // IO failure or EOF
+                this->offset += static_cast<size_t>(bytesRead);
+                return static_cast<size_t>(bytesRead);
+            }
+        #endif
 
-        handle.read(buffer, toRead);
+        handle.read(buffer, n);
         return static_cast<size_t>(handle.gcount());
     }
 
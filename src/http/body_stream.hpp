@@ -2,6 +2,7 @@
 #define __HTTP_BODY_STREAM_HPP
 
 #include <fstream>
+#include <functional>
 #include <queue>
 #include <string>
 #include <vector>
@@ -51,9 +52,29 @@ namespace http {
             size_t read(char* buffer, size_t maxBytes);
             size_t size() const;
             inline bool isPrecompressed() const { return isTempFile; };
+
+            #ifdef __linux__
+                // Sends up to maxBytes of the current byte range (or file) through sendFileFunc straight from the fd,
+                // without copying to userspace. Returns the number of bytes sent, 0 once done, or < 0 on failure
+                ssize_t sendFile(const std::function<ssize_t(const int, const size_t, const size_t)>& sendFileFunc, size_t maxBytes);
+            #endif
         private:
+            size_t nextChunkSize(size_t maxBytes);
+
+            // Read position helpers, dispatching to either the fd or the ifstream handle
+            std::streamoff tell();
+            void seek(const size_t);
+            size_t readHandle(char* buffer, size_t n);
+
             bool isTempFile = false;
             std::ifstream handle;
+
+            #ifdef __linux__
+                // Used instead of handle once sendFile is called
+                int fd = -1;
+                size_t offset = 0;
+            #endif
+
             size_t originalSize;
             const std::string path;
     };
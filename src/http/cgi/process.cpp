@@ -10,6 +10,7 @@
     #include <unistd.h>
 #endif
 
+#include <cerrno>
 #include <cstring>
 #include <map>
 #include <optional>
@@ -18,8 +19,11 @@
 #include "../../logs/logger.hpp"
 #include "../../io/file_tools.hpp"
 #include "../../util/string_tools.hpp"
+#include "../../util/thread_pool.hpp"
 #include "../../util/toolbox.hpp"
 
+#define CGI_PIPE_CHUNK_SIZE 16384 // Request body bytes read per write to the CGI's stdin
+
 // Platform specifics
 namespace http::cgi {
 
@@ -71,11 +75,11 @@ namespace http::cgi {
         // Collect all envs
         std::map<std::string, std::string, std::less<>> envsMap;
 
-        const std::optional<std::string> authHeader = req.getHeader("Authorization");
+        const std::optional<std::string_view> authHeader = req.getHeader("Authorization");
         if (authHeader.has_value()) {
             const size_t authSpaceInd = authHeader->find(' ');
             envsMap["AUTH_TYPE"] = authHeader->substr(0, authSpaceInd);
-            envsMap["REMOTE_USER"] = authSpaceInd == std::string::npos ?
+            envsMap["REMOTE_USER"] = authSpaceInd == std::string_view::npos ?
                 "" : authHeader->substr(authSpaceInd+1);
         } else {
             envsMap["AUTH_TYPE"] = envsMap["REMOTE_USER"] = "";
@@ -85,7 +89,7 @@ namespace http::cgi {
         if (contentLen > 0) {
             envsMap["CONTENT_LENGTH"] = std::to_string(contentLen);
 
-            const std::optional<std::string> contentTypeHeader = req.getHeader("Content-Type");
+            const std::optional<std::string_view> contentTypeHeader = req.getHeader("Content-Type");
             if (contentTypeHeader.has_value())
                 envsMap["CONTENT_TYPE"] = *contentTypeHeader;
         }
@@ -104,7 +108,7 @@ namespace http::cgi {
         envsMap["SCRIPT_FILENAME"] = file.absoluteResourcePath;
         envsMap["SCRIPT_NAME"] = file.decodedURIWithoutPathInfo; // File.decodedURIWithoutPathInfo ignores query string
 
-        const std::optional<std::string> hostHeader = req.getHeader("Host");
+        const std::optional<std::string_view> hostHeader = req.getHeader(HEADER_HOST);
         envsMap["SERVER_NAME"] = hostHeader.has_value() ? *hostHeader : "";
         envsMap["SERVER_PORT"] = std::to_string( req.usesHTTPS() ? conf::TLS_PORT : conf::PORT );
         envsMap["SERVER_PROTOCOL"] = req.getVersion();
@@ -116,12 +120,13 @@ namespace http::cgi {
 
         // Filter through headers
         for (auto& [key, val] : req.getHeaders()) {
-            std::string cgiKey = "HTTP_" + key; 
+            std::string cgiKey = std::string("HTTP_").append(key);
             for (char& c : cgiKey) if (c == '-') c = '_';
             strToUpper(cgiKey);
 
-            // Ignore Authorization header (already passed)
-            if (cgiKey != "HTTP_AUTHORIZATION" && cgiKey != "HTTP_CONTENT_LENGTH" && cgiKey != "HTTP_CONTENT_TYPE")
+            // Ignore Authorization header (already passed), & Transfer-Encoding since the body is passed decoded
+            if (cgiKey != "HTTP_AUTHORIZATION" && cgiKey != "HTTP_CONTENT_LENGTH" && cgiKey != "HTTP_CONTENT_TYPE" &&
+                cgiKey != "HTTP_TRANSFER_ENCODING")
                 envsMap[cgiKey] = val;
         }
 
@@ -289,10 +294,10 @@ namespace http::cgi {
     /************************************************************************/
 
     #ifdef _WIN32 // Windows piping functions
-        // Writes string to handle
-        bool writeToPipe(HANDLE hPipe, const std::string& data) {
+        // Writes a chunk of the body to handle
+        bool writeToPipe(HANDLE hPipe, const char* data, const size_t size) {
             DWORD written = 0;
-            return WriteFile(hPipe, data.c_str(), (DWORD)data.size(), &written, NULL) && written == data.size();
+            return WriteFile(hPipe, data, (DWORD)size, &written, NULL) && written == size;
         }
 
         // Reads everything from a pipe until EOF
@@ -404,9 +409,12 @@ namespace http::cgi {
         }
 
         // Sends the string of text (from loadCGIRequestToString) to the CGI
-        void Process::send(const std::string& input, std::ofstream& tmpHandle) {
-            // Write request body to stdin
-            writeToPipe(stdinWrite, input);
+        void Process::send(const RequestBody& input, std::ofstream& tmpHandle) {
+            // Write request body to stdin, a chunk at a time since it may be spilled to disk
+            char buffer[CGI_PIPE_CHUNK_SIZE];
+            size_t offset = 0, bytesRead;
+            while ((bytesRead = input.read(offset, buffer, sizeof(buffer))) > 0 && writeToPipe(stdinWrite, buffer, bytesRead))
+                offset += bytesRead;
 
             // Close write end to send EOF to CGI
             CloseHandle(stdinWrite);
@@ -420,19 +428,6 @@ namespace http::cgi {
             stdoutRead = NULL;
         }
     #else // Linux piping functions
-        // Writes string to fd
-        static bool writeToPipe(int fd, const std::string& data) {
-            ssize_t written = 0, total = 0;
-
-            while (total < (ssize_t)data.size()) {
-                written = ::write(fd, data.data() + total, data.size() - total);
-                if (written <= 0) return false;
-                total += written;
-            }
-
-            return true;
-        }
-
         // Reads until EOF from fd
         static void readFromPipe(int fd, std::ofstream& tmpHandle) {
             char buffer[4096];
@@ -489,6 +484,11 @@ namespace http::cgi {
                 close(stdinRead); close(stdoutWrite); close(stdinWrite); close(stdoutRead);
                 close(stderrPipe[0]); close(stderrPipe[1]);
 
+                // Undo the forking worker's shard pinning, so PHP isn't stuck on its cores
+                #ifdef __linux__
+                    resetCPUAffinity();
+                #endif
+
                 // Prepare argv
                 const char* phpCgiPath = "php-cgi"; // Resolved from PATH
                 char* const argv[] = { (char*)phpCgiPath, nullptr };
@@ -572,13 +572,56 @@ namespace http::cgi {
         }
 
         // Send input and read response
-        void Process::send(const std::string& input, std::ofstream& tmpHandle) {
-            writeToPipe(stdinWrite, input);
-            close(stdinWrite); stdinWrite = -1;
+        // stdin is fed a chunk at a time while stdout is drained, so the body never has to be in memory all at once and
+        // a CGI that starts replying before it's read all of its input can't leave both sides blocked on a full pipe
+        void Process::send(const RequestBody& input, std::ofstream& tmpHandle) {
+            char inBuffer[CGI_PIPE_CHUNK_SIZE], outBuffer[4096];
+            size_t inOffset = 0, inSize = 0, bodyOffset = 0;
+
+            const int flags = fcntl(stdinWrite, F_GETFL, 0);
+            if (flags >= 0) fcntl(stdinWrite, F_SETFL, flags | O_NONBLOCK);
+
+            while (stdoutRead >= 0) {
+                // Refill from the body, closing stdin (EOF for the CGI) once all of it is sent
+                if (stdinWrite >= 0 && inOffset == inSize) {
+                    inSize = input.read(bodyOffset, inBuffer, sizeof(inBuffer));
+                    bodyOffset += inSize;
+                    inOffset = 0;
+                    if (inSize == 0) { close(stdinWrite); stdinWrite = -1; }
+                }
 
-            // Read to tmp file
-            readFromPipe(stdoutRead, tmpHandle);
-            close(stdoutRead); stdoutRead = -1;
+                // Closed fds (-1) are ignored by poll
+                struct pollfd pfds[2] = {
+                    { .fd = stdoutRead, .events = POLLIN, .revents = 0 },
+                    { .fd = stdinWrite, .events = POLLOUT, .revents = 0 }
+                };
+                if (poll(pfds, 2, -1) < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+
+                if (pfds[1].revents) {
+                    const ssize_t written = ::write(stdinWrite, inBuffer + inOffset, inSize - inOffset);
+                    if (written > 0) {
+                        inOffset += written;
+                    } else if (errno != EAGAIN && errno != EWOULDBLOCK) { // ie. the CGI exited w/out reading all of it
+                        close(stdinWrite); stdinWrite = -1;
+                    }
+                }
+
+                // Read to tmp file
+                if (pfds[0].revents) {
+                    const ssize_t bytesRead = ::read(stdoutRead, outBuffer, sizeof(outBuffer));
+                    if (bytesRead > 0) {
+                        tmpHandle.write(outBuffer, bytesRead);
+                    } else if (bytesRead == 0 || errno != EINTR) {
+                        close(stdoutRead); stdoutRead = -1;
+                    }
+                }
+            }
+
+            if (stdinWrite >= 0) { close(stdinWrite); stdinWrite = -1; }
+            if (stdoutRead >= 0) { close(stdoutRead); stdoutRead = -1; }
 
             // Concat stderr to stdout
             readFromPipe(stderrRead, tmpHandle);
@@ -617,4 +660,6 @@ namespace http::cgi {
         closeProcess(); // Close process
     }
 
-}
\ No newline at end of file
+}
+
+#undef CGI_PIPE_CHUNK_SIZE
@@ -25,7 +25,7 @@ namespace http::cgi {
             Process(env_block_t& envBlock);
             ~Process();
 
-            void send(const std::string& input, std::ofstream& tmpHandle);
+            void send(const RequestBody& input, std::ofstream& tmpHandle);
             bool hasSucceeded() const { return isSuccess; };
         private:
             bool createPipes(); // Creates the pipes for the worker
@@ -0,0 +1,152 @@
+#include "chunked_decoder.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#define CHUNK_LINE_MAX_LENGTH 4096 // Longest chunk-size or trailer line, extensions included
+#define CHUNK_TRAILERS_MAX_SIZE 16384 // Combined length of every trailer line
+
+namespace http {
+
+    int ChunkedDecoder::decode(const char* data, const size_t size, RequestBody& body, size_t& consumed) {
+        size_t offset = 0;
+        while (offset < size && state != STATE_DONE && state != STATE_INVALID) {
+            switch (state) {
+                case STATE_SIZE: {
+                    if (!this->readLine(data, size, offset)) break;
+                    if (!this->parseSizeLine()) {
+                        state = STATE_INVALID;
+                        break;
+                    }
+                    line.clear();
+
+                    // Reject the body as soon as a chunk would take it past the limit, instead of waiting for its data
+                    if (chunkRemaining > maxRequestBody - decodedSize) {
+                        _isTooLarge = true;
+                        body.clear();
+                        state = STATE_DONE;
+                    } else {
+                        state = chunkRemaining == 0 ? STATE_TRAILERS : STATE_DATA;
+                    }
+                    break;
+                }
+                case STATE_DATA: {
+                    const size_t n = (std::min)(chunkRemaining, size - offset);
+                    if (!body.append(data + offset, n)) { // ie. the body couldn't be spilled to disk
+                        state = STATE_INVALID;
+                        break;
+                    }
+
+                    offset += n;
+                    chunkRemaining -= n;
+                    decodedSize += n;
+                    if (chunkRemaining == 0) state = STATE_DATA_CRLF;
+                    break;
+                }
+                case STATE_DATA_CRLF: {
+                    // Anything but CRLF is invalid, no need to wait for an LF
+                    const bool isLineRead = this->readLine(data, size, offset);
+                    if (isLineRead ? !line.empty() : (line.size() > 1 || (line.size() == 1 && line[0] != '\r'))) {
+                        state = STATE_INVALID;
+                    } else if (isLineRead) {
+                        state = STATE_SIZE;
+                    }
+                    break;
+                }
+                case STATE_TRAILERS: {
+                    if (!this->readLine(data, size, offset)) break;
+
+                    // Blank line, end of the trailers
+                    if (line.empty()) {
+                        state = STATE_DONE;
+                        break;
+                    }
+
+                    trailersSize += line.size();
+                    if (trailersSize > CHUNK_TRAILERS_MAX_SIZE) {
+                        state = STATE_INVALID;
+                        break;
+                    }
+
+                    this->parseTrailerLine(body);
+                    line.clear();
+                    break;
+                }
+                default: break;
+            }
+        }
+
+        consumed = offset;
+        if (state == STATE_INVALID) return REQUEST_INVALID;
+        return state == STATE_DONE ? REQUEST_READY : REQUEST_INCOMPLETE;
+    }
+
+    void ChunkedDecoder::reset() {
+        state = STATE_SIZE;
+        std::string().swap(line);
+        chunkRemaining = decodedSize = trailersSize = 0;
+        _isTooLarge = false;
+    }
+
+    // Appends data up to the next LF to line, returns true once the whole line is received (w/ its CRLF stripped)
+    bool ChunkedDecoder::readLine(const char* data, const size_t size, size_t& offset) {
+        const char* pStart = data + offset;
+        const char* pLF = static_cast<const char*>(std::memchr(pStart, '\n', size - offset));
+        const size_t n = (pLF == nullptr ? data + size : pLF) - pStart;
+
+        if (line.size() + n > CHUNK_LINE_MAX_LENGTH) {
+            state = STATE_INVALID;
+            return false;
+        }
+
+        line.append(pStart, n);
+        offset += n;
+        if (pLF == nullptr) return false;
+        ++offset; // Skip the LF
+
+        // Lines must be CRLF-terminated
+        if (line.empty() || line.back() != '\r') {
+            state = STATE_INVALID;
+            return false;
+        }
+
+        line.pop_back();
+        return true;
+    }
+
+    // Reads the hex chunk-size from line, returns false if it's malformed
+    // Chunk extensions are ignored
+    bool ChunkedDecoder::parseSizeLine() {
+        const size_t sizeEnd = (std::min)(line.find_first_not_of("0123456789abcdefABCDEF"), line.size());
+        if (sizeEnd == 0) return false;
+
+        // Only whitespace & a chunk extension may follow the size
+        if (sizeEnd < line.size()) {
+            const size_t extStart = line.find_first_not_of(" \t", sizeEnd);
+            if (extStart == std::string::npos || line[extStart] != ';') return false;
+        }
+
+        // Sizes too large to fit are rejected as out of range
+        const auto [pEnd, ec] = std::from_chars(line.data(), line.data() + sizeEnd, chunkRemaining, 16);
+        return ec == std::errc() && pEnd == line.data() + sizeEnd;
+    }
+
+    // Records a single "Key: Value" trailer line, lines without a colon are ignored
+    void ChunkedDecoder::parseTrailerLine(RequestBody& body) const {
+        const std::string_view fieldLine(line);
+        const size_t delimIndex = fieldLine.find(':');
+        if (delimIndex == 0 || delimIndex == std::string_view::npos) return;
+
+        std::string_view value = fieldLine.substr(delimIndex + 1);
+        const size_t start = value.find_first_not_of(" \t");
+        value = start == std::string_view::npos ? std::string_view() : value.substr(start, value.find_last_not_of(" \t") - start + 1);
+
+        body.addTrailer(std::string(fieldLine.substr(0, delimIndex)), std::string(value));
+    }
+
+}
+
+#undef CHUNK_LINE_MAX_LENGTH
+#undef CHUNK_TRAILERS_MAX_SIZE
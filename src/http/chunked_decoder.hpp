@@ -0,0 +1,54 @@
+#ifndef __HTTP_CHUNKED_DECODER_HPP
+#define __HTTP_CHUNKED_DECODER_HPP
+
+#include <string>
+
+#include "request_body.hpp"
+#include "request_parser.hpp"
+
+namespace http {
+
+    // Resumable decoder for "Transfer-Encoding: chunked" request bodies (RFC 9112 7.1)
+    // Decoded bytes go straight to a RequestBody as they arrive, so it's stored the same as a Content-Length body
+    class ChunkedDecoder {
+        public:
+            explicit ChunkedDecoder(const size_t maxRequestBody) : maxRequestBody(maxRequestBody) {};
+
+            // Decodes as much of data as belongs to the body, setting consumed to the number of bytes used
+            // Returns REQUEST_READY once the last chunk & trailers are received (anything past consumed is the next request),
+            // REQUEST_INCOMPLETE if more data is needed, or REQUEST_INVALID if the framing is malformed or the body couldn't be stored
+            // Bodies larger than MaxRequestBody are cut short as REQUEST_READY, w/ isTooLarge set
+            int decode(const char* data, const size_t size, RequestBody& body, size_t& consumed);
+
+            // Prepares to decode the next request's body
+            void reset();
+
+            inline bool isDone() const { return state == STATE_DONE; };
+            inline bool isTooLarge() const { return _isTooLarge; };
+        private:
+            enum STATE {
+                STATE_SIZE = 0, // chunk-size [ chunk-ext ] CRLF
+                STATE_DATA = 1,
+                STATE_DATA_CRLF = 2, // CRLF after each chunk's data
+                STATE_TRAILERS = 3,
+                STATE_DONE = 4,
+                STATE_INVALID = 5
+            };
+
+            bool readLine(const char* data, const size_t size, size_t& offset);
+            bool parseSizeLine();
+            void parseTrailerLine(RequestBody& body) const;
+
+            const size_t maxRequestBody;
+
+            STATE state = STATE_SIZE;
+            std::string line; // The size/trailer line being received, w/o its CRLF once complete
+            size_t chunkRemaining = 0;
+            size_t decodedSize = 0;
+            size_t trailersSize = 0;
+            bool _isTooLarge = false;
+    };
+
+}
+
+#endif
@@ -0,0 +1,46 @@
+#include "connection.hpp"
+
+#include <algorithm>
+
+namespace http {
+
+    // Splits bytes past the headers between the body & the next pipelined request
+    // Returns false if the body couldn't be stored, or its chunked framing is malformed
+    static bool appendBody(Connection& conn, const char* data, const size_t size) {
+        if (conn.parser.isChunked()) {
+            size_t bodySize = 0;
+            if (!conn.chunkedDecoder.isDone() && conn.chunkedDecoder.decode(data, size, conn.body, bodySize) == REQUEST_INVALID)
+                return false;
+            conn.requestTimer.addBodyBytes(bodySize);
+
+            // The rest of an oversized body is left unread, since the connection is closed after the 413
+            if (conn.chunkedDecoder.isTooLarge()) conn.reqFlags.isContentTooLarge = true;
+            conn.pipelined.append(data + bodySize, size - bodySize);
+            return true;
+        }
+
+        const size_t bodySize = (std::min)(size, conn.parser.getContentLength() - conn.body.size());
+        conn.pipelined.append(data + bodySize, size - bodySize);
+        conn.requestTimer.addBodyBytes(bodySize);
+        return conn.body.append(data, bodySize);
+    }
+
+    bool Connection::receive(const char* data, const size_t size) {
+        if (!parser.hasHeaders()) {
+            buffer.append(data, size);
+            return true;
+        }
+
+        return appendBody(*this, data, size);
+    }
+
+    bool Connection::loadBody() {
+        const size_t headersEnd = parser.getHeadersEnd();
+        if (headersEnd == std::string::npos || buffer.size() <= headersEnd) return true;
+
+        const bool isStored = appendBody(*this, buffer.data() + headersEnd, buffer.size() - headersEnd);
+        buffer.resize(headersEnd);
+        return isStored;
+    }
+
+}
@@ -0,0 +1,161 @@
+#ifndef __HTTP_CONNECTION_HPP
+#define __HTTP_CONNECTION_HPP
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <openssl/ssl.h>
+
+#include "chunked_decoder.hpp"
+#include "request_body.hpp"
+#include "request_parser.hpp"
+#include "response.hpp"
+#include "http2/session.hpp"
+#include "tools.hpp"
+#include "../conf/conf.hpp"
+
+namespace http {
+
+    typedef std::chrono::steady_clock::time_point conn_time_t;
+
+    // Deadline for receiving the current request, so a client trickling bytes can't hold a connection forever
+    // The request line & headers get RequestHeaderTimeout from their first byte, then the body gets RequestBodyTimeout
+    // plus a second for every RequestBodyMinRate bytes received
+    class RequestTimer {
+        public:
+            // Starts the header deadline, unless it's already running
+            inline void startHeaders() {
+                if (phase != PHASE_IDLE) return;
+                phase = PHASE_HEADERS;
+                deadline = std::chrono::steady_clock::now() + std::chrono::seconds(conf::REQUEST_HEADER_TIMEOUT);
+            };
+
+            // Swaps the header deadline for the body's, once the headers are in
+            inline void startBody() {
+                if (phase == PHASE_BODY) return;
+                phase = PHASE_BODY;
+                deadline = std::chrono::steady_clock::now() + std::chrono::seconds(conf::REQUEST_BODY_TIMEOUT);
+            };
+
+            // Pushes the body deadline back for the newly received bytes
+            inline void addBodyBytes(const size_t n) {
+                if (phase != PHASE_BODY || conf::REQUEST_BODY_MIN_RATE == 0) return;
+                deadline += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(static_cast<double>(n) / conf::REQUEST_BODY_MIN_RATE));
+            };
+
+            inline void reset() { phase = PHASE_IDLE; };
+
+            // A timeout of 0 turns that phase's deadline off
+            inline bool isRunning() const {
+                return (phase == PHASE_HEADERS && conf::REQUEST_HEADER_TIMEOUT != 0) || (phase == PHASE_BODY && conf::REQUEST_BODY_TIMEOUT != 0);
+            };
+            inline bool hasExpired(const conn_time_t now) const { return this->isRunning() && now >= deadline; };
+            inline conn_time_t getDeadline() const { return deadline; };
+        private:
+            enum PHASE { PHASE_IDLE, PHASE_HEADERS, PHASE_BODY };
+
+            PHASE phase = PHASE_IDLE;
+            conn_time_t deadline;
+    };
+
+    // Per-connection state shared by the threaded and event-driven request loops
+    class Connection {
+        public:
+            Connection(const int sock, SSL* pSSL, const std::string& clientIP, const int keepAliveReqsLeft)
+                : sock(sock), pSSL(pSSL), clientIP(clientIP), parser(conf::MAX_REQUEST_LINE_LENGTH, conf::MAX_REQUEST_BODY),
+                chunkedDecoder(conf::MAX_REQUEST_BODY), keepAliveReqsLeft(keepAliveReqsLeft),
+                lastActivity(std::chrono::steady_clock::now()) {};
+
+            // Clears the buffered request and its framing info before reading the next request
+            // Any pipelined bytes received after the previous request become the start of the next one
+            inline void resetRequest() {
+                buffer = std::move(pipelined);
+                pipelined.clear();
+                body.clear();
+                headers.clear();
+                parser.reset();
+                chunkedDecoder.reset();
+                reqFlags = RequestFlags();
+                requestTimer.reset();
+                isExpectationAnswered = false;
+                pRejection.reset();
+                pConfig.reset();
+            };
+
+            // Appends bytes read from the socket, returns false if the body couldn't be stored
+            // Once the headers are parsed, the rest goes straight to the body so buffer (& the header views into it) stays put
+            bool receive(const char* data, const size_t size);
+
+            // Moves any bytes buffered past the headers into the body, once the parser has found the end of them
+            bool loadBody();
+
+            // True once the whole body is received, whether it's framed by Content-Length or chunked
+            inline bool isBodyComplete() const {
+                return parser.isChunked() ? chunkedDecoder.isDone() : body.size() >= parser.getContentLength();
+            };
+
+            // True if the body may outgrow RequestBodyMemoryLimit (& so be spilled to a temp file) within the next readSize bytes
+            // Bytes still buffered past the headers are counted too, since loadBody hasn't moved them yet
+            inline bool mayBodySpill(const size_t readSize) const {
+                if (body.isSpilled()) return true;
+                if (!parser.isChunked()) return parser.getContentLength() > conf::REQUEST_BODY_MEMORY_LIMIT;
+                if (chunkedDecoder.isDone()) return false;
+
+                const size_t headersEnd = parser.getHeadersEnd();
+                const size_t buffered = buffer.size() > headersEnd ? buffer.size() - headersEnd : 0;
+                return body.size() + buffered + readSize > conf::REQUEST_BODY_MEMORY_LIMIT;
+            };
+
+            // The config the current request is handled w/, taken on first use & kept until resetRequest
+            // So answering "Expect: 100-continue" & the final response can't straddle a reload
+            inline const std::shared_ptr<const conf::Snapshot>& getConfig() {
+                if (pConfig == nullptr) pConfig = conf::getSnapshot();
+                return pConfig;
+            };
+
+            inline void touch() { lastActivity = std::chrono::steady_clock::now(); };
+
+            const int sock;
+            SSL* pSSL;
+            const std::string clientIP;
+
+            // Raw bytes received for the current request, up to the end of its headers
+            std::string buffer;
+
+            // The current request's body, which may be spilled to a temp file if it's large
+            RequestBody body;
+
+            // Bytes received past the end of the current request (HTTP/1.1 pipelining)
+            std::string pipelined;
+
+            // Headers are loaded as each line is received
+            headers_map_t headers;
+            RequestParser parser;
+            ChunkedDecoder chunkedDecoder; // Only used for chunked request bodies
+
+            RequestFlags reqFlags;
+            RequestTimer requestTimer;
+            int keepAliveReqsLeft;
+
+            // Set once "Expect: 100-continue" is answered, either w/ 100 Continue or w/ the final response (pRejection)
+            bool isExpectationAnswered = false;
+            std::unique_ptr<Response> pRejection;
+            std::shared_ptr<const conf::Snapshot> pConfig; // See getConfig
+
+            // Only used while parked in the event loop
+            conn_time_t lastActivity;
+            bool isDispatched = false; // True while a worker thread owns the connection
+
+            // True until the non-blocking TLS handshake completes, which must happen before handshakeDeadline
+            bool isHandshaking = false;
+            conn_time_t handshakeDeadline;
+
+            // Set once the connection speaks HTTP/2 (negotiated via ALPN, or w/ the h2c preface), for the rest of its life
+            std::unique_ptr<http2::Session> pHTTP2;
+    };
+
+}
+
+#endif
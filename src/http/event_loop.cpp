@@ -0,0 +1,73 @@
+#include "event_loop.hpp"
+
+#ifdef __linux__
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define EVENT_LOOP_READ_FLAGS (EPOLLIN | EPOLLRDHUP | EPOLLONESHOT)
+#define EVENT_LOOP_WRITE_FLAGS (EPOLLOUT | EPOLLRDHUP | EPOLLONESHOT)
+
+namespace http {
+
+    EventLoop::~EventLoop() {
+        if (wakeFd != -1) close(wakeFd);
+        if (epollFd != -1) close(epollFd);
+    }
+
+    bool EventLoop::init() {
+        if ((epollFd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+            return false;
+
+        if ((wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+            return false;
+
+        // The wakeup fd is level-triggered and identified by a null data ptr
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) == 0;
+    }
+
+    bool EventLoop::watch(const int fd, void* pData) {
+        struct epoll_event event = {};
+        event.events = EVENT_LOOP_READ_FLAGS;
+        event.data.ptr = pData;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    bool EventLoop::rearm(const int fd, void* pData, const bool isWriteInterest) {
+        struct epoll_event event = {};
+        event.events = isWriteInterest ? EVENT_LOOP_WRITE_FLAGS : EVENT_LOOP_READ_FLAGS;
+        event.data.ptr = pData;
+        return epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+    }
+
+    void EventLoop::unwatch(const int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    int EventLoop::wait(std::vector<struct epoll_event>& events, const int timeoutMS) {
+        events.resize(EVENT_LOOP_MAX_EVENTS);
+        const int n = epoll_wait(epollFd, events.data(), EVENT_LOOP_MAX_EVENTS, timeoutMS);
+        if (n <= 0) return 0; // Timeout or EINTR
+
+        // Drain the wakeup counter so it doesn't stay readable
+        for (int i = 0; i < n; ++i) {
+            if (!isWakeEvent(events[i])) continue;
+            eventfd_t value;
+            eventfd_read(wakeFd, &value);
+        }
+        return n;
+    }
+
+    void EventLoop::wake() {
+        eventfd_write(wakeFd, 1);
+    }
+
+}
+
+#undef EVENT_LOOP_READ_FLAGS
+#undef EVENT_LOOP_WRITE_FLAGS
+
+#endif
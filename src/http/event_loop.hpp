@@ -0,0 +1,47 @@
+#ifndef __HTTP_EVENT_LOOP_HPP
+#define __HTTP_EVENT_LOOP_HPP
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+
+#include <vector>
+
+#define EVENT_LOOP_MAX_EVENTS 256
+
+namespace http {
+
+    // Thin wrapper around an epoll instance w/ an eventfd used to wake the waiting thread
+    class EventLoop {
+        public:
+            EventLoop() = default;
+            ~EventLoop();
+            EventLoop(const EventLoop&) = delete; // Prevent copies
+            void operator=(const EventLoop&) = delete; // Prevent copies
+
+            // Returns true if the epoll & eventfd handles were created
+            bool init();
+
+            // Registers a one-shot read interest for the fd, which must be re-armed after each event
+            bool watch(const int fd, void* pData);
+            bool rearm(const int fd, void* pData, const bool isWriteInterest=false);
+            void unwatch(const int fd);
+
+            // Waits up to timeoutMS for events, returns the number of events loaded into events
+            int wait(std::vector<struct epoll_event>& events, const int timeoutMS);
+
+            // Interrupts a thread blocked in wait (ie. for shutdown)
+            void wake();
+
+            // Returns true if the event belongs to the internal wakeup fd
+            inline bool isWakeEvent(const struct epoll_event& event) const { return event.data.ptr == nullptr; };
+        private:
+            int epollFd = -1;
+            int wakeFd = -1;
+    };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+#include "header_map.hpp"
+
+#include <algorithm>
+
+#define HEADER_TABLE_MIN_SIZE 32
+
+namespace http {
+
+    static inline char toLowerASCII(const char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    bool caseInsensitiveEquals(const std::string_view a, const std::string_view b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (toLowerASCII(a[i]) != toLowerASCII(b[i]))
+                return false;
+        return true;
+    }
+
+    // FNV-1a over the lowercased name
+    size_t caseInsensitiveHash(const std::string_view s) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (const char c : s) {
+            hash ^= static_cast<unsigned char>( toLowerASCII(c) );
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash);
+    }
+
+    KNOWN_HEADER lookupKnownHeader(const std::string_view name) {
+        // Every known header has a distinct length except Accept & Range
+        switch (name.size()) {
+            case 4:  return caseInsensitiveEquals(name, "Host") ? HEADER_HOST : NUM_KNOWN_HEADERS;
+            case 5:  return caseInsensitiveEquals(name, "Range") ? HEADER_RANGE : NUM_KNOWN_HEADERS;
+            case 6:  return caseInsensitiveEquals(name, "Accept") ? HEADER_ACCEPT : NUM_KNOWN_HEADERS;
+            case 10: return caseInsensitiveEquals(name, "Connection") ? HEADER_CONNECTION : NUM_KNOWN_HEADERS;
+            case 14: return caseInsensitiveEquals(name, "Content-Length") ? HEADER_CONTENT_LENGTH : NUM_KNOWN_HEADERS;
+            case 15: return caseInsensitiveEquals(name, "Accept-Encoding") ? HEADER_ACCEPT_ENCODING : NUM_KNOWN_HEADERS;
+            default: return NUM_KNOWN_HEADERS;
+        }
+    }
+
+    void HeaderMap::add(const std::string_view name, const std::string_view value) {
+        if (entries.size() >= NO_ENTRY) return; // Out of indices
+
+        const KNOWN_HEADER header = lookupKnownHeader(name);
+        uint16_t* pSlot;
+        if (header != NUM_KNOWN_HEADERS) {
+            pSlot = &knownSlots[header];
+        } else {
+            if ((entries.size() + 1) * 2 > table.size()) this->growTable();
+            pSlot = &table[this->findSlot(name)];
+        }
+
+        // Combine extra list headers, otherwise the first value is kept
+        if (*pSlot != NO_ENTRY) {
+            this->combine(header, entries[*pSlot], value);
+            return;
+        }
+
+        *pSlot = static_cast<uint16_t>(entries.size());
+        entries.emplace_back(name, value);
+    }
+
+    void HeaderMap::clear() {
+        entries.clear();
+        knownSlots.fill(NO_ENTRY);
+        std::fill(table.begin(), table.end(), NO_ENTRY);
+        combinedValues.clear();
+    }
+
+    std::optional<std::string_view> HeaderMap::get(const std::string_view name) const {
+        const KNOWN_HEADER header = lookupKnownHeader(name);
+        if (header != NUM_KNOWN_HEADERS)
+            return this->get(header);
+
+        if (table.empty()) return std::nullopt;
+        const uint16_t index = table[this->findSlot(name)];
+        if (index == NO_ENTRY) return std::nullopt;
+        return entries[index].second;
+    }
+
+    std::optional<std::string_view> HeaderMap::get(const KNOWN_HEADER header) const {
+        const uint16_t index = knownSlots[header];
+        if (index == NO_ENTRY) return std::nullopt;
+        return entries[index].second;
+    }
+
+    // Returns the position of the table slot holding name, or the empty slot it belongs in (table must not be full)
+    size_t HeaderMap::findSlot(const std::string_view name) const {
+        const size_t mask = table.size() - 1;
+        for (size_t i = caseInsensitiveHash(name) & mask; ; i = (i + 1) & mask)
+            if (table[i] == NO_ENTRY || caseInsensitiveEquals(entries[table[i]].first, name))
+                return i;
+    }
+
+    void HeaderMap::combine(const KNOWN_HEADER header, entry_t& entry, const std::string_view value) {
+        std::string_view extra;
+        if (header == HEADER_ACCEPT || header == HEADER_ACCEPT_ENCODING) {
+            extra = value;
+        } else if (header == HEADER_RANGE) {
+            // Only keep the ranges from the repeated header (ie. "bytes=0-5" -> "0-5")
+            const size_t bytesEnd = value.find('=');
+            if (bytesEnd == std::string_view::npos || bytesEnd + 1 >= value.length()) return;
+            extra = value.substr(bytesEnd + 1);
+        } else {
+            return;
+        }
+
+        std::string& combined = combinedValues.emplace_back(entry.second);
+        combined.append(1, ',').append(extra);
+        entry.second = combined;
+    }
+
+    // Doubles the table & re-indexes every unknown header
+    void HeaderMap::growTable() {
+        table.assign((std::max)(table.size() * 2, static_cast<size_t>(HEADER_TABLE_MIN_SIZE)), NO_ENTRY);
+
+        for (size_t i = 0; i < entries.size(); ++i)
+            if (lookupKnownHeader(entries[i].first) == NUM_KNOWN_HEADERS)
+                table[this->findSlot(entries[i].first)] = static_cast<uint16_t>(i);
+    }
+
+}
+
+#undef HEADER_TABLE_MIN_SIZE
@@ -0,0 +1,73 @@
+#ifndef __HTTP_HEADER_MAP_HPP
+#define __HTTP_HEADER_MAP_HPP
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace http {
+
+    // Headers w/ a dedicated slot in every HeaderMap, looked up without hashing
+    enum KNOWN_HEADER {
+        HEADER_HOST = 0,
+        HEADER_ACCEPT = 1,
+        HEADER_ACCEPT_ENCODING = 2,
+        HEADER_RANGE = 3,
+        HEADER_CONNECTION = 4,
+        HEADER_CONTENT_LENGTH = 5,
+        NUM_KNOWN_HEADERS = 6
+    };
+
+    bool caseInsensitiveEquals(const std::string_view a, const std::string_view b);
+    size_t caseInsensitiveHash(const std::string_view s);
+
+    // Returns the slot for a well-known header name, or NUM_KNOWN_HEADERS if it isn't one
+    KNOWN_HEADER lookupKnownHeader(const std::string_view name);
+
+    // Case-insensitive request header map which stores views instead of copies
+    // Names & values are views into the request buffer, which must outlive the map until it is cleared,
+    // except repeated list headers (Accept, Accept-Encoding, Range) which are combined into an owned string
+    class HeaderMap {
+        public:
+            typedef std::pair<std::string_view, std::string_view> entry_t;
+
+            HeaderMap() { knownSlots.fill(NO_ENTRY); };
+
+            // Adds a header, the first occurrence of a non-list header wins
+            void add(const std::string_view name, const std::string_view value);
+            void clear();
+
+            std::optional<std::string_view> get(const std::string_view name) const;
+            std::optional<std::string_view> get(const KNOWN_HEADER header) const;
+            inline bool contains(const std::string_view name) const { return get(name).has_value(); };
+            inline bool contains(const KNOWN_HEADER header) const { return knownSlots[header] != NO_ENTRY; };
+
+            // Iterates in the order headers were received
+            inline std::vector<entry_t>::const_iterator begin() const { return entries.begin(); };
+            inline std::vector<entry_t>::const_iterator end() const { return entries.end(); };
+            inline size_t size() const { return entries.size(); };
+            inline bool empty() const { return entries.empty(); };
+        private:
+            static constexpr uint16_t NO_ENTRY = UINT16_MAX;
+
+            size_t findSlot(const std::string_view name) const;
+            void combine(const KNOWN_HEADER header, entry_t& entry, const std::string_view value);
+            void growTable();
+
+            std::vector<entry_t> entries;
+            std::array<uint16_t, NUM_KNOWN_HEADERS> knownSlots;
+
+            // Open-addressed index into entries for every other header, sized to a power of two
+            std::vector<uint16_t> table;
+
+            std::deque<std::string> combinedValues; // Stable storage for combined list headers
+    };
+
+}
+
+#endif
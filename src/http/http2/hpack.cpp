@@ -0,0 +1,418 @@
+#include "hpack.hpp"
+
+#include <algorithm>
+
+namespace http::http2 {
+
+    // RFC 7541 Appendix A, index 1 is the first entry
+    static const header_field_view_t STATIC_TABLE[HPACK_STATIC_TABLE_SIZE] = {
+        { ":authority", "" },
+        { ":method", "GET" },
+        { ":method", "POST" },
+        { ":path", "/" },
+        { ":path", "/index.html" },
+        { ":scheme", "http" },
+        { ":scheme", "https" },
+        { ":status", "200" },
+        { ":status", "204" },
+        { ":status", "206" },
+        { ":status", "304" },
+        { ":status", "400" },
+        { ":status", "404" },
+        { ":status", "500" },
+        { "accept-charset", "" },
+        { "accept-encoding", "gzip, deflate" },
+        { "accept-language", "" },
+        { "accept-ranges", "" },
+        { "accept", "" },
+        { "access-control-allow-origin", "" },
+        { "age", "" },
+        { "allow", "" },
+        { "authorization", "" },
+        { "cache-control", "" },
+        { "content-disposition", "" },
+        { "content-encoding", "" },
+        { "content-language", "" },
+        { "content-length", "" },
+        { "content-location", "" },
+        { "content-range", "" },
+        { "content-type", "" },
+        { "cookie", "" },
+        { "date", "" },
+        { "etag", "" },
+        { "expect", "" },
+        { "expires", "" },
+        { "from", "" },
+        { "host", "" },
+        { "if-match", "" },
+        { "if-modified-since", "" },
+        { "if-none-match", "" },
+        { "if-range", "" },
+        { "if-unmodified-since", "" },
+        { "last-modified", "" },
+        { "link", "" },
+        { "location", "" },
+        { "max-forwards", "" },
+        { "proxy-authenticate", "" },
+        { "proxy-authorization", "" },
+        { "range", "" },
+        { "referer", "" },
+        { "refresh", "" },
+        { "retry-after", "" },
+        { "server", "" },
+        { "set-cookie", "" },
+        { "strict-transport-security", "" },
+        { "transfer-encoding", "" },
+        { "user-agent", "" },
+        { "vary", "" },
+        { "via", "" },
+        { "www-authenticate", "" }
+    };
+
+    // RFC 7541 Appendix B, the last entry is EOS
+    static const uint32_t HUFFMAN_CODES[HPACK_HUFFMAN_SYMBOLS] = {
+        0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+        0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+        0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+        0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+        0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+        0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+        0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+        0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+        0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+        0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+        0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+        0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+        0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+        0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+        0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+        0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+        0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+        0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+        0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+        0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+        0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+        0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+        0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+        0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+        0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+        0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+        0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+        0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+        0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+        0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+        0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+        0x3fffffff
+    };
+    static const uint8_t HUFFMAN_CODE_LENGTHS[HPACK_HUFFMAN_SYMBOLS] = {
+        13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+        28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+        6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+        5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+        13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+        15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+        6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+        20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+        24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+        22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+        21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+        26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+        19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+        20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+        26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+        30
+    };
+
+    /************************** Primitives **************************/
+
+    typedef struct {
+        int16_t children[2];
+        int16_t symbol; // -1 for inner nodes
+    } huffman_node_t;
+
+    static std::vector<huffman_node_t> buildHuffmanTree() {
+        std::vector<huffman_node_t> tree(1, { {-1, -1}, -1 });
+        for (int16_t symbol = 0; symbol < HPACK_HUFFMAN_SYMBOLS; ++symbol) {
+            size_t node = 0;
+            for (int bit = HUFFMAN_CODE_LENGTHS[symbol] - 1; bit >= 0; --bit) {
+                const int branch = (HUFFMAN_CODES[symbol] >> bit) & 1;
+                if (tree[node].children[branch] < 0) {
+                    tree[node].children[branch] = static_cast<int16_t>(tree.size());
+                    tree.push_back({ {-1, -1}, -1 });
+                }
+                node = static_cast<size_t>(tree[node].children[branch]);
+            }
+            tree[node].symbol = symbol;
+        }
+        return tree;
+    }
+
+    // Appends the decoded string to out, returns false on an EOS symbol or invalid padding
+    static bool huffmanDecode(const uint8_t* data, const size_t size, std::string& out) {
+        static const std::vector<huffman_node_t> tree = buildHuffmanTree();
+
+        size_t node = 0;
+        int depth = 0; // Bits read since the last symbol
+        bool isAllOnes = true;
+        for (size_t i = 0; i < size; ++i) {
+            for (int bit = 7; bit >= 0; --bit) {
+                const int branch = (data[i] >> bit) & 1;
+                if (tree[node].children[branch] < 0) return false;
+
+                node = static_cast<size_t>(tree[node].children[branch]);
+                ++depth;
+                isAllOnes &= branch == 1;
+
+                if (tree[node].symbol < 0) continue;
+                if (tree[node].symbol == HPACK_HUFFMAN_SYMBOLS - 1) return false; // EOS can't be encoded
+                out.push_back(static_cast<char>(tree[node].symbol));
+                node = depth = 0;
+                isAllOnes = true;
+            }
+        }
+
+        // Padding must be the shortest possible prefix of EOS (RFC 7541 5.2)
+        return depth < 8 && isAllOnes;
+    }
+
+    static size_t huffmanEncodedSize(const std::string_view s) {
+        size_t bits = 0;
+        for (const char c : s)
+            bits += HUFFMAN_CODE_LENGTHS[static_cast<uint8_t>(c)];
+        return (bits + 7) / 8;
+    }
+
+    static void huffmanEncode(const std::string_view s, std::string& out) {
+        uint64_t bits = 0;
+        int numBits = 0;
+        for (const char c : s) {
+            const uint8_t symbol = static_cast<uint8_t>(c);
+            bits = (bits << HUFFMAN_CODE_LENGTHS[symbol]) | HUFFMAN_CODES[symbol];
+            numBits += HUFFMAN_CODE_LENGTHS[symbol];
+            while (numBits >= 8) {
+                numBits -= 8;
+                out.push_back(static_cast<char>(bits >> numBits));
+            }
+            bits &= (1ULL << numBits) - 1;
+        }
+
+        // Pad w/ the start of EOS
+        if (numBits > 0)
+            out.push_back(static_cast<char>((bits << (8 - numBits)) | (0xff >> numBits)));
+    }
+
+    bool decodeInteger(const uint8_t*& p, const uint8_t* pEnd, const int prefixBits, size_t& value) {
+        if (p == pEnd) return false;
+        const size_t mask = (1u << prefixBits) - 1;
+        value = *p++ & mask;
+        if (value < mask) return true;
+
+        for (int shift = 0; shift <= 28; shift += 7) {
+            if (p == pEnd) return false;
+            const uint8_t byte = *p++;
+            value += static_cast<size_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false; // Too large to be valid
+    }
+
+    bool decodeString(const uint8_t*& p, const uint8_t* pEnd, const int prefixBits, std::string& out) {
+        if (p == pEnd) return false;
+        const bool isHuffman = *p & (1u << prefixBits);
+
+        size_t length;
+        if (!decodeInteger(p, pEnd, prefixBits, length) || length > static_cast<size_t>(pEnd - p))
+            return false;
+
+        if (isHuffman && !huffmanDecode(p, length, out))
+            return false;
+        else if (!isHuffman)
+            out.assign(reinterpret_cast<const char*>(p), length);
+
+        p += length;
+        return true;
+    }
+
+    void encodeInteger(std::string& out, const uint8_t flags, const int prefixBits, size_t value) {
+        const size_t mask = (1u << prefixBits) - 1;
+        if (value < mask) {
+            out.push_back(static_cast<char>(flags | value));
+            return;
+        }
+
+        out.push_back(static_cast<char>(flags | mask));
+        for (value -= mask; value >= 0x80; value >>= 7)
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Huffman-encodes the string if that's shorter
+    void encodeString(std::string& out, const uint8_t flags, const int prefixBits, const std::string_view s) {
+        const size_t huffmanSize = huffmanEncodedSize(s);
+        if (huffmanSize < s.size()) {
+            encodeInteger(out, flags | (1u << prefixBits), prefixBits, huffmanSize);
+            huffmanEncode(s, out);
+        } else {
+            encodeInteger(out, flags, prefixBits, s.size());
+            out.append(s);
+        }
+    }
+
+    /************************** Table **************************/
+
+    static inline size_t getEntrySize(const std::string_view name, const std::string_view value) {
+        return name.size() + value.size() + HPACK_ENTRY_OVERHEAD;
+    }
+
+    bool HPACKTable::get(const size_t index, header_field_view_t& field) const {
+        if (index == 0) return false;
+        if (index <= HPACK_STATIC_TABLE_SIZE) {
+            field = STATIC_TABLE[index - 1];
+            return true;
+        }
+
+        const size_t dynamicIndex = index - HPACK_STATIC_TABLE_SIZE - 1;
+        if (dynamicIndex >= entries.size()) return false;
+        field = { entries[dynamicIndex].first, entries[dynamicIndex].second };
+        return true;
+    }
+
+    size_t HPACKTable::find(const std::string_view name, const std::string_view value, bool& isExactMatch) const {
+        size_t nameIndex = 0;
+        isExactMatch = false;
+
+        for (size_t i = 0; i < HPACK_STATIC_TABLE_SIZE; ++i) {
+            if (STATIC_TABLE[i].first != name) continue;
+            if (STATIC_TABLE[i].second == value) {
+                isExactMatch = true;
+                return i + 1;
+            }
+            if (nameIndex == 0) nameIndex = i + 1;
+        }
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].first != name) continue;
+            if (entries[i].second == value) {
+                isExactMatch = true;
+                return HPACK_STATIC_TABLE_SIZE + i + 1;
+            }
+            if (nameIndex == 0) nameIndex = HPACK_STATIC_TABLE_SIZE + i + 1;
+        }
+
+        return nameIndex;
+    }
+
+    void HPACKTable::insert(const std::string_view name, const std::string_view value) {
+        // An entry larger than the whole table just empties it (RFC 7541 4.4)
+        const size_t entrySize = getEntrySize(name, value);
+        if (entrySize > maxSize) {
+            entries.clear();
+            size = 0;
+            return;
+        }
+
+        evict(maxSize - entrySize);
+        entries.emplace_front(name, value);
+        size += entrySize;
+    }
+
+    void HPACKTable::resize(const size_t maxSize) {
+        this->maxSize = maxSize;
+        evict(maxSize);
+    }
+
+    void HPACKTable::evict(const size_t targetSize) {
+        while (size > targetSize && !entries.empty()) {
+            size -= getEntrySize(entries.back().first, entries.back().second);
+            entries.pop_back();
+        }
+    }
+
+    /************************** Decoder **************************/
+
+    bool HPACKDecoder::decode(const uint8_t* data, const size_t size, header_list_t& headers) {
+        const uint8_t* p = data;
+        const uint8_t* pEnd = data + size;
+        bool isFieldSeen = false;
+
+        while (p < pEnd) {
+            const uint8_t prefix = *p;
+            header_field_view_t field;
+
+            if (prefix & 0x80) { // Indexed field
+                size_t index;
+                if (!decodeInteger(p, pEnd, 7, index) || !table.get(index, field)) return false;
+                headers.emplace_back(field.first, field.second);
+            } else if ((prefix & 0xe0) == 0x20) { // Table size update, only allowed before the first field
+                size_t newSize;
+                if (isFieldSeen || !decodeInteger(p, pEnd, 5, newSize) || newSize > settingsMaxTableSize) return false;
+                table.resize(newSize);
+                continue;
+            } else { // Literal w/ incremental indexing (01), w/o indexing (0000), or never indexed (0001)
+                const bool isIndexed = (prefix & 0xc0) == 0x40;
+                size_t nameIndex;
+                if (!decodeInteger(p, pEnd, isIndexed ? 6 : 4, nameIndex)) return false;
+
+                header_field_t& entry = headers.emplace_back();
+                if (nameIndex > 0 && !table.get(nameIndex, field)) return false;
+                if (nameIndex > 0) entry.first = field.first;
+                else if (!decodeString(p, pEnd, 7, entry.first)) return false;
+
+                if (!decodeString(p, pEnd, 7, entry.second)) return false;
+                if (isIndexed) table.insert(entry.first, entry.second);
+            }
+
+            isFieldSeen = true;
+        }
+
+        return true;
+    }
+
+    /************************** Encoder **************************/
+
+    // Fields that change w/ nearly every response would only churn the table
+    static bool isIndexableField(const std::string_view name) {
+        return name != "content-length" && name != "content-range" && name != "date" &&
+            name != "etag" && name != "last-modified" && name != "set-cookie";
+    }
+
+    void HPACKEncoder::setMaxTableSize(const size_t peerMaxSize) {
+        const size_t newSize = (std::min)(peerMaxSize, static_cast<size_t>(HPACK_DEFAULT_TABLE_SIZE));
+        if (newSize == tableSize && !isSizeUpdatePending) return;
+
+        minPendingTableSize = isSizeUpdatePending ? (std::min)(minPendingTableSize, newSize) : (std::min)(tableSize, newSize);
+        tableSize = newSize;
+        isSizeUpdatePending = true;
+    }
+
+    void HPACKEncoder::encode(const header_list_t& headers, std::string& out) {
+        if (isSizeUpdatePending) {
+            if (minPendingTableSize < tableSize) {
+                encodeInteger(out, 0x20, 5, minPendingTableSize);
+                table.resize(minPendingTableSize);
+            }
+            encodeInteger(out, 0x20, 5, tableSize);
+            table.resize(tableSize);
+            isSizeUpdatePending = false;
+        }
+
+        for (const auto& [name, value] : headers) {
+            bool isExactMatch;
+            const size_t index = table.find(name, value, isExactMatch);
+            if (isExactMatch) {
+                encodeInteger(out, 0x80, 7, index);
+                continue;
+            }
+
+            const bool isIndexable = isIndexableField(name);
+            encodeInteger(out, isIndexable ? 0x40 : 0x00, isIndexable ? 6 : 4, index);
+            if (index == 0) encodeString(out, 0x00, 7, name);
+            encodeString(out, 0x00, 7, value);
+
+            if (isIndexable) table.insert(name, value);
+        }
+    }
+
+}
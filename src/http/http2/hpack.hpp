@@ -0,0 +1,88 @@
+#ifndef __HTTP_HTTP2_HPACK_HPP
+#define __HTTP_HTTP2_HPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#define HPACK_STATIC_TABLE_SIZE 61
+#define HPACK_HUFFMAN_SYMBOLS 257 // 256 octets + EOS
+#define HPACK_ENTRY_OVERHEAD 32 // Counted against the table size for every entry (RFC 7541 4.1)
+#define HPACK_DEFAULT_TABLE_SIZE 4096
+
+namespace http::http2 {
+
+    typedef std::pair<std::string, std::string> header_field_t;
+    typedef std::vector<header_field_t> header_list_t;
+    typedef std::pair<std::string_view, std::string_view> header_field_view_t;
+
+    // Integer & string literal primitives (RFC 7541 5.1 & 5.2), also used by QPACK
+    // Strings use the bit just above the length's prefix as the Huffman flag, & are only Huffman-encoded if that's shorter
+    bool decodeInteger(const uint8_t*& p, const uint8_t* pEnd, const int prefixBits, size_t& value);
+    bool decodeString(const uint8_t*& p, const uint8_t* pEnd, const int prefixBits, std::string& out);
+    void encodeInteger(std::string& out, const uint8_t flags, const int prefixBits, size_t value);
+    void encodeString(std::string& out, const uint8_t flags, const int prefixBits, const std::string_view s);
+
+    // The static table followed by a dynamic table, which is addressed newest entry first
+    class HPACKTable {
+        public:
+            explicit HPACKTable(const size_t maxSize) : maxSize(maxSize) {};
+
+            // Looks up a 1-based index, returns false if it's out of range
+            bool get(const size_t index, header_field_view_t& field) const;
+
+            // Returns the index of the best match (0 if none), w/ isExactMatch set if the value matched too
+            size_t find(const std::string_view name, const std::string_view value, bool& isExactMatch) const;
+
+            // Adds a new entry, evicting the oldest entries to make room
+            void insert(const std::string_view name, const std::string_view value);
+
+            // Changes the max size, evicting entries that no longer fit
+            void resize(const size_t maxSize);
+        private:
+            void evict(const size_t targetSize);
+
+            std::deque<header_field_t> entries;
+            size_t size = 0;
+            size_t maxSize;
+    };
+
+    // Decodes header blocks, the decoder state carries over between blocks on a connection
+    class HPACKDecoder {
+        public:
+            explicit HPACKDecoder(const size_t maxTableSize) : table(maxTableSize), settingsMaxTableSize(maxTableSize) {};
+
+            // Appends every field in a complete header block to headers
+            // Returns false on a malformed block, which is a connection error (COMPRESSION_ERROR)
+            bool decode(const uint8_t* data, const size_t size, header_list_t& headers);
+        private:
+            HPACKTable table;
+            const size_t settingsMaxTableSize; // The size we advertise, which table size updates can't exceed
+    };
+
+    // Encodes header blocks, indexing fields that are likely to repeat across responses
+    class HPACKEncoder {
+        public:
+            HPACKEncoder() : table(HPACK_DEFAULT_TABLE_SIZE) {};
+
+            // Applies the peer's SETTINGS_HEADER_TABLE_SIZE, which is announced at the start of the next block
+            void setMaxTableSize(const size_t peerMaxSize);
+
+            // Appends the encoded block to out, names must already be lowercase
+            void encode(const header_list_t& headers, std::string& out);
+        private:
+            HPACKTable table;
+            size_t tableSize = HPACK_DEFAULT_TABLE_SIZE;
+
+            // Table size updates not yet announced, the smallest must be sent first (RFC 7541 4.2)
+            bool isSizeUpdatePending = false;
+            size_t minPendingTableSize = HPACK_DEFAULT_TABLE_SIZE;
+    };
+
+}
+
+#endif
@@ -0,0 +1,583 @@
+#include "session.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+#define DATA_SENT    0 // Made progress, more to send
+#define DATA_BLOCKED 1 // Waiting on a send window
+#define DATA_DONE    2 // Sent END_STREAM
+#define DATA_FAILED  3 // The body couldn't be read
+
+#define CRLF "\r\n"
+
+namespace http::http2 {
+
+    static inline uint32_t readUint32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    static inline void appendUint32(std::string& out, const uint32_t value) {
+        out.push_back(static_cast<char>(value >> 24));
+        out.push_back(static_cast<char>(value >> 16));
+        out.push_back(static_cast<char>(value >> 8));
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool isConnectionSpecificField(const std::string_view name) {
+        return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+            name == "transfer-encoding" || name == "upgrade";
+    }
+
+    bool isValidRequest(const header_list_t& headers) {
+        bool isRegularFieldSeen = false;
+        bool hasMethod = false, hasScheme = false, hasPath = false, hasAuthority = false, isConnect = false;
+
+        for (const auto& [name, value] : headers) {
+            if (name.empty()) return false;
+
+            // Names must be lowercase, & neither can smuggle in another line
+            for (size_t i = 0; i < name.size(); ++i) {
+                const char c = name[i];
+                if ((c >= 'A' && c <= 'Z') || c == '\r' || c == '\n' || c == '\0' || (c == ':' && i > 0))
+                    return false;
+            }
+            if (value.find_first_of(std::string_view("\r\n\0", 3)) != std::string::npos)
+                return false;
+
+            // Pseudo-headers come first, each at most once
+            if (name[0] == ':') {
+                bool* pSeen = name == ":method" ? &hasMethod : name == ":scheme" ? &hasScheme :
+                    name == ":path" ? &hasPath : name == ":authority" ? &hasAuthority : nullptr;
+                if (isRegularFieldSeen || pSeen == nullptr || *pSeen) return false;
+                *pSeen = true;
+                isConnect |= name == ":method" && value == "CONNECT";
+                if (name == ":path" && value.empty()) return false;
+                continue;
+            }
+
+            isRegularFieldSeen = true;
+            if (isConnectionSpecificField(name) || (name == "te" && value != "trailers"))
+                return false;
+        }
+
+        return hasMethod && (isConnect || (hasScheme && hasPath));
+    }
+
+    bool isContentLengthMatched(const header_list_t& headers, const size_t bodySize) {
+        for (const auto& [name, value] : headers) {
+            if (name != "content-length") continue;
+
+            size_t length = 0;
+            const auto [pEnd, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (ec != std::errc() || pEnd != value.data() + value.size() || length != bodySize)
+                return false;
+        }
+        return true;
+    }
+
+    void toHTTP1Request(const header_list_t& headers, const size_t bodySize, std::string& raw) {
+        std::string_view method, path, authority;
+        std::string cookies;
+        for (const auto& [name, value] : headers) {
+            if (name == ":method") method = value;
+            else if (name == ":path") path = value;
+            else if (name == ":authority") authority = value;
+            else if (name == "cookie") cookies.append(cookies.empty() ? "" : "; ").append(value); // Split into fields by clients
+        }
+
+        raw.append(method).append(1, ' ').append(path.empty() ? authority : path).append(" HTTP/1.1" CRLF);
+        if (!authority.empty())
+            raw.append("host: ").append(authority).append(CRLF);
+        if (!cookies.empty())
+            raw.append("cookie: ").append(cookies).append(CRLF);
+
+        for (const auto& [name, value] : headers) {
+            if (name[0] == ':' || name == "cookie" || name == "content-length" || (name == "host" && !authority.empty()))
+                continue;
+            raw.append(name).append(": ").append(value).append(CRLF);
+        }
+
+        // The length is known once the stream ends, whether or not the client sent it
+        if (bodySize > 0)
+            raw.append("content-length: ").append(std::to_string(bodySize)).append(CRLF);
+        raw.append(CRLF);
+    }
+
+    /************************** Stream **************************/
+
+    void Stream::toHTTP1Request(std::string& raw) const {
+        http2::toHTTP1Request(headers, bodySize, raw);
+    }
+
+    /************************** Session **************************/
+
+    Session::Session(const uint32_t maxConcurrentStreams, const size_t maxRequestBody)
+        : maxConcurrentStreams(maxConcurrentStreams), maxRequestBody(maxRequestBody), decoder(HPACK_DEFAULT_TABLE_SIZE) {
+        // The server preface, every other setting is left at its default
+        writeFrameHeader(6, FRAME_SETTINGS, 0, 0);
+        output.push_back(0);
+        output.push_back(static_cast<char>(SETTINGS_MAX_CONCURRENT_STREAMS));
+        appendUint32(output, maxConcurrentStreams);
+    }
+
+    bool Session::receive(const char* data, const size_t size) {
+        if (_isClosed) return false;
+        input.append(data, size);
+
+        size_t offset = 0;
+        if (!isPrefaceReceived) {
+            const size_t n = (std::min)(input.size(), static_cast<size_t>(HTTP2_PREFACE_SIZE));
+            if (input.compare(0, n, HTTP2_PREFACE, n) != 0) return connectionError(H2_PROTOCOL_ERROR);
+            if (n < HTTP2_PREFACE_SIZE) return true;
+
+            offset = HTTP2_PREFACE_SIZE;
+            isPrefaceReceived = true;
+        }
+
+        while (input.size() - offset >= HTTP2_FRAME_HEADER_SIZE) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(input.data()) + offset;
+            const uint32_t length = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+            if (length > HTTP2_MIN_MAX_FRAME_SIZE) return connectionError(H2_FRAME_SIZE_ERROR);
+            if (input.size() - offset - HTTP2_FRAME_HEADER_SIZE < length) break; // Wait for the rest of the frame
+
+            if (!handleFrame(p[3], p[4], readUint32(p + 5) & HTTP2_MAX_WINDOW_SIZE, p + HTTP2_FRAME_HEADER_SIZE, length)) {
+                input.clear();
+                return false;
+            }
+            offset += HTTP2_FRAME_HEADER_SIZE + length;
+        }
+
+        input.erase(0, offset);
+        return true;
+    }
+
+    bool Session::handleFrame(const uint8_t type, const uint8_t flags, const uint32_t streamId, const uint8_t* payload, const uint32_t length) {
+        // The client's preface ends w/ its SETTINGS
+        if (!isSettingsReceived && type != FRAME_SETTINGS) return connectionError(H2_PROTOCOL_ERROR);
+
+        // Nothing may interrupt a header block
+        if (headerBlockStreamId != 0 && (type != FRAME_CONTINUATION || streamId != headerBlockStreamId))
+            return connectionError(H2_PROTOCOL_ERROR);
+
+        switch (type) {
+            case FRAME_DATA: return handleData(flags, streamId, payload, length);
+            case FRAME_HEADERS: return handleHeaders(flags, streamId, payload, length);
+            case FRAME_CONTINUATION:
+                if (headerBlockStreamId == 0) return connectionError(H2_PROTOCOL_ERROR);
+                return handleContinuation(flags, payload, length);
+            case FRAME_SETTINGS: return handleSettings(flags, streamId, payload, length);
+            case FRAME_WINDOW_UPDATE: return handleWindowUpdate(streamId, payload, length);
+            case FRAME_PRIORITY: // Priorities are advisory, & the DATA scheduler treats streams equally
+                if (streamId == 0) return connectionError(H2_PROTOCOL_ERROR);
+                if (length != 5) closeStream(streamId, H2_FRAME_SIZE_ERROR);
+                return true;
+            case FRAME_RST_STREAM:
+                if (streamId == 0 || streamId > lastClientStreamId) return connectionError(H2_PROTOCOL_ERROR);
+                if (length != 4) return connectionError(H2_FRAME_SIZE_ERROR);
+                if (streams.erase(streamId) == 0) return true; // Queued ids are skipped once their stream is gone
+                if (++clientResets > HTTP2_MAX_CLIENT_RESETS) return connectionError(H2_ENHANCE_YOUR_CALM);
+                return true;
+            case FRAME_PING:
+                if (streamId != 0) return connectionError(H2_PROTOCOL_ERROR);
+                if (length != 8) return connectionError(H2_FRAME_SIZE_ERROR);
+                if (!(flags & HTTP2_FLAG_ACK)) {
+                    writeFrameHeader(8, FRAME_PING, HTTP2_FLAG_ACK, 0);
+                    output.append(reinterpret_cast<const char*>(payload), 8);
+                }
+                return true;
+            case FRAME_GOAWAY: // Finish the streams already started, then close
+                if (streamId != 0) return connectionError(H2_PROTOCOL_ERROR);
+                isPeerGoingAway = true;
+                return true;
+            case FRAME_PUSH_PROMISE: // Clients can't push
+                return connectionError(H2_PROTOCOL_ERROR);
+            default: // Unknown frame types are ignored
+                return true;
+        }
+    }
+
+    bool Session::handleData(const uint8_t flags, const uint32_t streamId, const uint8_t* payload, const uint32_t length) {
+        if (streamId == 0 || streamId > lastClientStreamId) return connectionError(H2_PROTOCOL_ERROR);
+
+        // The whole frame counts against the connection window, padding included
+        if ((connRecvWindow -= length) < 0) return connectionError(H2_FLOW_CONTROL_ERROR);
+        if (connRecvWindow <= HTTP2_DEFAULT_WINDOW_SIZE / 2) {
+            writeWindowUpdate(0, static_cast<uint32_t>(HTTP2_DEFAULT_WINDOW_SIZE - connRecvWindow));
+            connRecvWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+        }
+
+        Stream* pStream = findStream(streamId);
+        if (pStream == nullptr || pStream->isRemoteClosed) {
+            closeStream(streamId, H2_STREAM_CLOSED);
+            return true;
+        }
+
+        size_t padding = 0;
+        if (flags & HTTP2_FLAG_PADDED) {
+            if (length == 0 || payload[0] >= length) return connectionError(H2_PROTOCOL_ERROR);
+            padding = payload[0] + 1;
+        }
+
+        if ((pStream->recvWindow -= length) < 0) {
+            closeStream(streamId, H2_FLOW_CONTROL_ERROR);
+            return true;
+        }
+
+        // Keep the body until it's too large to accept
+        const size_t dataSize = length - padding;
+        pStream->bodySize += dataSize;
+        if (pStream->bodySize > maxRequestBody) {
+            pStream->body.clear();
+        } else if (!pStream->body.append(reinterpret_cast<const char*>(payload) + (padding > 0 ? 1 : 0), dataSize)) {
+            closeStream(streamId, H2_INTERNAL_ERROR); // ie. the body couldn't be spilled to disk
+            return true;
+        }
+
+        if (flags & HTTP2_FLAG_END_STREAM) {
+            pStream->isRemoteClosed = true;
+            if (!pStream->isRequestDone) finishRequest(*pStream);
+            return true;
+        }
+
+        // Answer oversized requests early instead of waiting out the rest of the body
+        if (pStream->bodySize > maxRequestBody && !pStream->isRequestDone) {
+            finishRequest(*pStream);
+            return true;
+        }
+
+        if (!pStream->isRequestDone && pStream->recvWindow <= HTTP2_DEFAULT_WINDOW_SIZE / 2) {
+            writeWindowUpdate(streamId, static_cast<uint32_t>(HTTP2_DEFAULT_WINDOW_SIZE - pStream->recvWindow));
+            pStream->recvWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+        }
+        return true;
+    }
+
+    bool Session::handleHeaders(const uint8_t flags, const uint32_t streamId, const uint8_t* payload, const uint32_t length) {
+        if (streamId == 0 || streamId % 2 == 0) return connectionError(H2_PROTOCOL_ERROR);
+
+        // Skip the padding length & priority fields
+        size_t start = 0, padding = 0;
+        if (flags & HTTP2_FLAG_PADDED) {
+            if (length == 0) return connectionError(H2_PROTOCOL_ERROR);
+            padding = payload[0];
+            start = 1;
+        }
+        if (flags & HTTP2_FLAG_PRIORITY) start += 5;
+        if (start + padding > length) return connectionError(H2_PROTOCOL_ERROR);
+
+        headerBlockStreamId = streamId;
+        headerBlockEndsStream = flags & HTTP2_FLAG_END_STREAM;
+        headerBlock.assign(reinterpret_cast<const char*>(payload) + start, length - start - padding);
+        return (flags & HTTP2_FLAG_END_HEADERS) ? endHeaderBlock() : true;
+    }
+
+    bool Session::handleContinuation(const uint8_t flags, const uint8_t* payload, const uint32_t length) {
+        if (headerBlock.size() + length > HTTP2_MAX_HEADER_BLOCK_SIZE) return connectionError(H2_ENHANCE_YOUR_CALM);
+
+        headerBlock.append(reinterpret_cast<const char*>(payload), length);
+        return (flags & HTTP2_FLAG_END_HEADERS) ? endHeaderBlock() : true;
+    }
+
+    bool Session::endHeaderBlock() {
+        const uint32_t streamId = headerBlockStreamId;
+        headerBlockStreamId = 0;
+
+        // Every block is decoded, even for streams that are refused, to keep the table in sync
+        header_list_t fields;
+        const bool isDecoded = decoder.decode(reinterpret_cast<const uint8_t*>(headerBlock.data()), headerBlock.size(), fields);
+        headerBlock.clear();
+        if (!isDecoded) return connectionError(H2_COMPRESSION_ERROR);
+
+        // Trailers, which are otherwise ignored
+        if (Stream* pStream = findStream(streamId)) {
+            if (pStream->isRemoteClosed) {
+                closeStream(streamId, H2_STREAM_CLOSED);
+            } else if (!headerBlockEndsStream) {
+                closeStream(streamId, H2_PROTOCOL_ERROR);
+            } else {
+                pStream->isRemoteClosed = true;
+                if (!pStream->isRequestDone) finishRequest(*pStream);
+            }
+            return true;
+        }
+
+        // New streams must use increasing ids
+        if (streamId <= lastClientStreamId) return connectionError(H2_STREAM_CLOSED);
+        lastClientStreamId = streamId;
+        if (isGoingAway) return true;
+
+        if (streams.size() >= maxConcurrentStreams) {
+            closeStream(streamId, H2_REFUSED_STREAM);
+            return true;
+        }
+
+        if (!isValidRequest(fields)) {
+            closeStream(streamId, H2_PROTOCOL_ERROR);
+            return true;
+        }
+
+        auto pStream = std::make_unique<Stream>(streamId, peerInitialWindowSize);
+        pStream->headers = std::move(fields);
+        Stream& stream = *(streams[streamId] = std::move(pStream));
+
+        if (headerBlockEndsStream) {
+            stream.isRemoteClosed = true;
+            finishRequest(stream);
+        }
+        return true;
+    }
+
+    bool Session::handleSettings(const uint8_t flags, const uint32_t streamId, const uint8_t* payload, const uint32_t length) {
+        if (streamId != 0) return connectionError(H2_PROTOCOL_ERROR);
+        if (flags & HTTP2_FLAG_ACK)
+            return length == 0 ? true : connectionError(H2_FRAME_SIZE_ERROR);
+        if (length % 6 != 0) return connectionError(H2_FRAME_SIZE_ERROR);
+
+        for (uint32_t i = 0; i < length; i += 6) {
+            const uint16_t id = static_cast<uint16_t>((payload[i] << 8) | payload[i + 1]);
+            const uint32_t value = readUint32(payload + i + 2);
+
+            switch (id) {
+                case SETTINGS_HEADER_TABLE_SIZE:
+                    encoder.setMaxTableSize(value);
+                    break;
+                case SETTINGS_ENABLE_PUSH: // Never used by the server, but must still be valid
+                    if (value > 1) return connectionError(H2_PROTOCOL_ERROR);
+                    break;
+                case SETTINGS_INITIAL_WINDOW_SIZE: {
+                    if (value > HTTP2_MAX_WINDOW_SIZE) return connectionError(H2_FLOW_CONTROL_ERROR);
+
+                    // Applies to every open stream's window as well
+                    const int64_t delta = static_cast<int64_t>(value) - peerInitialWindowSize;
+                    for (auto& [id, pStream] : streams)
+                        if ((pStream->sendWindow += delta) > HTTP2_MAX_WINDOW_SIZE)
+                            return connectionError(H2_FLOW_CONTROL_ERROR);
+                    peerInitialWindowSize = value;
+                    break;
+                }
+                case SETTINGS_MAX_FRAME_SIZE:
+                    if (value < HTTP2_MIN_MAX_FRAME_SIZE || value > HTTP2_MAX_MAX_FRAME_SIZE)
+                        return connectionError(H2_PROTOCOL_ERROR);
+                    peerMaxFrameSize = value;
+                    break;
+                default: // Unknown or unused settings are ignored
+                    break;
+            }
+        }
+
+        isSettingsReceived = true;
+        writeFrameHeader(0, FRAME_SETTINGS, HTTP2_FLAG_ACK, 0);
+        return true;
+    }
+
+    bool Session::handleWindowUpdate(const uint32_t streamId, const uint8_t* payload, const uint32_t length) {
+        if (length != 4) return connectionError(H2_FRAME_SIZE_ERROR);
+        const uint32_t increment = readUint32(payload) & HTTP2_MAX_WINDOW_SIZE;
+
+        if (streamId == 0) {
+            if (increment == 0) return connectionError(H2_PROTOCOL_ERROR);
+            if ((connSendWindow += increment) > HTTP2_MAX_WINDOW_SIZE) return connectionError(H2_FLOW_CONTROL_ERROR);
+            return true;
+        }
+
+        if (streamId > lastClientStreamId) return connectionError(H2_PROTOCOL_ERROR);
+        Stream* pStream = findStream(streamId);
+        if (pStream == nullptr) return true; // Already closed
+
+        if (increment == 0)
+            closeStream(streamId, H2_PROTOCOL_ERROR);
+        else if ((pStream->sendWindow += increment) > HTTP2_MAX_WINDOW_SIZE)
+            closeStream(streamId, H2_FLOW_CONTROL_ERROR);
+        return true;
+    }
+
+    void Session::finishRequest(Stream& stream) {
+        // A Content-Length that doesn't match the DATA received makes the request malformed
+        if (stream.isRemoteClosed && stream.bodySize <= maxRequestBody && !isContentLengthMatched(stream.headers, stream.bodySize)) {
+            closeStream(stream.id, H2_PROTOCOL_ERROR);
+            return;
+        }
+
+        stream.isRequestDone = true;
+        readyStreams.push_back(stream.id);
+    }
+
+    Stream* Session::nextRequest() {
+        while (!readyStreams.empty()) {
+            Stream* pStream = findStream(readyStreams.front());
+            readyStreams.pop_front();
+            if (pStream != nullptr) return pStream; // Otherwise, reset by the client
+        }
+        return nullptr;
+    }
+
+    void Session::respond(Stream& stream, std::unique_ptr<Response> pResponse, const bool hasBody) {
+        header_list_t fields;
+        fields.emplace_back(":status", std::to_string(pResponse->getStatus()));
+        for (const auto& [name, value] : pResponse->getHeaders()) {
+            std::string lowerName(name);
+            std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), [](const unsigned char c) { return std::tolower(c); });
+            if (!isConnectionSpecificField(lowerName))
+                fields.emplace_back(std::move(lowerName), value);
+        }
+
+        std::string block;
+        encoder.encode(fields, block);
+
+        // Split the block across CONTINUATION frames if needed
+        size_t offset = 0;
+        do {
+            const size_t fragmentSize = (std::min)(block.size() - offset, static_cast<size_t>(peerMaxFrameSize));
+            uint8_t flags = offset + fragmentSize == block.size() ? HTTP2_FLAG_END_HEADERS : 0;
+            if (offset == 0 && !hasBody) flags |= HTTP2_FLAG_END_STREAM;
+
+            writeFrameHeader(fragmentSize, offset == 0 ? FRAME_HEADERS : FRAME_CONTINUATION, flags, stream.id);
+            output.append(block, offset, fragmentSize);
+            offset += fragmentSize;
+        } while (offset < block.size());
+
+        if (!hasBody) {
+            closeStream(stream.id, H2_NO_ERROR);
+            return;
+        }
+
+        stream.pResponse = std::move(pResponse);
+        sendQueue.push_back(stream.id);
+    }
+
+    void Session::fillOutput(const size_t maxBytes) {
+        const size_t targetSize = output.size() + maxBytes;
+
+        bool isProgress = true;
+        while (isProgress && output.size() < targetSize && !sendQueue.empty()) {
+            isProgress = false;
+
+            // Each stream w/ a response in progress gets one frame per turn
+            for (size_t i = sendQueue.size(); i > 0 && output.size() < targetSize; --i) {
+                const uint32_t streamId = sendQueue.front();
+                sendQueue.pop_front();
+
+                Stream* pStream = findStream(streamId);
+                if (pStream == nullptr) continue; // Reset by the client
+
+                switch (sendData(*pStream)) {
+                    case DATA_SENT:
+                        isProgress = true;
+                        sendQueue.push_back(streamId);
+                        break;
+                    case DATA_BLOCKED:
+                        sendQueue.push_back(streamId);
+                        break;
+                    case DATA_DONE:
+                        isProgress = true;
+                        closeStream(streamId, H2_NO_ERROR);
+                        break;
+                    case DATA_FAILED:
+                        isProgress = true;
+                        closeStream(streamId, H2_INTERNAL_ERROR);
+                        break;
+                }
+            }
+        }
+    }
+
+    int Session::sendData(Stream& stream) {
+        // Pull the next piece of the body once the last one is sent
+        if (stream.pendingOffset == stream.pendingSize && !stream.isBodyDone) {
+            const ssize_t bytesRead = stream.pResponse->readBodyChunk(stream.pPending, stream.isBodyDone);
+            if (bytesRead < 0) return DATA_FAILED;
+
+            stream.pendingSize = static_cast<size_t>(bytesRead);
+            stream.pendingOffset = 0;
+            if (bytesRead == 0 && !stream.isBodyDone) return DATA_SENT; // ie. the compressor is holding onto its input
+        }
+
+        // Empty DATA frames aren't flow controlled
+        const size_t remaining = stream.pendingSize - stream.pendingOffset;
+        if (remaining == 0) {
+            writeFrameHeader(0, FRAME_DATA, HTTP2_FLAG_END_STREAM, stream.id);
+            return DATA_DONE;
+        }
+
+        const int64_t window = (std::min)(stream.sendWindow, connSendWindow);
+        if (window <= 0) return DATA_BLOCKED;
+
+        const size_t frameSize = (std::min)({ remaining, static_cast<size_t>(window), static_cast<size_t>(peerMaxFrameSize) });
+        const bool isEndStream = stream.isBodyDone && frameSize == remaining;
+        writeFrameHeader(frameSize, FRAME_DATA, isEndStream ? HTTP2_FLAG_END_STREAM : 0, stream.id);
+        output.append(stream.pPending + stream.pendingOffset, frameSize);
+
+        stream.pendingOffset += frameSize;
+        stream.sendWindow -= static_cast<int64_t>(frameSize);
+        connSendWindow -= static_cast<int64_t>(frameSize);
+        return isEndStream ? DATA_DONE : DATA_SENT;
+    }
+
+    bool Session::canSend() const {
+        if (!output.empty()) return true;
+
+        for (const uint32_t streamId : sendQueue) {
+            const auto itr = streams.find(streamId);
+            if (itr == streams.end()) continue;
+
+            const Stream& stream = *itr->second;
+            if (stream.pendingOffset == stream.pendingSize) return true; // Needs another read, or its END_STREAM
+            if (stream.sendWindow > 0 && connSendWindow > 0) return true;
+        }
+        return false;
+    }
+
+    void Session::goAway(const ERROR_CODE error) {
+        if (_isClosed) return;
+
+        writeFrameHeader(8, FRAME_GOAWAY, 0, 0);
+        appendUint32(output, lastClientStreamId);
+        appendUint32(output, error);
+        isGoingAway = _isClosed = true;
+    }
+
+    void Session::closeStream(const uint32_t streamId, const ERROR_CODE error) {
+        // A response sent before the whole request arrived also cancels the rest of the request (RFC 9113 8.1)
+        const Stream* pStream = findStream(streamId);
+        if (error != H2_NO_ERROR || pStream == nullptr || !pStream->isRemoteClosed) {
+            writeFrameHeader(4, FRAME_RST_STREAM, 0, streamId);
+            appendUint32(output, error);
+        } else if (clientResets > 0) {
+            --clientResets; // Answered in full
+        }
+        streams.erase(streamId);
+    }
+
+    bool Session::connectionError(const ERROR_CODE error) {
+        goAway(error);
+        return false;
+    }
+
+    Stream* Session::findStream(const uint32_t streamId) {
+        const auto itr = streams.find(streamId);
+        return itr == streams.end() ? nullptr : itr->second.get();
+    }
+
+    void Session::writeFrameHeader(const size_t length, const FRAME_TYPE type, const uint8_t flags, const uint32_t streamId) {
+        output.push_back(static_cast<char>(length >> 16));
+        output.push_back(static_cast<char>(length >> 8));
+        output.push_back(static_cast<char>(length));
+        output.push_back(static_cast<char>(type));
+        output.push_back(static_cast<char>(flags));
+        appendUint32(output, streamId);
+    }
+
+    void Session::writeWindowUpdate(const uint32_t streamId, const uint32_t increment) {
+        writeFrameHeader(4, FRAME_WINDOW_UPDATE, 0, streamId);
+        appendUint32(output, increment);
+    }
+
+}
+
+#undef DATA_SENT
+#undef DATA_BLOCKED
+#undef DATA_DONE
+#undef DATA_FAILED
+#undef CRLF
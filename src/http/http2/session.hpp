@@ -0,0 +1,207 @@
+#ifndef __HTTP_HTTP2_SESSION_HPP
+#define __HTTP_HTTP2_SESSION_HPP
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "hpack.hpp"
+#include "../request_body.hpp"
+#include "../response.hpp"
+
+#define HTTP2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define HTTP2_PREFACE_SIZE 24
+#define HTTP2_FRAME_HEADER_SIZE 9
+#define HTTP2_DEFAULT_WINDOW_SIZE 65535
+#define HTTP2_MAX_WINDOW_SIZE 0x7fffffff
+#define HTTP2_MIN_MAX_FRAME_SIZE 16384 // Also the largest frame we accept, since we never raise it
+#define HTTP2_MAX_MAX_FRAME_SIZE 0xffffff
+#define HTTP2_MAX_HEADER_BLOCK_SIZE 65536 // Larger header blocks (incl. CONTINUATIONs) close the connection
+#define HTTP2_MAX_CLIENT_RESETS 100 // Streams the client may cancel early, past what it lets finish, before it's cut off
+
+// Frame flags
+#define HTTP2_FLAG_END_STREAM  0x01
+#define HTTP2_FLAG_ACK         0x01
+#define HTTP2_FLAG_END_HEADERS 0x04
+#define HTTP2_FLAG_PADDED      0x08
+#define HTTP2_FLAG_PRIORITY    0x20
+
+namespace http::http2 {
+
+    enum FRAME_TYPE {
+        FRAME_DATA = 0x0,
+        FRAME_HEADERS = 0x1,
+        FRAME_PRIORITY = 0x2,
+        FRAME_RST_STREAM = 0x3,
+        FRAME_SETTINGS = 0x4,
+        FRAME_PUSH_PROMISE = 0x5,
+        FRAME_PING = 0x6,
+        FRAME_GOAWAY = 0x7,
+        FRAME_WINDOW_UPDATE = 0x8,
+        FRAME_CONTINUATION = 0x9
+    };
+
+    // Prefixed to stay clear of Windows' NO_ERROR macro
+    enum ERROR_CODE {
+        H2_NO_ERROR = 0x0,
+        H2_PROTOCOL_ERROR = 0x1,
+        H2_INTERNAL_ERROR = 0x2,
+        H2_FLOW_CONTROL_ERROR = 0x3,
+        H2_STREAM_CLOSED = 0x5,
+        H2_FRAME_SIZE_ERROR = 0x6,
+        H2_REFUSED_STREAM = 0x7,
+        H2_CANCEL = 0x8,
+        H2_COMPRESSION_ERROR = 0x9,
+        H2_ENHANCE_YOUR_CALM = 0xb
+    };
+
+    enum SETTING {
+        SETTINGS_HEADER_TABLE_SIZE = 0x1,
+        SETTINGS_ENABLE_PUSH = 0x2,
+        SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+        SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+        SETTINGS_MAX_FRAME_SIZE = 0x5
+    };
+
+    // Connection-specific fields have no meaning in HTTP/2 (RFC 9113 8.2.2)
+    bool isConnectionSpecificField(const std::string_view name);
+
+    // Checks the request fields are well-formed, returns false for a malformed request (a stream error)
+    // HTTP/3 shares HTTP/2's field rules (RFC 9114 4.2)
+    bool isValidRequest(const header_list_t& headers);
+
+    // Checks every Content-Length field is a number equal to the body's size (leading zeros are fine), returns false for a malformed request
+    bool isContentLengthMatched(const header_list_t& headers, const size_t bodySize);
+
+    // Frames a request's head as HTTP/1.1, so it goes through the same parser & handlers as any other request
+    // The body is handed to them separately, only its size is framed
+    void toHTTP1Request(const header_list_t& headers, const size_t bodySize, std::string& raw);
+
+    // A single request/response exchange, multiplexed w/ the others on its connection
+    class Stream {
+        public:
+            Stream(const uint32_t id, const int64_t sendWindow) : id(id), sendWindow(sendWindow) {};
+
+            void toHTTP1Request(std::string& raw) const;
+
+            const uint32_t id;
+
+            // Request fields, pseudo-headers first (already validated)
+            header_list_t headers;
+
+            // Bytes past MaxRequestBody are counted but not kept, so the request is answered w/ 413
+            RequestBody body;
+            size_t bodySize = 0;
+
+            bool isRemoteClosed = false; // The client sent END_STREAM
+            bool isRequestDone = false; // Queued to be answered (once closed, or once the body is too large)
+
+            // Flow control windows, in bytes
+            int64_t sendWindow;
+            int64_t recvWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+
+            // Response body, pulled a chunk at a time & sent as the send window allows
+            std::unique_ptr<Response> pResponse;
+            const char* pPending = nullptr;
+            size_t pendingSize = 0, pendingOffset = 0;
+            bool isBodyDone = false;
+    };
+
+    // Protocol state for one HTTP/2 connection, which only deals in bytes so the server is free to drive the socket
+    // Requests are answered in the order they arrive, but response DATA frames take turns between streams
+    class Session {
+        public:
+            Session(const uint32_t maxConcurrentStreams, const size_t maxRequestBody);
+
+            // Consumes bytes from the client, starting w/ the connection preface
+            // Returns false on a connection error, once a GOAWAY is queued (the connection should close after sending it)
+            bool receive(const char* data, const size_t size);
+
+            // Returns the next stream whose request is ready to be answered, or nullptr
+            Stream* nextRequest();
+
+            // Queues the response headers, the body (if any) is then sent by fillOutput
+            // prepareBody must already be called on the response
+            void respond(Stream& stream, std::unique_ptr<Response> pResponse, const bool hasBody);
+
+            // Abandons a stream whose request couldn't be answered
+            inline void resetStream(Stream& stream, const ERROR_CODE error) { this->closeStream(stream.id, error); };
+
+            // Queues up to about maxBytes of response DATA frames, one frame per stream per turn
+            void fillOutput(const size_t maxBytes);
+
+            // Frames waiting to be written to the socket
+            inline std::string& getOutput() { return output; };
+
+            // True if fillOutput can make progress without hearing from the client (ie. a send window reopening)
+            bool canSend() const;
+
+            // Sends a GOAWAY, after which the connection should be closed
+            void goAway(const ERROR_CODE error);
+
+            inline bool isClosed() const { return _isClosed || (isPeerGoingAway && streams.empty()); };
+        private:
+            bool handleFrame(const uint8_t type, const uint8_t flags, const uint32_t streamId, const uint8_t* payload, const uint32_t length);
+            bool handleData(const uint8_t flags, const uint32_t streamId, const uint8_t* payload, const uint32_t length);
+            bool handleHeaders(const uint8_t flags, const uint32_t streamId, const uint8_t* payload, const uint32_t length);
+            bool handleContinuation(const uint8_t flags, const uint8_t* payload, const uint32_t length);
+            bool handleSettings(const uint8_t flags, const uint32_t streamId, const uint8_t* payload, const uint32_t length);
+            bool handleWindowUpdate(const uint32_t streamId, const uint8_t* payload, const uint32_t length);
+            bool endHeaderBlock();
+
+            // Queues the stream to be answered, validating the body against any Content-Length
+            void finishRequest(Stream& stream);
+
+            // Sends the stream's next DATA frame, returns one of the DATA_* statuses
+            int sendData(Stream& stream);
+
+            // Removes the stream, w/ a RST_STREAM unless error is H2_NO_ERROR & both sides have ended it
+            void closeStream(const uint32_t streamId, const ERROR_CODE error);
+            bool connectionError(const ERROR_CODE error);
+
+            Stream* findStream(const uint32_t streamId);
+            void writeFrameHeader(const size_t length, const FRAME_TYPE type, const uint8_t flags, const uint32_t streamId);
+            void writeWindowUpdate(const uint32_t streamId, const uint32_t increment);
+
+            const uint32_t maxConcurrentStreams;
+            const size_t maxRequestBody;
+
+            std::string input; // Bytes received but not yet parsed (ie. a partial frame)
+            std::string output;
+            bool isPrefaceReceived = false;
+            bool isSettingsReceived = false;
+
+            std::unordered_map<uint32_t, std::unique_ptr<Stream>> streams;
+            uint32_t lastClientStreamId = 0;
+            std::deque<uint32_t> readyStreams; // Requests waiting to be answered
+            std::deque<uint32_t> sendQueue; // Streams w/ response DATA left to send, in turn order
+
+            // A header block split across HEADERS & CONTINUATION frames
+            uint32_t headerBlockStreamId = 0;
+            std::string headerBlock;
+            bool headerBlockEndsStream = false;
+
+            HPACKDecoder decoder;
+            HPACKEncoder encoder;
+
+            // Connection-level flow control & the client's settings
+            int64_t connSendWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+            int64_t connRecvWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+            int64_t peerInitialWindowSize = HTTP2_DEFAULT_WINDOW_SIZE;
+            uint32_t peerMaxFrameSize = HTTP2_MIN_MAX_FRAME_SIZE;
+
+            // Streams cancelled by the client before their response was sent, less those it let finish
+            // Cancelling a stream frees its slot right away, so this (not maxConcurrentStreams) bounds Rapid Reset (CVE-2023-44487)
+            uint32_t clientResets = 0;
+
+            bool isPeerGoingAway = false;
+            bool isGoingAway = false;
+            bool _isClosed = false;
+    };
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include "qpack.hpp"
+
+namespace http::http3 {
+
+    using http2::decodeInteger;
+    using http2::decodeString;
+    using http2::encodeInteger;
+    using http2::encodeString;
+
+    // RFC 9204 Appendix A, index 0 is the first entry
+    static const header_field_view_t STATIC_TABLE[QPACK_STATIC_TABLE_SIZE] = {
+        { ":authority", "" },
+        { ":path", "/" },
+        { "age", "0" },
+        { "content-disposition", "" },
+        { "content-length", "0" },
+        { "cookie", "" },
+        { "date", "" },
+        { "etag", "" },
+        { "if-modified-since", "" },
+        { "if-none-match", "" },
+        { "last-modified", "" },
+        { "link", "" },
+        { "location", "" },
+        { "referer", "" },
+        { "set-cookie", "" },
+        { ":method", "CONNECT" },
+        { ":method", "DELETE" },
+        { ":method", "GET" },
+        { ":method", "HEAD" },
+        { ":method", "OPTIONS" },
+        { ":method", "POST" },
+        { ":method", "PUT" },
+        { ":scheme", "http" },
+        { ":scheme", "https" },
+        { ":status", "103" },
+        { ":status", "200" },
+        { ":status", "304" },
+        { ":status", "404" },
+        { ":status", "503" },
+        { "accept", "*/*" },
+        { "accept", "application/dns-message" },
+        { "accept-encoding", "gzip, deflate, br" },
+        { "accept-ranges", "bytes" },
+        { "access-control-allow-headers", "cache-control" },
+        { "access-control-allow-headers", "content-type" },
+        { "access-control-allow-origin", "*" },
+        { "cache-control", "max-age=0" },
+        { "cache-control", "max-age=2592000" },
+        { "cache-control", "max-age=604800" },
+        { "cache-control", "no-cache" },
+        { "cache-control", "no-store" },
+        { "cache-control", "public, max-age=31536000" },
+        { "content-encoding", "br" },
+        { "content-encoding", "gzip" },
+        { "content-type", "application/dns-message" },
+        { "content-type", "application/javascript" },
+        { "content-type", "application/json" },
+        { "content-type", "application/x-www-form-urlencoded" },
+        { "content-type", "image/gif" },
+        { "content-type", "image/jpeg" },
+        { "content-type", "image/png" },
+        { "content-type", "text/css" },
+        { "content-type", "text/html; charset=utf-8" },
+        { "content-type", "text/plain" },
+        { "content-type", "text/plain;charset=utf-8" },
+        { "range", "bytes=0-" },
+        { "strict-transport-security", "max-age=31536000" },
+        { "strict-transport-security", "max-age=31536000; includesubdomains" },
+        { "strict-transport-security", "max-age=31536000; includesubdomains; preload" },
+        { "vary", "accept-encoding" },
+        { "vary", "origin" },
+        { "x-content-type-options", "nosniff" },
+        { "x-xss-protection", "1; mode=block" },
+        { ":status", "100" },
+        { ":status", "204" },
+        { ":status", "206" },
+        { ":status", "302" },
+        { ":status", "400" },
+        { ":status", "403" },
+        { ":status", "421" },
+        { ":status", "425" },
+        { ":status", "500" },
+        { "accept-language", "" },
+        { "access-control-allow-credentials", "FALSE" },
+        { "access-control-allow-credentials", "TRUE" },
+        { "access-control-allow-headers", "*" },
+        { "access-control-allow-methods", "get" },
+        { "access-control-allow-methods", "get, post, options" },
+        { "access-control-allow-methods", "options" },
+        { "access-control-expose-headers", "content-length" },
+        { "access-control-request-headers", "content-type" },
+        { "access-control-request-method", "get" },
+        { "access-control-request-method", "post" },
+        { "alt-svc", "clear" },
+        { "authorization", "" },
+        { "content-security-policy", "script-src 'none'; object-src 'none'; base-uri 'none'" },
+        { "early-data", "1" },
+        { "expect-ct", "" },
+        { "forwarded", "" },
+        { "if-range", "" },
+        { "origin", "" },
+        { "purpose", "prefetch" },
+        { "server", "" },
+        { "timing-allow-origin", "*" },
+        { "upgrade-insecure-requests", "1" },
+        { "user-agent", "" },
+        { "x-forwarded-for", "" },
+        { "x-frame-options", "deny" },
+        { "x-frame-options", "sameorigin" }
+    };
+
+    /************************** Decoder **************************/
+
+    bool QPACKDecoder::decode(const uint8_t* data, const size_t size, header_list_t& headers) {
+        const uint8_t* p = data;
+        const uint8_t* pEnd = data + size;
+
+        // Section prefix, the Required Insert Count must be 0 since we never allow a dynamic table
+        size_t requiredInsertCount, deltaBase;
+        if (!decodeInteger(p, pEnd, 8, requiredInsertCount) || requiredInsertCount != 0) return false;
+        if (!decodeInteger(p, pEnd, 7, deltaBase)) return false;
+
+        while (p < pEnd) {
+            const uint8_t prefix = *p;
+
+            if (prefix & 0x80) { // Indexed field line, T (0x40) set for the static table
+                size_t index;
+                if (!(prefix & 0x40) || !decodeInteger(p, pEnd, 6, index) || index >= QPACK_STATIC_TABLE_SIZE) return false;
+                headers.emplace_back(STATIC_TABLE[index].first, STATIC_TABLE[index].second);
+            } else if (prefix & 0x40) { // Literal w/ name reference, T (0x10) set for the static table
+                size_t index;
+                if (!(prefix & 0x10) || !decodeInteger(p, pEnd, 4, index) || index >= QPACK_STATIC_TABLE_SIZE) return false;
+
+                header_field_t& entry = headers.emplace_back(STATIC_TABLE[index].first, std::string());
+                if (!decodeString(p, pEnd, 7, entry.second)) return false;
+            } else if (prefix & 0x20) { // Literal w/ literal name, whose Huffman flag sits above a 3-bit prefix
+                header_field_t& entry = headers.emplace_back();
+                if (!decodeString(p, pEnd, 3, entry.first) || !decodeString(p, pEnd, 7, entry.second)) return false;
+            } else { // Post-base references only point into the dynamic table
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /************************** Encoder **************************/
+
+    void QPACKEncoder::encode(const header_list_t& headers, std::string& out) {
+        // Required Insert Count & Delta Base are both 0
+        out.push_back(0);
+        out.push_back(0);
+
+        for (const auto& [name, value] : headers) {
+            size_t nameIndex = QPACK_STATIC_TABLE_SIZE;
+            bool isExactMatch = false;
+            for (size_t i = 0; i < QPACK_STATIC_TABLE_SIZE; ++i) {
+                if (STATIC_TABLE[i].first != name) continue;
+                if (STATIC_TABLE[i].second == value) {
+                    nameIndex = i;
+                    isExactMatch = true;
+                    break;
+                }
+                if (nameIndex == QPACK_STATIC_TABLE_SIZE) nameIndex = i;
+            }
+
+            if (isExactMatch) {
+                encodeInteger(out, 0xc0, 6, nameIndex);
+                continue;
+            }
+
+            if (nameIndex < QPACK_STATIC_TABLE_SIZE)
+                encodeInteger(out, 0x50, 4, nameIndex);
+            else
+                encodeString(out, 0x20, 3, name);
+            encodeString(out, 0x00, 7, value);
+        }
+    }
+
+}
@@ -0,0 +1,36 @@
+#ifndef __HTTP_HTTP3_QPACK_HPP
+#define __HTTP_HTTP3_QPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../http2/hpack.hpp"
+
+#define QPACK_STATIC_TABLE_SIZE 99
+
+namespace http::http3 {
+
+    using http2::header_field_t;
+    using http2::header_list_t;
+    using http2::header_field_view_t;
+
+    // QPACK w/ only the static table (RFC 9204)
+    // We advertise a dynamic table capacity of 0 & never use one either, so field sections never wait on the encoder
+    // streams & each section can be decoded on its own
+    class QPACKDecoder {
+        public:
+            // Appends every field in a complete field section to headers
+            // Returns false on a malformed section, which is a connection error (QPACK_DECOMPRESSION_FAILED)
+            static bool decode(const uint8_t* data, const size_t size, header_list_t& headers);
+    };
+
+    class QPACKEncoder {
+        public:
+            // Appends the encoded field section to out, names must already be lowercase
+            static void encode(const header_list_t& headers, std::string& out);
+    };
+
+}
+
+#endif
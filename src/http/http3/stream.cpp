@@ -0,0 +1,210 @@
+#include "stream.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include "../http2/session.hpp"
+
+namespace http::http3 {
+
+    bool decodeVarint(const uint8_t*& p, const uint8_t* pEnd, uint64_t& value) {
+        if (p == pEnd) return false;
+
+        // The top 2 bits give the length, 1 to 8 bytes
+        const size_t length = static_cast<size_t>(1) << (*p >> 6);
+        if (static_cast<size_t>(pEnd - p) < length) return false;
+
+        value = *p++ & 0x3f;
+        for (size_t i = 1; i < length; ++i)
+            value = (value << 8) | *p++;
+        return true;
+    }
+
+    void appendVarint(std::string& out, const uint64_t value) {
+        int length;
+        uint8_t lengthBits;
+        if (value < 0x40) { length = 1; lengthBits = 0x00; }
+        else if (value < 0x4000) { length = 2; lengthBits = 0x40; }
+        else if (value < 0x40000000) { length = 4; lengthBits = 0x80; }
+        else { length = 8; lengthBits = 0xc0; }
+
+        for (int i = length - 1; i >= 0; --i) {
+            uint8_t byte = static_cast<uint8_t>(value >> (i * 8));
+            if (i == length - 1) byte = (byte & 0x3f) | lengthBits;
+            out.push_back(static_cast<char>(byte));
+        }
+    }
+
+    static inline void appendFrameHeader(std::string& out, const FRAME_TYPE type, const uint64_t length) {
+        appendVarint(out, type);
+        appendVarint(out, length);
+    }
+
+    void writeControlStreamPreface(std::string& out) {
+        std::string settings;
+        appendVarint(settings, SETTINGS_MAX_FIELD_SECTION_SIZE);
+        appendVarint(settings, HTTP3_MAX_FIELD_SECTION_SIZE);
+
+        appendVarint(out, STREAM_CONTROL);
+        appendFrameHeader(out, FRAME_SETTINGS, settings.size());
+        out.append(settings);
+    }
+
+    /************************** Request **************************/
+
+    ERROR_CODE RequestStream::receive(const char* data, const size_t size) {
+        if (_isRequestDone) return H3_NO_ERROR; // ie. the rest of a body that's too large
+        input.append(data, size);
+
+        size_t offset = 0;
+        ERROR_CODE error = H3_NO_ERROR;
+        bool isFrameIncomplete = false;
+        while (error == H3_NO_ERROR && !_isRequestDone && !isFrameIncomplete && offset < input.size()) {
+            const size_t available = input.size() - offset;
+
+            // The rest of a DATA frame, kept until the body is too large to accept
+            if (dataRemaining > 0) {
+                const size_t dataSize = static_cast<size_t>((std::min)(dataRemaining, static_cast<uint64_t>(available)));
+                bodySize += dataSize;
+                if (bodySize > maxRequestBody) {
+                    body.clear();
+                    error = finishRequest();
+                } else if (!body.append(input.data() + offset, dataSize)) {
+                    return H3_INTERNAL_ERROR; // ie. the body couldn't be spilled to disk
+                }
+
+                offset += dataSize;
+                dataRemaining -= dataSize;
+                continue;
+            }
+
+            if (skipRemaining > 0) {
+                const size_t skipSize = static_cast<size_t>((std::min)(skipRemaining, static_cast<uint64_t>(available)));
+                offset += skipSize;
+                skipRemaining -= skipSize;
+                continue;
+            }
+
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(input.data()) + offset;
+            const uint8_t* pEnd = reinterpret_cast<const uint8_t*>(input.data()) + input.size();
+            uint64_t type, length;
+            if (!decodeVarint(p, pEnd, type) || !decodeVarint(p, pEnd, length)) break; // Wait for the rest of the frame header
+            const size_t headerSize = p - (reinterpret_cast<const uint8_t*>(input.data()) + offset);
+
+            switch (type) {
+                case FRAME_DATA:
+                    if (!isHeadersReceived || isTrailersReceived) return H3_FRAME_UNEXPECTED;
+                    dataRemaining = length;
+                    offset += headerSize;
+                    break;
+                case FRAME_HEADERS:
+                    if (length > HTTP3_MAX_FIELD_SECTION_SIZE) return H3_EXCESSIVE_LOAD;
+                    if (available - headerSize < length) { // Wait for the whole field section
+                        isFrameIncomplete = true;
+                        break;
+                    }
+
+                    error = handleHeaders(p, static_cast<size_t>(length));
+                    offset += headerSize + static_cast<size_t>(length);
+                    break;
+                case FRAME_CANCEL_PUSH:
+                case FRAME_SETTINGS:
+                case FRAME_PUSH_PROMISE:
+                case FRAME_GOAWAY:
+                case FRAME_MAX_PUSH_ID:
+                case 0x2: case 0x6: case 0x8: case 0x9: // Reserved, since they're HTTP/2 frame types
+                    return H3_FRAME_UNEXPECTED;
+                default: // Unknown & reserved (greasing) frame types must be ignored
+                    skipRemaining = length;
+                    offset += headerSize;
+                    break;
+            }
+        }
+
+        if (_isRequestDone) input.clear(); // The rest is ignored
+        else input.erase(0, offset);
+        return error;
+    }
+
+    ERROR_CODE RequestStream::handleHeaders(const uint8_t* payload, const size_t length) {
+        if (isTrailersReceived) return H3_FRAME_UNEXPECTED;
+
+        header_list_t fields;
+        if (!QPACKDecoder::decode(payload, length, fields)) return H3_QPACK_DECOMPRESSION_FAILED;
+
+        // Trailers, which are otherwise ignored
+        if (isHeadersReceived) {
+            isTrailersReceived = true;
+            return H3_NO_ERROR;
+        }
+
+        if (!http2::isValidRequest(fields)) return H3_MESSAGE_ERROR;
+        headers = std::move(fields);
+        isHeadersReceived = true;
+        return H3_NO_ERROR;
+    }
+
+    ERROR_CODE RequestStream::finish() {
+        if (_isRequestDone) return H3_NO_ERROR;
+
+        // The stream can't end partway through a frame
+        if (!isHeadersReceived) return H3_REQUEST_INCOMPLETE;
+        if (!input.empty() || dataRemaining > 0 || skipRemaining > 0) return H3_FRAME_ERROR;
+
+        // A Content-Length that doesn't match the DATA received makes the request malformed
+        if (!http2::isContentLengthMatched(headers, bodySize))
+            return H3_MESSAGE_ERROR;
+
+        return finishRequest();
+    }
+
+    ERROR_CODE RequestStream::finishRequest() {
+        _isRequestDone = true;
+        return H3_NO_ERROR;
+    }
+
+    void RequestStream::toHTTP1Request(std::string& raw) const {
+        http2::toHTTP1Request(headers, bodySize, raw);
+    }
+
+    /************************** Response **************************/
+
+    void RequestStream::respond(std::unique_ptr<Response> pResponse, const bool hasBody) {
+        header_list_t fields;
+        fields.emplace_back(":status", std::to_string(pResponse->getStatus()));
+        for (const auto& [name, value] : pResponse->getHeaders()) {
+            std::string lowerName(name);
+            std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), [](const unsigned char c) { return std::tolower(c); });
+            if (!http2::isConnectionSpecificField(lowerName))
+                fields.emplace_back(std::move(lowerName), value);
+        }
+
+        std::string block;
+        QPACKEncoder::encode(fields, block);
+        appendFrameHeader(output, FRAME_HEADERS, block.size());
+        output.append(block);
+
+        _isResponding = true;
+        if (hasBody) this->pResponse = std::move(pResponse);
+    }
+
+    bool RequestStream::fillOutput(const size_t maxBytes) {
+        const size_t targetSize = output.size() + maxBytes;
+
+        // QUIC does the flow control, so each chunk of the body becomes a DATA frame as soon as it's read
+        while (pResponse != nullptr && output.size() < targetSize) {
+            const char* pData;
+            bool isLast = false;
+            const ssize_t bytesRead = pResponse->readBodyChunk(pData, isLast);
+            if (bytesRead < 0) return false;
+
+            if (bytesRead > 0) {
+                appendFrameHeader(output, FRAME_DATA, static_cast<size_t>(bytesRead));
+                output.append(pData, static_cast<size_t>(bytesRead));
+            }
+            if (isLast) pResponse.reset();
+        }
+        return true;
+    }
+
+}
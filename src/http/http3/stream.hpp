@@ -0,0 +1,120 @@
+#ifndef __HTTP_HTTP3_STREAM_HPP
+#define __HTTP_HTTP3_STREAM_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "qpack.hpp"
+#include "../request_body.hpp"
+#include "../response.hpp"
+
+#define HTTP3_MAX_FIELD_SECTION_SIZE 65536 // Larger HEADERS frames reset the stream, also advertised in our SETTINGS
+
+namespace http::http3 {
+
+    enum FRAME_TYPE {
+        FRAME_DATA = 0x0,
+        FRAME_HEADERS = 0x1,
+        FRAME_CANCEL_PUSH = 0x3,
+        FRAME_SETTINGS = 0x4,
+        FRAME_PUSH_PROMISE = 0x5,
+        FRAME_GOAWAY = 0x7,
+        FRAME_MAX_PUSH_ID = 0xd
+    };
+
+    // The first varint on every unidirectional stream
+    enum STREAM_TYPE {
+        STREAM_CONTROL = 0x0,
+        STREAM_PUSH = 0x1,
+        STREAM_QPACK_ENCODER = 0x2,
+        STREAM_QPACK_DECODER = 0x3
+    };
+
+    // Prefixed like HTTP/2's, to stay clear of Windows' NO_ERROR macro
+    enum ERROR_CODE {
+        H3_NO_ERROR = 0x100,
+        H3_GENERAL_PROTOCOL_ERROR = 0x101,
+        H3_INTERNAL_ERROR = 0x102,
+        H3_FRAME_UNEXPECTED = 0x105,
+        H3_FRAME_ERROR = 0x106,
+        H3_EXCESSIVE_LOAD = 0x107,
+        H3_REQUEST_REJECTED = 0x10b,
+        H3_REQUEST_INCOMPLETE = 0x10d,
+        H3_MESSAGE_ERROR = 0x10e,
+        H3_QPACK_DECOMPRESSION_FAILED = 0x200
+    };
+
+    enum SETTING {
+        SETTINGS_QPACK_MAX_TABLE_CAPACITY = 0x1,
+        SETTINGS_MAX_FIELD_SECTION_SIZE = 0x6,
+        SETTINGS_QPACK_BLOCKED_STREAMS = 0x7
+    };
+
+    // Variable-length integers (RFC 9000 16), decodeVarint returns false if more bytes are needed
+    bool decodeVarint(const uint8_t*& p, const uint8_t* pEnd, uint64_t& value);
+    void appendVarint(std::string& out, const uint64_t value);
+
+    // The stream type & SETTINGS frame that open our control stream, the QPACK settings are left at 0
+    void writeControlStreamPreface(std::string& out);
+
+    // Protocol state for one request stream, which only deals in bytes so the server is free to drive the QUIC stream
+    class RequestStream {
+        public:
+            explicit RequestStream(const size_t maxRequestBody) : maxRequestBody(maxRequestBody) {};
+
+            // Consumes bytes from the client, returns H3_NO_ERROR or the error to reset the stream (or close the connection) w/
+            ERROR_CODE receive(const char* data, const size_t size);
+
+            // The client ended the stream (FIN), returns H3_NO_ERROR or the error to reset the stream w/
+            ERROR_CODE finish();
+
+            // Frames the request's head as HTTP/1.1, so it goes through the same parser & handlers as any other request
+            void toHTTP1Request(std::string& raw) const;
+
+            // Queues the response headers, the body (if any) is then sent by fillOutput
+            // prepareBody must already be called on the response
+            void respond(std::unique_ptr<Response> pResponse, const bool hasBody);
+
+            // Queues up to about maxBytes of response DATA frames, returns false if the body couldn't be read
+            bool fillOutput(const size_t maxBytes);
+
+            // Frames waiting to be written to the stream
+            inline std::string& getOutput() { return output; };
+
+            // Queued to be answered (once ended, or once the body is too large)
+            inline bool isRequestDone() const { return _isRequestDone; };
+
+            inline bool isResponding() const { return _isResponding; };
+
+            // Every frame of the response is queued, the stream can end once the output is written
+            inline bool isResponseDone() const { return _isResponding && pResponse == nullptr; };
+
+            // Request fields, pseudo-headers first (already validated)
+            header_list_t headers;
+
+            // Bytes past MaxRequestBody are counted but not kept, so the request is answered w/ 413
+            RequestBody body;
+            size_t bodySize = 0;
+        private:
+            ERROR_CODE handleHeaders(const uint8_t* payload, const size_t length);
+            ERROR_CODE finishRequest();
+
+            const size_t maxRequestBody;
+
+            std::string input; // Bytes received but not yet parsed (ie. a partial frame header or HEADERS frame)
+            uint64_t dataRemaining = 0; // Left in the current DATA frame, which is consumed as it arrives
+            uint64_t skipRemaining = 0; // Left in an unknown frame, which is discarded
+
+            bool isHeadersReceived = false;
+            bool isTrailersReceived = false;
+            bool _isRequestDone = false;
+
+            std::string output;
+            std::unique_ptr<Response> pResponse;
+            bool _isResponding = false;
+    };
+
+}
+
+#endif
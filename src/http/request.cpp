@@ -7,27 +7,14 @@
 
 namespace http {
 
-    Request::Request(headers_map_t& headers, const std::string& raw, std::string clientIP, const bool isHTTPS, const RequestFlags& reqFlags)
-        : headers(headers), ipStr(clientIP), isHTTPS(isHTTPS), reqFlags(reqFlags) {
-        std::string line;
-        size_t startIndex = 0;
-
+    Request::Request(headers_map_t& headers, const std::string& raw, const RequestParser& parser, const RequestBody& body, std::string clientIP, const bool isHTTPS, const RequestFlags& reqFlags, std::shared_ptr<const conf::Snapshot> pConfig)
+        : headers(headers), ipStr(clientIP), isHTTPS(isHTTPS), reqFlags(reqFlags), body(body), pConfig(std::move(pConfig)) {
         // Read verb, path, & protocol version
-        readLine(raw, line, startIndex);
-
-        // Check for invalid status line
-        if (line.size() == 0 || line.back() != '\r')
-            throw http::Exception(); // Force close connection
-        line.pop_back();
-
-        const size_t firstSpaceIndex = line.find(" ");
-        const size_t secondSpaceIndex = line.find(" ", firstSpaceIndex+1);
-
-        this->methodStr = line.substr(0, firstSpaceIndex);
+        this->methodStr = parser.getMethod(raw);
 
         // Check for HTTP/0.9 unique status line
-        if (secondSpaceIndex != std::string::npos) {
-            this->httpVersionStr = line.substr(secondSpaceIndex + 1);
+        if (parser.hasVersion()) {
+            this->httpVersionStr = parser.getVersion(raw);
 
             // Prevent explicit HTTP/0.9 version in status line
             if (this->httpVersionStr == "HTTP/0.9")
@@ -37,7 +24,7 @@ namespace http {
         }
 
         // Parse path logic
-        const std::string rawPathFromRequest = line.substr(firstSpaceIndex + 1, secondSpaceIndex - firstSpaceIndex - 1);
+        const std::string rawPathFromRequest( parser.getTarget(raw) );
         this->_has400Error |= !loadRequestPaths(paths, rawPathFromRequest);
 
         // Determine method
@@ -50,24 +37,17 @@ namespace http {
         else if (this->methodStr == "PATCH")    this->method = METHOD::PATCH;
         else                                    this->method = METHOD::UNKNOWN;
 
-        // Skip headers & read remaining buffer
-        startIndex = raw.find("\r\n\r\n");
-        if (startIndex != std::string::npos) {
-            this->body = std::move(raw);
-            this->body.erase(0, startIndex + 4);
-        }
-
         // Extract accepted MIME types
-        if (this->headers.find("ACCEPT") != this->headers.end())
-            parseAcceptHeader(acceptedMIMETypes, this->headers["ACCEPT"]);
+        if (const std::optional<std::string_view> accept = this->headers.get(HEADER_ACCEPT))
+            parseAcceptHeader(acceptedMIMETypes, *accept);
 
         // Extract accepted encodings
-        if (this->headers.find("ACCEPT-ENCODING") != this->headers.end())
-            splitStringUnique(acceptedEncodings, this->headers["ACCEPT-ENCODING"], ',', true);
+        if (const std::optional<std::string_view> acceptEncoding = this->headers.get(HEADER_ACCEPT_ENCODING))
+            splitStringUnique(acceptedEncodings, std::string(*acceptEncoding), ',', true);
 
         // Extract byte ranges
-        if (this->headers.find("RANGE") != this->headers.end())
-            parseRangeHeader(byteRanges, this->headers["RANGE"]);
+        if (const std::optional<std::string_view> range = this->headers.get(HEADER_RANGE))
+            parseRangeHeader(byteRanges, *range);
 
         // Determine compression method
         if (this->isEncodingAccepted("zstd"))
@@ -81,16 +61,12 @@ namespace http {
 
         // Verify Host header is present for HTTP/1.1+ (RFC 2616)
         if (this->httpVersionStr != "HTTP/0.9" && this->httpVersionStr != "HTTP/1.0"
-            && this->headers.find("HOST") == this->headers.end())
+            && !this->headers.contains(HEADER_HOST))
             this->_has400Error |= true;
     }
 
-    std::optional<std::string> Request::getHeader(std::string header) const {
-        std::optional<std::string> opt;
-        strToUpper(header);
-        const auto result = this->headers.find(header);
-        if (result != headers.end()) opt.emplace(result->second);
-        return opt;
+    std::optional<std::string_view> Request::getHeader(const std::string_view header) const {
+        return this->headers.get(header);
     }
 
     int Request::getCompressMethod(const std::string& MIME) const {
@@ -120,8 +96,8 @@ namespace http {
     }
 
     bool Request::isDNT() const {
-        const std::optional<std::string> dnt = getHeader("DNT");
-        const std::optional<std::string> gpc = getHeader("Sec-GPC");
+        const std::optional<std::string_view> dnt = getHeader("DNT");
+        const std::optional<std::string_view> gpc = getHeader("Sec-GPC");
         return ( dnt.has_value() && dnt.value() == "1" ) || ( gpc.has_value() && gpc.value() == "1" );
     }
 
@@ -165,7 +141,7 @@ namespace http {
 
         // Handle directory listings
         if (file.isDirectory) {
-            for (const std::unique_ptr<conf::Match>& pMatch : conf::matchConfigs) {
+            for (const std::unique_ptr<conf::Match>& pMatch : pConfig->matchConfigs) {
                 if (!pMatch->showDirectoryIndexes() && pMatch->doesRequestMatch(paths.decodedURI, headers)) {
                     // Hide the directory index
                     this->setStatusMaybeErrorDoc(response, 403);
@@ -1,26 +1,33 @@
 #ifndef __HTTP_REQUEST_HPP
 #define __HTTP_REQUEST_HPP
 
+#include <memory>
 #include <optional>
 
+#include "request_body.hpp"
+#include "request_parser.hpp"
 #include "tools.hpp"
 #include "response.hpp"
 
+namespace conf { struct Snapshot; }
+
 namespace http {
 
     class Request {
         public:
-            Request(headers_map_t& headers, const std::string&, std::string, const bool, const RequestFlags&);
+            Request(headers_map_t& headers, const std::string&, const RequestParser&, const RequestBody&, std::string, const bool, const RequestFlags&, std::shared_ptr<const conf::Snapshot>);
 
-            std::optional<std::string> getHeader(std::string) const;
+            std::optional<std::string_view> getHeader(const std::string_view) const;
+            inline std::optional<std::string_view> getHeader(const KNOWN_HEADER header) const { return headers.get(header); };
             inline const std::string getIPStr() const { return ipStr; };
             inline METHOD getMethod() const { return method; };
             inline const std::string& getMethodStr() const { return methodStr; };
             inline const RequestPath& getPaths() const { return paths; };
             inline const std::string& getDecodedURI() const { return paths.decodedURI; };
             inline const std::string& getDecodedQueryString() const { return paths.decodedQueryString; };
-            inline const std::string& getBody() const { return body; };
+            inline const RequestBody& getBody() const { return body; };
             inline const std::string& getVersion() const { return httpVersionStr; };
+            inline const conf::Snapshot& getConfig() const { return *pConfig; };
             int getCompressMethod(const std::string& MIME) const;
             bool isDNT() const;
 
@@ -34,6 +41,7 @@ namespace http {
             inline bool usesHTTPS() const { return isHTTPS; };
             inline bool isContentTooLarge() const { return reqFlags.isContentTooLarge; };
             inline bool isURITooLong() const { return reqFlags.isURITooLong; };
+            inline bool isRateLimitCharged() const { return reqFlags.isRateLimitCharged; };
             inline bool has400Error() const { return _has400Error; };
             inline bool hasExplicitHTTP0_9() const { return _hasExplicitHTTP0_9; };
 
@@ -57,12 +65,13 @@ namespace http {
 
             RequestPath paths;
 
-            bool _hasExplicitHTTP0_9; // Set to true if the status line has HTTP/0.9 explicitly in it (not allowed)
+            bool _hasExplicitHTTP0_9 = false; // Set to true if the status line has HTTP/0.9 explicitly in it (not allowed)
             bool _has400Error = false; // If true, handle as 400 Bad Request
 
             std::string httpVersionStr;
 
-            std::string body;
+            const RequestBody& body; // Owned by the connection (or stream), & only read by handlers
+            std::shared_ptr<const conf::Snapshot> pConfig; // Held for the whole request, so a reload can't change it midway
             int compressMethods = NO_COMPRESS;
     };
 
@@ -0,0 +1,105 @@
+#include "request_body.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "header_map.hpp"
+#include "../conf/conf.hpp"
+#include "../io/file_tools.hpp"
+#include "../logs/logger.hpp"
+
+namespace http {
+
+    RequestBody::RequestBody(RequestBody&& other) noexcept
+        : buffer(std::move(other.buffer)), _size(other._size), tmpPath(std::move(other.tmpPath)), handle(std::move(other.handle)),
+        trailers(std::move(other.trailers)) {
+        other._size = 0;
+        other.tmpPath.clear();
+    }
+
+    RequestBody::~RequestBody() {
+        this->clear();
+    }
+
+    bool RequestBody::append(const char* data, const size_t size) {
+        if (size == 0) return true;
+
+        if (!this->isSpilled() && _size + size > conf::REQUEST_BODY_MEMORY_LIMIT && !this->spill())
+            return false;
+
+        if (this->isSpilled()) {
+            if (!handle.write(data, size)) {
+                ERROR_LOG << "Failed to write request body to temp file: " << tmpPath << std::endl;
+                return false;
+            }
+        } else {
+            buffer.append(data, size);
+        }
+
+        _size += size;
+        return true;
+    }
+
+    size_t RequestBody::read(const size_t offset, char* dest, const size_t maxBytes) const {
+        if (offset >= _size) return 0;
+        const size_t n = (std::min)(maxBytes, _size - offset);
+
+        if (!this->isSpilled()) {
+            std::memcpy(dest, buffer.data() + offset, n);
+            return n;
+        }
+
+        handle.flush();
+        handle.clear(); // ie. a previous read that hit EOF
+        handle.seekg(static_cast<std::streamoff>(offset));
+        handle.read(dest, static_cast<std::streamsize>(n));
+        if (handle.gcount() <= 0) {
+            ERROR_LOG << "Failed to read request body from temp file: " << tmpPath << std::endl;
+            return 0;
+        }
+        return static_cast<size_t>(handle.gcount());
+    }
+
+    void RequestBody::clear() {
+        if (this->isSpilled()) {
+            handle.close();
+            removeTempFile(tmpPath);
+            tmpPath.clear();
+        }
+
+        std::string().swap(buffer);
+        _size = 0;
+        trailers.clear();
+    }
+
+    std::optional<std::string_view> RequestBody::getTrailer(const std::string_view name) const {
+        for (const auto& [trailerName, value] : trailers)
+            if (caseInsensitiveEquals(trailerName, name))
+                return value;
+
+        return std::nullopt;
+    }
+
+    // Moves the body so far to a new temp file, which every later append goes to
+    bool RequestBody::spill() {
+        std::string path;
+        if (!createTempFile(path)) return false;
+
+        handle.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!handle.is_open()) {
+            ERROR_LOG << "Failed to open temp file: " << path << std::endl;
+            removeTempFile(path);
+            return false;
+        }
+
+        tmpPath = std::move(path);
+        if (!handle.write(buffer.data(), buffer.size())) {
+            ERROR_LOG << "Failed to write request body to temp file: " << tmpPath << std::endl;
+            return false;
+        }
+
+        std::string().swap(buffer);
+        return true;
+    }
+
+}
@@ -0,0 +1,54 @@
+#ifndef __HTTP_REQUEST_BODY_HPP
+#define __HTTP_REQUEST_BODY_HPP
+
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace http {
+
+    // A request body, appended to as it arrives off the wire
+    // It's kept in memory up to RequestBodyMemoryLimit, then the whole body is moved to a temp file
+    class RequestBody {
+        public:
+            RequestBody() = default;
+            RequestBody(RequestBody&&) noexcept;
+            ~RequestBody();
+            RequestBody(const RequestBody&) = delete; // Prevent copies
+            void operator=(const RequestBody&) = delete; // Prevent copies
+
+            // Returns false if the body had to be spilled to disk but couldn't be
+            bool append(const char* data, const size_t size);
+
+            // Copies up to maxBytes starting at offset, returns the number of bytes read (0 once done or on failure)
+            size_t read(const size_t offset, char* dest, const size_t maxBytes) const;
+
+            // Drops the body (& its temp file) before the next request
+            void clear();
+
+            // Trailer fields sent after a chunked body, kept apart from the request headers
+            inline void addTrailer(std::string name, std::string value) { trailers.emplace_back(std::move(name), std::move(value)); };
+            std::optional<std::string_view> getTrailer(const std::string_view name) const;
+            inline const std::vector<std::pair<std::string, std::string>>& getTrailers() const { return trailers; };
+
+            inline size_t size() const { return _size; };
+            inline bool empty() const { return _size == 0; };
+            inline bool isSpilled() const { return !tmpPath.empty(); };
+        private:
+            bool spill();
+
+            std::string buffer; // Only used until spilled
+            size_t _size = 0;
+
+            std::string tmpPath;
+            mutable std::fstream handle; // Reads must flush & seek it
+
+            std::vector<std::pair<std::string, std::string>> trailers;
+    };
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include "request_parser.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+
+namespace http {
+
+    int RequestParser::parse(const std::string& buffer, headers_map_t& headers, RequestFlags& reqFlags) {
+        while (state == STATE_REQUEST_LINE || state == STATE_HEADERS) {
+            const size_t lineEnd = buffer.find('\n', scanOffset);
+            if (lineEnd == std::string::npos) {
+                scanOffset = buffer.size(); // Only scan new bytes next time
+
+                // URI and/or request line is too long, no need to wait for the rest of it
+                if (state == STATE_REQUEST_LINE && buffer.size() - lineStart > maxRequestLineLength) {
+                    reqFlags.isURITooLong = true;
+                    state = STATE_BODY;
+                    break;
+                }
+
+                return REQUEST_INCOMPLETE;
+            }
+
+            // Lines must be CRLF-terminated
+            if (lineEnd == lineStart || buffer[lineEnd - 1] != '\r')
+                return this->fail(state == STATE_REQUEST_LINE ? PARSE_BAD_REQUEST_LINE : PARSE_BAD_HEADER_LINE);
+
+            if (state == STATE_REQUEST_LINE)
+                this->parseRequestLine(buffer, lineEnd - 1, reqFlags);
+            else if (lineEnd - 1 > lineStart)
+                this->parseHeaderLine(buffer, lineEnd - 1);
+            else if (const int framingError = this->loadBodyFraming(buffer, reqFlags); framingError != PARSE_OK) // Blank line, end of headers
+                return this->fail(framingError);
+
+            lineStart = scanOffset = lineEnd + 1;
+        }
+
+        if (state == STATE_INVALID) return REQUEST_INVALID;
+
+        // The caller stops growing the buffer once the headers are complete, so views into it stay valid
+        if (!areHeadersLoaded) {
+            for (const auto& [name, value] : headerSpans)
+                headers.add(view(buffer, name), view(buffer, value));
+            areHeadersLoaded = true;
+        }
+
+        return REQUEST_READY;
+    }
+
+    void RequestParser::reset() {
+        state = STATE_REQUEST_LINE;
+        error = PARSE_OK;
+        lineStart = scanOffset = 0;
+        method = target = version = buffer_span_t();
+        headerSpans.clear();
+        _hasRequestLine = _hasVersion = areHeadersLoaded = false;
+        headersEnd = std::string::npos;
+        contentLength = 0;
+        _isChunked = false;
+    }
+
+    // Splits the request line (excluding CRLF) into method, target & version
+    void RequestParser::parseRequestLine(const std::string& buffer, const size_t lineEnd, RequestFlags& reqFlags) {
+        const std::string_view line = std::string_view(buffer).substr(lineStart, lineEnd - lineStart);
+        const size_t firstSpaceIndex = line.find(' ');
+        const size_t secondSpaceIndex = line.find(' ', firstSpaceIndex + 1);
+
+        method = { lineStart, (std::min)(firstSpaceIndex, line.size()) };
+
+        // HTTP/0.9 request lines have no version
+        if ((_hasVersion = secondSpaceIndex != std::string_view::npos))
+            version = { lineStart + secondSpaceIndex + 1, line.size() - secondSpaceIndex - 1 };
+
+        const size_t targetStart = firstSpaceIndex == std::string_view::npos ? 0 : firstSpaceIndex + 1;
+        const size_t targetEnd = secondSpaceIndex == std::string_view::npos ? line.size() : secondSpaceIndex;
+        target = { lineStart + targetStart, targetEnd - targetStart };
+        _hasRequestLine = true;
+
+        // URI and/or request line is too long, skip the headers since the connection is about to be closed
+        if (line.size() > maxRequestLineLength) {
+            reqFlags.isURITooLong = true;
+            state = STATE_BODY;
+            return;
+        }
+
+        state = STATE_HEADERS;
+    }
+
+    // Records a single "Key: Value" header line (excluding CRLF), lines without a colon-space delimiter are ignored
+    void RequestParser::parseHeaderLine(const std::string& buffer, const size_t lineEnd) {
+        const std::string_view line = std::string_view(buffer).substr(lineStart, lineEnd - lineStart);
+        const size_t delimIndex = line.find(": ");
+        if (delimIndex == std::string_view::npos) return;
+
+        headerSpans.emplace_back(
+            buffer_span_t{ lineStart, delimIndex },
+            buffer_span_t{ lineStart + delimIndex + 2, line.size() - delimIndex - 2 }
+        );
+    }
+
+    // Determines how the body is framed once the headers are received, returns PARSE_OK or why the framing is malformed
+    int RequestParser::loadBodyFraming(const std::string& buffer, RequestFlags& reqFlags) {
+        headersEnd = lineStart + 2; // Skip the blank line's CRLF
+        state = STATE_BODY;
+
+        const auto itr = std::find_if(headerSpans.begin(), headerSpans.end(), [&buffer](const auto& span) {
+            return lookupKnownHeader(view(buffer, span.first)) == HEADER_CONTENT_LENGTH;
+        });
+
+        // Only chunked is supported, & a body framed both ways could be split differently by a proxy in front of us (RFC 9112 6.3)
+        for (const auto& [name, value] : headerSpans) {
+            if (!caseInsensitiveEquals(view(buffer, name), "Transfer-Encoding")) continue;
+            if (_isChunked || itr != headerSpans.end() || !caseInsensitiveEquals(trim(view(buffer, value)), "chunked"))
+                return PARSE_BAD_TRANSFER_ENCODING;
+            _isChunked = true;
+        }
+
+        // Chunked bodies are held to MaxRequestBody as they're decoded
+        if (_isChunked) return PARSE_OK;
+
+        // Repeated Content-Length headers are merged if identical, otherwise a proxy could pick a different one (RFC 9112 6.3)
+        for (auto span = itr; span != headerSpans.end(); ++span) {
+            if (lookupKnownHeader(view(buffer, span->first)) != HEADER_CONTENT_LENGTH) continue;
+
+            const std::string_view value = trim(view(buffer, span->second));
+            if (value.empty()) return PARSE_BAD_CONTENT_LENGTH;
+
+            size_t length = 0;
+            const auto [pEnd, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (ec != std::errc() || pEnd != value.data() + value.size())
+                return PARSE_BAD_CONTENT_LENGTH;
+            if (span != itr && length != contentLength)
+                return PARSE_BAD_CONTENT_LENGTH;
+
+            contentLength = length;
+        }
+
+        // Reject oversized bodies
+        if (contentLength > maxRequestBody) {
+            contentLength = 0; // Passthru
+            reqFlags.isContentTooLarge = true;
+        }
+
+        return PARSE_OK;
+    }
+
+    // Strips leading & trailing spaces/tabs from a header value
+    std::string_view RequestParser::trim(const std::string_view value) {
+        const size_t start = value.find_first_not_of(" \t");
+        if (start == std::string_view::npos) return std::string_view();
+        return value.substr(start, value.find_last_not_of(" \t") - start + 1);
+    }
+
+    int RequestParser::fail(const int error) {
+        this->error = error;
+        state = STATE_INVALID;
+        return REQUEST_INVALID;
+    }
+
+}
@@ -0,0 +1,101 @@
+#ifndef __HTTP_REQUEST_PARSER_HPP
+#define __HTTP_REQUEST_PARSER_HPP
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tools.hpp"
+
+#define REQUEST_INCOMPLETE 0
+#define REQUEST_READY      1
+#define REQUEST_INVALID    2
+
+// Reasons a request was rejected as REQUEST_INVALID
+#define PARSE_OK                 0
+#define PARSE_BAD_REQUEST_LINE   1 // Request line isn't CRLF-terminated
+#define PARSE_BAD_HEADER_LINE    2 // Header line isn't CRLF-terminated
+#define PARSE_BAD_CONTENT_LENGTH 3 // Content-Length isn't a plain decimal number, or is repeated w/ different values
+#define PARSE_BAD_TRANSFER_ENCODING 4 // Transfer-Encoding isn't just "chunked", or is sent alongside Content-Length
+
+namespace http {
+
+    // Location of a token within the request buffer
+    typedef struct {
+        size_t offset = 0;
+        size_t length = 0;
+    } buffer_span_t;
+
+    // Resumable HTTP/1.x request parser, which consumes bytes as they are appended to the connection buffer
+    // so each byte of the request line & headers is only scanned once
+    class RequestParser {
+        public:
+            RequestParser(const size_t maxRequestLineLength, const size_t maxRequestBody)
+                : maxRequestLineLength(maxRequestLineLength), maxRequestBody(maxRequestBody) {};
+
+            // Parses any bytes appended to buffer since the last call
+            // Returns REQUEST_READY once the request line & headers are buffered, REQUEST_INCOMPLETE if more data is needed,
+            // or REQUEST_INVALID if the connection should be closed (see getError)
+            // The body isn't parsed, the caller reads getContentLength bytes past getHeadersEnd (or decodes them if isChunked)
+            // Once ready, headers holds views into buffer, so buffer must not be reallocated until the next reset
+            int parse(const std::string& buffer, headers_map_t& headers, RequestFlags& reqFlags);
+
+            // Prepares to parse the next request on the connection
+            void reset();
+
+            inline int getError() const { return error; };
+            inline bool hasRequestLine() const { return _hasRequestLine; };
+            inline bool hasVersion() const { return _hasVersion; };
+
+            // Views into the buffer passed to parse, only valid while it is unchanged
+            inline std::string_view getMethod(const std::string& buffer) const { return view(buffer, method); };
+            inline std::string_view getTarget(const std::string& buffer) const { return view(buffer, target); };
+            inline std::string_view getVersion(const std::string& buffer) const { return view(buffer, version); };
+
+            inline size_t getHeadersEnd() const { return headersEnd; }; // Index of the first body byte, if known
+            inline size_t getContentLength() const { return contentLength; }; // 0 if the body is too large to accept
+            inline bool isChunked() const { return _isChunked; }; // "Transfer-Encoding: chunked", w/o a Content-Length
+            inline bool hasHeaders() const { return headersEnd != std::string::npos; };
+        private:
+            enum STATE {
+                STATE_REQUEST_LINE = 0,
+                STATE_HEADERS = 1,
+                STATE_BODY = 2,
+                STATE_INVALID = 3
+            };
+
+            void parseRequestLine(const std::string& buffer, const size_t lineEnd, RequestFlags& reqFlags);
+            void parseHeaderLine(const std::string& buffer, const size_t lineEnd);
+            int loadBodyFraming(const std::string& buffer, RequestFlags& reqFlags);
+            int fail(const int error);
+            static std::string_view trim(const std::string_view value);
+
+            inline static std::string_view view(const std::string& buffer, const buffer_span_t& span) {
+                return std::string_view(buffer).substr(span.offset, span.length);
+            };
+
+            const size_t maxRequestLineLength;
+            const size_t maxRequestBody;
+
+            STATE state = STATE_REQUEST_LINE;
+            int error = PARSE_OK;
+            size_t lineStart = 0; // Start of the line being parsed
+            size_t scanOffset = 0; // Where to resume looking for the end of the line
+
+            buffer_span_t method, target, version;
+            // Header names & values, only turned into views once the buffer stops growing
+            std::vector<std::pair<buffer_span_t, buffer_span_t>> headerSpans;
+            bool areHeadersLoaded = false;
+
+            bool _hasRequestLine = false;
+            bool _hasVersion = false; // False for HTTP/0.9 request lines
+
+            size_t headersEnd = std::string::npos;
+            size_t contentLength = 0;
+            bool _isChunked = false;
+    };
+
+}
+
+#endif
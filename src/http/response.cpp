@@ -1,5 +1,7 @@
 #include "response.hpp"
 
+#include <charconv>
+
 #include "compressor_stream.hpp"
 #include "../conf/conf.hpp"
 #include "../logs/logger.hpp"
@@ -8,6 +10,7 @@
 
 #define CRLF "\r\n"
 #define tostr std::to_string
+#define CHUNK_SIZE_LINE_MAX 20 // 16 hex digits + CRLF
 
 namespace http {
 
@@ -184,28 +187,15 @@ namespace http {
         return true;
     }
 
-    ssize_t Response::streamBody(const bool isHTMLAccepted, const bool omitBody, std::function<ssize_t(const char*, const size_t)>& sendFunc) {
-        std::vector<char> readChunk(conf::RESPONSE_BUFFER_SIZE), compressChunk;
-
-        // Handle HTTP/0.9 unique format
-        if (this->httpVersion == "HTTP/0.9") {
-            // Verify status is unset (only set by errors)
-            if (statusCode != RESPONSE_DEFAULT_STATUS_HTTP_0_9) {
-                // Signal the server to close the connection
-                // By returning < 0
-                return -1;
-            }
-
-            // Send chunks
-            while (true) {
-                size_t bytesRead = pBodyStream->read(readChunk.data(), conf::RESPONSE_BUFFER_SIZE);
-                if (bytesRead == 0) break;
-                ssize_t status = sendFunc(readChunk.data(), bytesRead);
-                if (status < 0) return status;
-            }
-            return 0;
-        }
+    // Writes the chunk size line (ie. "1f40\r\n") to buffer, which must hold CHUNK_SIZE_LINE_MAX chars, & returns its length
+    static size_t formatChunkSizeLine(char* buffer, const size_t chunkSize) {
+        char* pEnd = std::to_chars(buffer, buffer + CHUNK_SIZE_LINE_MAX - 2, chunkSize, 16).ptr;
+        *pEnd++ = '\r';
+        *pEnd++ = '\n';
+        return static_cast<size_t>(pEnd - buffer);
+    }
 
+    size_t Response::prepareBody(const bool isHTMLAccepted) {
         // Lambda to reset Content-Length, close the connection, and wipe the stream
         auto clearBodyAndResetStream = [&]() {
             this->clearHeader("Content-Type");
@@ -277,7 +267,7 @@ namespace http {
         }
 
         // Create a streamable, buffered compressor
-        std::unique_ptr<ICompressor> pCompressor(
+        this->pCompressor.reset(
             (wasPrecompressed || pBodyStream->size() <= conf::MIN_COMPRESSION_SIZE) ? nullptr : createCompressorStream(this->compressMethod)
         );
 
@@ -285,12 +275,9 @@ namespace http {
         if (!wasPrecompressed && pBodyStream->size() <= conf::MIN_COMPRESSION_SIZE)
             clearHeader("Content-Encoding");
 
-        // Update transfer encoding
+        // Update transfer encoding (HTTP/2 frames the body itself)
         const size_t bodySize = pBodyStream->size();
-        const std::string originalContentType = this->getContentType();
-
-        const bool isTransEncSupported = this->httpVersion != "HTTP/1.0";
-        const bool usingTransEnc = isTransEncSupported && bodySize > conf::RESPONSE_BUFFER_SIZE;
+        this->usingTransEnc = this->httpVersion == "HTTP/1.1" && bodySize > conf::RESPONSE_BUFFER_SIZE;
         if (!usingTransEnc && bodySize > 0) { // Content-Length is known (no compress)
             // Check for byte ranges
             if (!originalByteRanges.empty()) { // Single byte range
@@ -300,11 +287,14 @@ namespace http {
                 const size_t startIndex = originalByteRanges[0].first;
                 const size_t endIndex = originalByteRanges[0].second;
 
-                setHeader("Content-Length", tostr(bodySize));
                 setHeader("Content-Range", "bytes " + tostr(startIndex) + '-' + tostr(endIndex) + "/" + tostr(originalBodySize));
-            } else {
-                this->setHeader("Content-Length", tostr(bodySize));
             }
+
+            // Only HTTP/2 compresses w/o chunking, in which case the length isn't known up front
+            if (pCompressor == nullptr)
+                this->setHeader("Content-Length", tostr(bodySize));
+            else
+                this->clearHeader("Content-Length");
         } else if (usingTransEnc) { // Use chunked transfer encoding
             setHeader("Transfer-Encoding", "chunked");
             clearHeader("Content-Length");
@@ -324,79 +314,125 @@ namespace http {
         setHeader("Server", "Mercury/" + conf::VERSION.substr(9)); // Skip "Mercury v"
         setHeader("Date", getCurrentGMTString());
 
+        return bodySize;
+    }
+
+    ssize_t Response::readBodyChunk(const char*& pData, bool& isLast) {
+        if (readChunk.empty()) readChunk.resize(conf::RESPONSE_BUFFER_SIZE);
+
+        size_t bytesRead = pBodyStream->read(readChunk.data(), readChunk.size());
+        isLast = bytesRead == 0;
+        pData = readChunk.data();
+        if (pCompressor == nullptr) return static_cast<ssize_t>(bytesRead);
+
+        // Compress, or send any remaining compression data
+        compressChunk.clear();
+        bytesRead = isLast ? pCompressor->finish(compressChunk) : pCompressor->compress(readChunk.data(), compressChunk, bytesRead);
+        if (pCompressor->status() != STREAM_SUCCESS) {
+            ERROR_LOG << (isLast ? "Compression error (end flush)." : "Compression error.") << std::endl;
+            return -1;
+        }
+
+        pData = compressChunk.data();
+        return static_cast<ssize_t>(bytesRead);
+    }
+
+    ssize_t Response::streamBody(const bool isHTMLAccepted, const bool omitBody, SocketWriter& writer) {
+        const char* pData;
+        bool isLast = false;
+
+        // Handle HTTP/0.9 unique format
+        if (this->httpVersion == "HTTP/0.9") {
+            // Verify status is unset (only set by errors)
+            if (statusCode != RESPONSE_DEFAULT_STATUS_HTTP_0_9) {
+                // Signal the server to close the connection
+                // By returning < 0
+                return -1;
+            }
+
+            // Send chunks
+            while (true) {
+                const ssize_t bytesRead = this->readBodyChunk(pData, isLast);
+                if (isLast) break;
+                ssize_t status = writer.write(pData, static_cast<size_t>(bytesRead));
+                if (status < 0) return status;
+            }
+            return 0;
+        }
+
+        const size_t bodySize = this->prepareBody(isHTMLAccepted);
+
         // Stringify headers
         std::string headers;
         for (auto& [name, value] : this->headers)
             headers += name + ": " + value + CRLF;
 
-        // Write to buffer
+        // The headers are held back to go out in the same write as the start of the body
         std::string headersBlock = httpVersion + ' ' + tostr(statusCode) + ' '  + getReasonFromStatus(statusCode) + CRLF + headers + CRLF;
-        ssize_t status = sendFunc(headersBlock.data(), headersBlock.size());
-        if (status < 0) return status;
+        const io_slice_t headersSlice = { headersBlock.data(), headersBlock.size() };
 
         // Omit the body from HEAD requests OR if the body doesn't exist
-        if (omitBody || bodySize == 0) return 0;
-
-        // Send chunks
-        auto sendWrapper = [&](const std::vector<char>& chunk, const size_t bytesRead) -> int {
-            if (bytesRead == 0) return 0;
-            if (usingTransEnc) {
-                // Convert to hex
-                std::stringstream ss;
-                ss << std::hex << bytesRead;
-                const std::string header = ss.str() + "\r\n";
-
-                if (sendFunc(header.data(), header.size()) < 0) return -1;
-                if (sendFunc(chunk.data(), bytesRead) < 0) return -1;
-                if (sendFunc("\r\n", 2) < 0) return -1;
-            } else {
-                if (sendFunc(chunk.data(), bytesRead) < 0) return -1;
-            }
-            return 0;
-        };
+        if (omitBody || bodySize == 0) {
+            ssize_t status = writer.write(&headersSlice, 1);
+            return status < 0 ? status : 0;
+        }
 
-        // Set to true if sending a new range
-        while (true) {
-            // Read
-            size_t bytesRead = pBodyStream->read(readChunk.data(), conf::RESPONSE_BUFFER_SIZE);
-            if (bytesRead == 0 && originalByteRanges.size() <= 1) {
-                // If sending multipart byte ranges, this is skipped
-                // Send any remaining compression data
-                if (pCompressor != nullptr) {
-                    // Compress
-                    compressChunk.clear();
-                    bytesRead = pCompressor->finish(compressChunk);
-                    if (pCompressor->status() != STREAM_SUCCESS) {
-                        ERROR_LOG << "Compression error (end flush)." << std::endl;
-                        return -1;
-                    }
+        char chunkSizeLine[CHUNK_SIZE_LINE_MAX];
 
-                    // Send
-                    if (sendWrapper(compressChunk, bytesRead) < 0) return -1;
-                }
-                break;
-            }
+        #ifdef __linux__
+            // Send uncompressed files straight from the fd, as a single chunk if using transfer encoding
+            FileStream* pFileStream = dynamic_cast<FileStream*>(pBodyStream.get());
+            if (writer.canSendFile() && pFileStream != nullptr && pCompressor == nullptr) {
+                io_slice_t slices[2] = { headersSlice, { chunkSizeLine, 0 } };
+                if (usingTransEnc) slices[1].size = formatChunkSizeLine(chunkSizeLine, bodySize);
+                if (writer.write(slices, usingTransEnc ? 2 : 1) < 0) return -1;
 
-            // Compress
-            if (pCompressor != nullptr) {
-                compressChunk.clear();
-                bytesRead = pCompressor->compress(readChunk.data(), compressChunk, bytesRead);
-                if (pCompressor->status() != STREAM_SUCCESS) {
-                    ERROR_LOG << "Compression error." << std::endl;
-                    return -1;
-                }
+                const std::function<ssize_t(const int, const size_t, const size_t)> sendFileFunc =
+                    [&writer](const int fd, const size_t offset, const size_t n) { return writer.sendFile(fd, offset, n); };
+
+                size_t totalSent = 0;
+                ssize_t bytesSent;
+                while ((bytesSent = pFileStream->sendFile(sendFileFunc, bodySize - totalSent)) > 0)
+                    totalSent += static_cast<size_t>(bytesSent);
+
+                // A short send would corrupt the framing, so close the connection
+                if (bytesSent < 0 || totalSent != bodySize) return -1;
 
-                // Send
-                if (sendWrapper(compressChunk, bytesRead) < 0)
-                    return -1;
-            } else { // Send w/o compression
-                if (sendWrapper(readChunk, bytesRead) < 0) return -1;
+                const io_slice_t endSlice = { CRLF "0" CRLF CRLF, 7 };
+                if (usingTransEnc && writer.write(&endSlice, 1) < 0) return -1;
+                return 0;
+            }
+        #endif
+
+        // Send chunks, framing & all, in one vectored write (along w/ the headers for the first one)
+        // The last chunk of a compressed body also carries the terminating chunk
+        bool areHeadersSent = false;
+        auto sendWrapper = [&](const char* pChunk, const size_t bytesRead, const bool isLastChunk) -> int {
+            io_slice_t slices[5];
+            size_t numSlices = 0;
+            if (!areHeadersSent) slices[numSlices++] = headersSlice;
+
+            if (bytesRead > 0 && usingTransEnc) {
+                slices[numSlices++] = { chunkSizeLine, formatChunkSizeLine(chunkSizeLine, bytesRead) };
+                slices[numSlices++] = { pChunk, bytesRead };
+                slices[numSlices++] = { CRLF, 2 };
+            } else if (bytesRead > 0) {
+                slices[numSlices++] = { pChunk, bytesRead };
             }
-        }
 
-        // End chunked transfer
-        if (usingTransEnc)
-            sendFunc("0\r\n\r\n", 5);
+            if (isLastChunk && usingTransEnc) slices[numSlices++] = { "0" CRLF CRLF, 5 };
+            if (numSlices == 0) return 0;
+
+            areHeadersSent = true;
+            return writer.write(slices, numSlices) < 0 ? -1 : 0;
+        };
+
+        // The last read ends chunked transfer (also sends the headers if the body turned out to be empty)
+        while (!isLast) {
+            const ssize_t bytesRead = this->readBodyChunk(pData, isLast);
+            if (bytesRead < 0 || sendWrapper(pData, static_cast<size_t>(bytesRead), isLast) < 0)
+                return -1;
+        }
 
         // Base case, success
         return 0;
@@ -404,5 +440,6 @@ namespace http {
 
 }
 
+#undef CHUNK_SIZE_LINE_MAX
 #undef CRLF
 #undef toStr
\ No newline at end of file
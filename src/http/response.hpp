@@ -11,6 +11,8 @@
 #include "../io/file.hpp"
 #include "../util/string_tools.hpp"
 #include "body_stream.hpp"
+#include "compressor_stream.hpp"
+#include "socket_writer.hpp"
 #include "tools.hpp"
 
 // The default status code for HTTP/0.9 response bodies
@@ -26,6 +28,9 @@ namespace http {
             inline void setStatus(const uint16_t statusCode) { this->statusCode = statusCode; };
             inline uint16_t getStatus() const { return httpVersion == "HTTP/0.9" ? 0 : statusCode; };
 
+            // For responses generated by the HTTP/1.1 handlers on behalf of another protocol (ie. "HTTP/2")
+            inline void setVersion(const std::string& httpVersion) { this->httpVersion = httpVersion; };
+
             void setHeader(std::string name, const std::string& value);
             void clearHeader(std::string name);
             inline void clearHeaders() { headers.clear(); };
@@ -41,8 +46,19 @@ namespace http {
             const std::string getContentType() const;
 
             size_t getContentLength() const;
+            inline const std::unordered_map<std::string, std::string>& getHeaders() const { return headers; };
+
+            // Writes the response to writer, which the caller must flush afterwards
+            // Uncompressed FileStream bodies are sent w/o copying them to userspace if the writer supports it
+            ssize_t streamBody(const bool isHTMLAccepted, const bool omitBody, SocketWriter& writer);
 
-            ssize_t streamBody(const bool isHTMLAccepted, const bool omitBody, std::function<ssize_t(const char*, const size_t)>&);
+            // Settles the status, headers & content coding before the body is sent, for protocols that frame the body themselves
+            // Returns the size of the body before any compression (0 if there's no body)
+            size_t prepareBody(const bool isHTMLAccepted);
+
+            // Reads (& compresses) the next piece of the body, pointing pData at it until the next call
+            // Returns its size or < 0 on failure, isLast is set once the body is exhausted (along w/ any final compressor output)
+            ssize_t readBodyChunk(const char*& pData, bool& isLast);
 
             // Returns true if the ranges are valid, false otherwise
             bool extendByteRanges(const std::vector<byte_range_t>& byteRanges);
@@ -54,6 +70,11 @@ namespace http {
             std::unique_ptr<IBodyStream> pBodyStream;
             int compressMethod = NO_COMPRESS;
 
+            // Set up by prepareBody
+            std::unique_ptr<ICompressor> pCompressor;
+            bool usingTransEnc = false;
+            std::vector<char> readChunk, compressChunk;
+
             std::unordered_map<std::string, std::string> headers;
 
             // For precompressed bodies
@@ -2,6 +2,7 @@
 
 #include <iostream>
 
+#include "socket_handoff.hpp"
 #include "../conf/conf.hpp"
 #include "../logs/logger.hpp"
 
@@ -31,6 +32,15 @@ namespace http {
     }
 
     int ServerV6::bindSocket() {
+        struct sockaddr_in6 addr = {};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_port = htons(this->port);
+        memcpy(&addr.sin6_addr, conf::BIND_ADDR_IPV6->bytes, 16);
+
+        // Reuse the socket passed on by the process being upgraded (or systemd), so the port is never unbound
+        if ((this->sock = takeInheritedSocket(SOCK_STREAM, (const struct sockaddr*)&addr)) != SOCKET_UNSET)
+            return 0;
+
         // Retry a few times to bind if failed
         int bindAttempts = 0;
         int lastErrno = -1;
@@ -43,12 +53,6 @@ namespace http {
             const int optsStatus = bindSocketOpts(*this, this->sock, isLastAttempt);
 
             if (optsStatus == 0) {
-                // Bind the host address
-                struct sockaddr_in6 addr = {};
-                addr.sin6_family = AF_INET6;
-                addr.sin6_port = htons(this->port);
-                memcpy(&addr.sin6_addr, conf::BIND_ADDR_IPV6->bytes, 16);
-
                 // If bound properly, exit early
                 if (bind(this->sock, (const struct sockaddr*)&addr, sizeof(addr)) >= 0)
                     return 0;
@@ -7,8 +7,8 @@ namespace http {
 
     class ServerV6 : public Server {
         public:
-            ServerV6(const port_t port, const bool useTLS)
-                : Server(port, useTLS) {};
+            ServerV6(const port_t port, const bool useTLS, const unsigned int shardIndex=0)
+                : Server(port, useTLS, shardIndex) {};
 
             // Overridden by IPv6 servers
             int bindSocket();
@@ -0,0 +1,394 @@
+#include "server-quic.hpp"
+
+#ifdef HAS_QUIC
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+
+#include <openssl/bio.h>
+#include <openssl/quic.h>
+
+#include "socket_handoff.hpp"
+#include "../conf/conf.hpp"
+#include "../logs/logger.hpp"
+
+#define QUIC_MAX_WAIT_MS 1000 // Upper bound on a wait, in case OpenSSL has no timer pending
+
+namespace http {
+
+    std::atomic<bool> QUICServer::isListening{false};
+
+    QUICServer::~QUICServer() {
+        // Only left over if the listener never ran
+        connections.clear();
+        SSL_free(pListener);
+        SSL_CTX_free(pSSL_CTX);
+        if (this->sock != SOCKET_UNSET) this->closeSocket(this->sock);
+    }
+
+    int QUICServer::bindSocket() {
+        struct sockaddr_storage addr = {};
+        socklen_t addrLen;
+        if (_isIPv6) {
+            struct sockaddr_in6* pAddr = reinterpret_cast<struct sockaddr_in6*>(&addr);
+            pAddr->sin6_family = AF_INET6;
+            pAddr->sin6_port = htons(this->port);
+            memcpy(&pAddr->sin6_addr, conf::BIND_ADDR_IPV6->bytes, 16);
+            addrLen = sizeof(struct sockaddr_in6);
+        } else {
+            struct sockaddr_in* pAddr = reinterpret_cast<struct sockaddr_in*>(&addr);
+            pAddr->sin_family = AF_INET;
+            pAddr->sin_port = htons(this->port);
+            memcpy(&pAddr->sin_addr, conf::BIND_ADDR_IPV4->bytes, 4);
+            addrLen = sizeof(struct sockaddr_in);
+        }
+
+        // Reuse the socket passed on by the process being upgraded (or systemd)
+        if ((this->sock = takeInheritedSocket(SOCK_DGRAM, reinterpret_cast<const struct sockaddr*>(&addr))) != SOCKET_UNSET)
+            return 0;
+
+        this->sock = socket(_isIPv6 ? AF_INET6 : AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (this->sock < 0) {
+            ERROR_LOG << "Failed to open socket (" << *this << ") on port " << this->port << std::endl;
+            return SOCKET_FAILURE;
+        }
+
+        const int optFlag = 1;
+        bindSocketOpt(this, this->sock, SOL_SOCKET, SO_REUSEADDR, optFlag, true);
+        if (_isIPv6) bindSocketOpt(this, this->sock, IPPROTO_IPV6, IPV6_V6ONLY, optFlag, true);
+
+        if (bind(this->sock, reinterpret_cast<const struct sockaddr*>(&addr), addrLen) < 0) {
+            ERROR_LOG << "Failed to bind socket (" << *this << "), errno: " << errno << std::endl;
+            return BIND_FAILURE;
+        }
+
+        return 0;
+    }
+
+    int QUICServer::init() {
+        const int bindStatus = this->bindSocket();
+        if (bindStatus != 0) return bindStatus;
+
+        // Never block on the socket, the eventfd interrupts the wait for results & on shutdown
+        const int sockFlags = fcntl(this->sock, F_GETFL, 0);
+        if (sockFlags < 0 || fcntl(this->sock, F_SETFL, sockFlags | O_NONBLOCK) < 0 ||
+            (this->acceptWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+            ERROR_LOG << "Failed to init the accept loop (" << *this << ")." << std::endl;
+            return SOCKET_FAILURE;
+        }
+
+        if ((this->pSSL_CTX = initQUICContext()) == nullptr) {
+            ERROR_LOG << "Failed to init a QUIC context (" << *this << ")." << std::endl;
+            return BIND_FAILURE;
+        }
+
+        // The listener owns the UDP socket, every connection's datagrams go through it
+        BIO* pBIO = BIO_new_dgram(this->sock, BIO_NOCLOSE);
+        if (pBIO == nullptr || (this->pListener = SSL_new_listener(this->pSSL_CTX, 0)) == nullptr) {
+            BIO_free(pBIO);
+            ERROR_LOG << "Failed to create the QUIC listener (" << *this << ")." << std::endl;
+            return LISTEN_FAILURE;
+        }
+        SSL_set_bio(this->pListener, pBIO, pBIO);
+
+        if (SSL_set_blocking_mode(this->pListener, 0) != 1 || SSL_listen(this->pListener) != 1) {
+            ERROR_LOG << "Failed to listen to socket (" << *this << ")." << std::endl;
+            return LISTEN_FAILURE;
+        }
+
+        this->readBuffer.resize(conf::REQUEST_BUFFER_SIZE);
+        isListening.store(true);
+
+        ACCESS_LOG << "Listening on port " << this->port << " (" << *this << ")." << std::endl;
+        return 0;
+    }
+
+    void QUICServer::kill() {
+        // The loop cleans up after itself, since it alone touches the QUIC objects
+        this->isExiting.store(true);
+        if (this->acceptWakeFd != -1)
+            eventfd_write(this->acceptWakeFd, 1);
+    }
+
+    void QUICServer::acceptLoop() {
+        while (!this->isExiting) {
+            SSL_handle_events(this->pListener);
+            this->isBusy = false;
+
+            this->acceptConnections();
+            this->collectResults();
+
+            for (auto itr = this->connections.begin(); itr != this->connections.end(); ) {
+                if (this->serveConnection(itr->first, *itr->second)) ++itr;
+                else itr = this->connections.erase(itr);
+            }
+
+            // Wait for datagrams, answered requests, or OpenSSL's next timer (ie. a retransmit or idle timeout)
+            struct pollfd pfds[2];
+            pfds[0].fd = this->sock;
+            pfds[0].events = POLLIN | (SSL_net_write_desired(this->pListener) ? POLLOUT : 0);
+            pfds[1].fd = this->acceptWakeFd;
+            pfds[1].events = POLLIN;
+            if (poll(pfds, 2, this->isBusy ? 0 : this->getEventTimeout()) > 0 && (pfds[1].revents & POLLIN)) {
+                eventfd_t value;
+                eventfd_read(this->acceptWakeFd, &value);
+            }
+        }
+
+        // Tell every client we're going away, then wait for the workers before freeing their streams
+        for (auto& [connectionId, pConn] : this->connections)
+            this->closeConnection(*pConn, http3::H3_NO_ERROR);
+        SSL_handle_events(this->pListener);
+        this->threadPool.stop();
+
+        this->connections.clear();
+        SSL_free(this->pListener);
+        this->pListener = nullptr;
+        SSL_CTX_free(this->pSSL_CTX);
+        this->pSSL_CTX = nullptr;
+
+        if (this->sock != SOCKET_UNSET && !this->closeSocket(this->sock)) {
+            ACCESS_LOG << "Server socket closed (" << *this << ")." << std::endl;
+            this->sock = SOCKET_UNSET;
+        }
+    }
+
+    void QUICServer::acceptConnections() {
+        SSL* pSSL;
+        while ((pSSL = SSL_accept_connection(this->pListener, SSL_ACCEPT_CONNECTION_NO_BLOCK)) != nullptr) {
+            auto pConn = std::make_unique<Connection>(pSSL);
+
+            // Streams are only ever accepted explicitly, so none are opened implicitly by a read or write
+            if (SSL_set_blocking_mode(pSSL, 0) != 1 ||
+                SSL_set_default_stream_mode(pSSL, SSL_DEFAULT_STREAM_MODE_NONE) != 1 ||
+                SSL_set_incoming_stream_policy(pSSL, SSL_INCOMING_STREAM_POLICY_ACCEPT, 0) != 1) {
+                this->closeConnection(*pConn, http3::H3_INTERNAL_ERROR);
+                continue;
+            }
+
+            // The peer's address may change w/ a migration, but the one it connected from is what gets logged
+            BIO_ADDR* pAddr = BIO_ADDR_new();
+            if (pAddr != nullptr && SSL_get_peer_addr(pSSL, pAddr) == 1) {
+                char* pClientIP = BIO_ADDR_hostname_string(pAddr, 1);
+                if (pClientIP != nullptr) pConn->clientIP = pClientIP;
+                OPENSSL_free(pClientIP);
+            }
+            BIO_ADDR_free(pAddr);
+
+            http3::writeControlStreamPreface(pConn->controlOutput);
+            this->connections.emplace(this->nextConnectionId++, std::move(pConn));
+        }
+    }
+
+    void QUICServer::acceptStreams(Connection& conn) {
+        SSL* pStream;
+        while ((pStream = SSL_accept_stream(conn.pSSL, SSL_ACCEPT_STREAM_NO_BLOCK)) != nullptr) {
+            // Only our control stream is unidirectional from our side, so the client's are its control & QPACK streams
+            if (SSL_get_stream_type(pStream) != SSL_STREAM_TYPE_BIDI) {
+                conn.peerStreams.push_back(pStream);
+                continue;
+            }
+
+            // Each bidirectional stream carries one request
+            if (SSL_set_blocking_mode(pStream, 0) != 1) {
+                SSL_free(pStream);
+                continue;
+            }
+            SSL_set_mode(pStream, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+            conn.streams.emplace(SSL_get_stream_id(pStream), std::make_unique<Stream>(pStream, conf::MAX_REQUEST_BODY));
+        }
+    }
+
+    // We never use a dynamic table, so the client's encoder stream has nothing to say & its SETTINGS need no reply
+    void QUICServer::drainPeerStreams(Connection& conn) {
+        for (auto itr = conn.peerStreams.begin(); itr != conn.peerStreams.end(); ) {
+            size_t bytesRead;
+            while (SSL_read_ex(*itr, this->readBuffer.data(), this->readBuffer.size(), &bytesRead) == 1);
+
+            if (SSL_get_error(*itr, 0) == SSL_ERROR_WANT_READ) {
+                ++itr;
+                continue;
+            }
+
+            SSL_free(*itr);
+            itr = conn.peerStreams.erase(itr);
+        }
+    }
+
+    // Returns false once the connection is closed & should be freed
+    bool QUICServer::serveConnection(const uint64_t connectionId, Connection& conn) {
+        SSL_CONN_CLOSE_INFO closeInfo;
+        if (SSL_get_conn_close_info(conn.pSSL, &closeInfo, sizeof(closeInfo)) == 1) return false;
+
+        // Open our control stream as soon as the client allows it
+        if (conn.pControlStream == nullptr)
+            conn.pControlStream = SSL_new_stream(conn.pSSL, SSL_STREAM_FLAG_UNI | SSL_STREAM_FLAG_NO_BLOCK);
+        if (conn.pControlStream != nullptr && !conn.controlOutput.empty()) {
+            size_t bytesWritten;
+            if (SSL_write_ex(conn.pControlStream, conn.controlOutput.data(), conn.controlOutput.size(), &bytesWritten) == 1)
+                conn.controlOutput.clear();
+        }
+
+        this->acceptStreams(conn);
+        this->drainPeerStreams(conn);
+
+        for (auto itr = conn.streams.begin(); itr != conn.streams.end(); ) {
+            Stream& stream = *itr->second;
+            const bool isOpen = stream.request.isRequestDone() ?
+                this->writeStream(stream) :
+                this->readStream(connectionId, conn, stream);
+
+            if (isOpen) ++itr;
+            else itr = conn.streams.erase(itr);
+        }
+
+        return SSL_get_conn_close_info(conn.pSSL, &closeInfo, sizeof(closeInfo)) != 1;
+    }
+
+    // Reads the request as it arrives, returns false if the stream should be freed
+    bool QUICServer::readStream(const uint64_t connectionId, Connection& conn, Stream& stream) {
+        size_t bytesRead;
+        while (!stream.request.isRequestDone()) {
+            http3::ERROR_CODE error;
+            if (SSL_read_ex(stream.pSSL, this->readBuffer.data(), this->readBuffer.size(), &bytesRead) == 1) {
+                error = stream.request.receive(this->readBuffer.data(), bytesRead);
+            } else {
+                const int sslError = SSL_get_error(stream.pSSL, 0);
+                if (sslError == SSL_ERROR_WANT_READ) return true;
+                if (sslError != SSL_ERROR_ZERO_RETURN) return false; // Reset by the client, or the connection is gone
+                error = stream.request.finish(); // The client ended its side
+            }
+
+            if (error != http3::H3_NO_ERROR) return this->handleStreamError(conn, stream, error);
+        }
+
+        this->dispatchStream(connectionId, conn, stream);
+        return true;
+    }
+
+    // Malformed requests (or bodies we failed to store) only reset their stream, but broken framing or QPACK state closes
+    // the whole connection (RFC 9114 8.1)
+    // Always returns false, since the stream is done either way
+    bool QUICServer::handleStreamError(Connection& conn, Stream& stream, const http3::ERROR_CODE error) {
+        if (error != http3::H3_MESSAGE_ERROR && error != http3::H3_REQUEST_INCOMPLETE && error != http3::H3_EXCESSIVE_LOAD &&
+            error != http3::H3_INTERNAL_ERROR) {
+            this->closeConnection(conn, error);
+            return false;
+        }
+
+        const SSL_STREAM_RESET_ARGS args = { static_cast<uint64_t>(error) };
+        if (SSL_stream_reset(stream.pSSL, &args, sizeof(args)) != 1)
+            ERROR_LOG << "Failed to reset an HTTP/3 stream (" << *this << ")." << std::endl;
+        return false;
+    }
+
+    // Answers the request on a worker, through the same handlers as HTTP/1.1 & HTTP/2
+    void QUICServer::dispatchStream(const uint64_t connectionId, const Connection& conn, Stream& stream) {
+        stream.isDispatched = true;
+        const uint64_t streamId = SSL_get_stream_id(stream.pSSL);
+
+        std::string raw;
+        stream.request.toHTTP1Request(raw);
+
+        // The worker owns the body from here on, since the stream may be gone before it's done (tasks must be copyable)
+        auto pBody = std::make_shared<RequestBody>(std::move(stream.request.body));
+
+        auto self = std::static_pointer_cast<QUICServer>(shared_from_this());
+        this->threadPool.enqueue([self, connectionId, streamId, raw = std::move(raw), pBody, clientIP = conn.clientIP]() {
+            Result result = { connectionId, streamId, nullptr, false };
+            result.pResponse = self->genStreamResponse(raw, *pBody, clientIP, "HTTP/3", result.hasBody);
+
+            {
+                std::lock_guard<std::mutex> lock(self->resultsMutex);
+                self->results.push_back(std::move(result));
+            }
+            eventfd_write(self->acceptWakeFd, 1);
+        });
+    }
+
+    // Collects the responses answered by workers since the last turn
+    void QUICServer::collectResults() {
+        std::deque<Result> ready;
+        {
+            std::lock_guard<std::mutex> lock(this->resultsMutex);
+            ready.swap(this->results);
+        }
+
+        for (Result& result : ready) {
+            const auto connItr = this->connections.find(result.connectionId);
+            if (connItr == this->connections.end()) continue; // Closed while the worker was busy
+
+            Connection& conn = *connItr->second;
+            const auto streamItr = conn.streams.find(result.streamId);
+            if (streamItr == conn.streams.end()) continue; // Reset by the client
+
+            Stream& stream = *streamItr->second;
+            stream.isDispatched = false;
+            if (result.pResponse == nullptr) {
+                this->handleStreamError(conn, stream, http3::H3_MESSAGE_ERROR);
+                conn.streams.erase(streamItr);
+                continue;
+            }
+
+            stream.request.respond(std::move(result.pResponse), result.hasBody);
+        }
+    }
+
+    // Writes as much of the response as the stream's flow control allows, returns false once the stream is done
+    bool QUICServer::writeStream(Stream& stream) {
+        if (stream.isDispatched || !stream.request.isResponding()) return true;
+
+        std::string& output = stream.request.getOutput();
+        if (stream.outputOffset == output.size()) {
+            output.clear();
+            stream.outputOffset = 0;
+            if (!stream.request.fillOutput(conf::RESPONSE_BUFFER_SIZE)) {
+                // The headers are already sent, so the body can only be cut short
+                const SSL_STREAM_RESET_ARGS args = { static_cast<uint64_t>(http3::H3_INTERNAL_ERROR) };
+                (void)SSL_stream_reset(stream.pSSL, &args, sizeof(args));
+                return false;
+            }
+        }
+
+        while (stream.outputOffset < output.size()) {
+            size_t bytesWritten;
+            if (SSL_write_ex(stream.pSSL, output.data() + stream.outputOffset, output.size() - stream.outputOffset, &bytesWritten) != 1)
+                return SSL_get_error(stream.pSSL, 0) == SSL_ERROR_WANT_WRITE; // Wait for the client to open the window
+            stream.outputOffset += bytesWritten;
+        }
+
+        if (!stream.request.isResponseDone()) {
+            this->isBusy = true; // More of the body to read
+            return true;
+        }
+
+        // Freeing a concluded stream still delivers whatever is buffered
+        (void)SSL_stream_conclude(stream.pSSL, 0);
+        return false;
+    }
+
+    void QUICServer::closeConnection(Connection& conn, const http3::ERROR_CODE error) {
+        const SSL_SHUTDOWN_EX_ARGS args = { static_cast<uint64_t>(error), nullptr };
+        (void)SSL_shutdown_ex(conn.pSSL, SSL_SHUTDOWN_FLAG_RAPID | SSL_SHUTDOWN_FLAG_NO_BLOCK, &args, sizeof(args));
+    }
+
+    // Milliseconds until OpenSSL next needs to run its timers
+    int QUICServer::getEventTimeout() {
+        struct timeval tv;
+        int isInfinite;
+        if (SSL_get_event_timeout(this->pListener, &tv, &isInfinite) != 1 || isInfinite)
+            return QUIC_MAX_WAIT_MS;
+
+        const long timeoutMS = tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000;
+        return static_cast<int>((std::min)(timeoutMS, static_cast<long>(QUIC_MAX_WAIT_MS)));
+    }
+
+}
+
+#undef QUIC_MAX_WAIT_MS
+
+#endif
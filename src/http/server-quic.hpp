@@ -0,0 +1,105 @@
+#ifndef __HTTP_SERVER_QUIC_HPP
+#define __HTTP_SERVER_QUIC_HPP
+
+#include "server.hpp"
+
+#ifdef HAS_QUIC
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "http3/stream.hpp"
+
+namespace http {
+
+    // Experimental HTTP/3 listener, a single thread drives every QUIC connection on its UDP socket (w/ OpenSSL's
+    // QUIC server) while requests are answered on the thread pool, through the same handlers as HTTP/1.1 & HTTP/2
+    class QUICServer : public Server {
+        public:
+            QUICServer(const port_t port, const bool isIPv6) : Server(port, true), _isIPv6(isIPv6) {};
+            ~QUICServer();
+
+            int bindSocket();
+            inline bool isIPv4() const { return !_isIPv6; };
+            inline bool usesQUIC() const { return true; };
+
+            int init();
+            void acceptLoop();
+            void kill();
+
+            // QUIC connections can't follow the socket to the upgraded process, so they're closed right away
+            inline void drain() { this->kill(); };
+
+            // True once any HTTP/3 listener is up, so TLS responses can advertise it w/ Alt-Svc
+            static std::atomic<bool> isListening;
+        private:
+            struct Stream {
+                SSL* pSSL;
+                http3::RequestStream request;
+                bool isDispatched = false; // Waiting on a worker for its response
+                size_t outputOffset = 0;
+
+                Stream(SSL* pSSL, const size_t maxRequestBody) : pSSL(pSSL), request(maxRequestBody) {};
+                ~Stream() { SSL_free(pSSL); }; // Resets the stream unless it was concluded
+                Stream(const Stream&) = delete; // Prevent copies
+                void operator=(const Stream&) = delete; // Prevent copies
+            };
+
+            struct Connection {
+                SSL* pSSL;
+                SSL* pControlStream = nullptr;
+                std::string controlOutput; // Our SETTINGS, until the control stream accepts it
+                std::vector<SSL*> peerStreams; // The client's control & QPACK streams, drained & otherwise ignored
+                std::unordered_map<uint64_t, std::unique_ptr<Stream>> streams;
+                std::string clientIP = "-"; // For the access log, "-" if OpenSSL couldn't give us the peer's address
+
+                explicit Connection(SSL* pSSL) : pSSL(pSSL) {};
+                ~Connection() {
+                    streams.clear();
+                    for (SSL* pStream : peerStreams) SSL_free(pStream);
+                    SSL_free(pControlStream);
+                    SSL_free(pSSL);
+                };
+                Connection(const Connection&) = delete; // Prevent copies
+                void operator=(const Connection&) = delete; // Prevent copies
+            };
+
+            // A worker's answer to a request stream, matched back by id in case the stream is gone
+            struct Result {
+                uint64_t connectionId;
+                uint64_t streamId;
+                std::unique_ptr<Response> pResponse;
+                bool hasBody;
+            };
+
+            void acceptConnections();
+            void acceptStreams(Connection& conn);
+            void drainPeerStreams(Connection& conn);
+            bool serveConnection(const uint64_t connectionId, Connection& conn);
+            bool readStream(const uint64_t connectionId, Connection& conn, Stream& stream);
+            bool handleStreamError(Connection& conn, Stream& stream, const http3::ERROR_CODE error);
+            void dispatchStream(const uint64_t connectionId, const Connection& conn, Stream& stream);
+            bool writeStream(Stream& stream);
+            void collectResults();
+            void closeConnection(Connection& conn, const http3::ERROR_CODE error);
+            int getEventTimeout();
+
+            const bool _isIPv6;
+            SSL* pListener = nullptr;
+
+            std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections;
+            uint64_t nextConnectionId = 0;
+            bool isBusy = false; // A stream made progress w/out needing the network, so don't wait on it
+            std::vector<char> readBuffer;
+
+            std::deque<Result> results;
+            std::mutex resultsMutex;
+    };
+
+}
+
+#endif
+
+#endif
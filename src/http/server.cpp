@@ -1,19 +1,30 @@
 #include "server.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <sys/eventfd.h>
+    #include <sys/sendfile.h>
+#endif
+
 #include "../conf/conf.hpp"
 #include "../io/file.hpp"
 #include "../logs/logger.hpp"
 #include "../util/string_tools.hpp"
 #include "../util/toolbox.hpp"
 
+#include "server-quic.hpp"
+#include "socket_handoff.hpp"
 #include "tools.hpp"
 #include "version/handler_1_1.hpp"
 #include "version/handler_1_0.hpp"
 #include "version/handler_0_9.hpp"
 
-#define SOCKET_DRAIN_BUFFER_SIZE 8192
+#define EVENT_LOOP_SWEEP_MS 1000
+#define ACCEPT_ERROR_BACKOFF_MS 100
 
 #ifdef _WIN32
     #define close closesocket
@@ -21,10 +32,31 @@
 
 namespace http {
 
-    Server::Server(const port_t port, const bool useTLS) : port(port),
-        threadPool(), useTLS(useTLS) {};
+    Server::Server(const port_t port, const bool useTLS, const unsigned int shardIndex) : port(port),
+        shardIndex(shardIndex), threadPool(conf::IDLE_THREADS_PER_CHILD, conf::MAX_THREADS_PER_CHILD), useTLS(useTLS) {};
+
+    Server::~Server() {
+        #ifdef __linux__
+            if (this->acceptWakeFd != -1) close(this->acceptWakeFd);
+        #endif
+    }
 
     void Server::kill() {
+        #ifdef __linux__
+            // Wake the accept loop
+            this->isExiting.store(true);
+            if (this->acceptWakeFd != -1)
+                eventfd_write(this->acceptWakeFd, 1);
+
+            // Stop the event loop before closing the connections it owns
+            if (this->pEventLoop != nullptr) {
+                this->pEventLoop->wake();
+                if (this->eventThread.joinable())
+                    this->eventThread.join();
+                this->closeAllConnections();
+            }
+        #endif
+
         // Close sockets
         for (const int c_sock : this->clientSocks)
             if (c_sock != SOCKET_UNSET)
@@ -43,7 +75,42 @@ namespace http {
         this->threadPool.stop();
     }
 
+    // Stops accepting & closes keep-alive connections once their current request is answered
+    // The listening socket is left open, since the upgraded process accepts from the same one
+    void Server::drain() {
+        this->isDraining.store(true);
+
+        #ifdef __linux__
+            // Wake the accept loop
+            if (this->acceptWakeFd != -1)
+                eventfd_write(this->acceptWakeFd, 1);
+        #endif
+    }
+
+    // True once a draining server has no requests left in flight
+    bool Server::isDrained() {
+        size_t usedThreads = 0, totalThreads = 0, pendingConnections = 0;
+        threadPool.getUsageInfo(usedThreads, totalThreads, pendingConnections);
+        if (usedThreads > 0 || pendingConnections > 0) return false;
+
+        #ifdef __linux__
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            return this->connections.empty();
+        #else
+            return true;
+        #endif
+    }
+
     int Server::bindSocket() {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(this->port);
+        memcpy(&addr.sin_addr, conf::BIND_ADDR_IPV4->bytes, 4);
+
+        // Reuse the socket passed on by the process being upgraded (or systemd), so the port is never unbound
+        if ((this->sock = takeInheritedSocket(SOCK_STREAM, (const struct sockaddr*)&addr)) != SOCKET_UNSET)
+            return 0;
+
         // Open the socket
         this->sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
 
@@ -62,11 +129,6 @@ namespace http {
         #endif
 
         // Bind the host address
-        struct sockaddr_in addr;
-        addr.sin_family = AF_INET;
-        addr.sin_port = htons(this->port);
-        memcpy(&addr.sin_addr, conf::BIND_ADDR_IPV4->bytes, 4);
-
         if (bind(this->sock, (const struct sockaddr*)&addr, sizeof(addr)) < 0) {
             #ifdef _WIN32
                 int lastErrno = WSAGetLastError();
@@ -106,14 +168,42 @@ namespace http {
             return LISTEN_FAILURE;
         }
 
+        #ifdef __linux__
+            // Accept without blocking, using an eventfd to interrupt the wait on shutdown
+            const int listenFlags = fcntl(this->sock, F_GETFL, 0);
+            if (listenFlags < 0 || fcntl(this->sock, F_SETFL, listenFlags | O_NONBLOCK) < 0 ||
+                (this->acceptWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+                ERROR_LOG << "Failed to init the accept loop (" << *this << ")." << std::endl;
+                return SOCKET_FAILURE;
+            }
+        #endif
+
         // Init TLS
         if (this->useTLS) {
-            if ((this->pSSL_CTX = initTLSContext()) == nullptr) {
+            if ((this->pSSL_CTX = getSharedTLSContext()) == nullptr) {
                 ERROR_LOG << "Failed to init an SSL context (" << *this << ")." << std::endl;
                 return BIND_FAILURE;
             }
         }
 
+        #ifdef __linux__
+            // Keep each shard's workers on its own slice of the cores
+            if (conf::ACCEPT_SHARDS > 1) {
+                cpu_set_t cpuSet;
+                getShardCPUSet(this->shardIndex, conf::ACCEPT_SHARDS, cpuSet);
+                this->threadPool.setCPUAffinity(cpuSet);
+            }
+
+            // Start the event loop, which parks idle keep-alive connections in either ConnectionMode
+            this->pEventLoop = std::make_unique<EventLoop>();
+            if (!this->pEventLoop->init()) {
+                ERROR_LOG << "Failed to init the event loop (" << *this << ")." << std::endl;
+                this->pEventLoop.reset();
+                return SOCKET_FAILURE;
+            }
+            this->eventThread = std::thread([this]() { this->eventLoop(); });
+        #endif
+
         ACCESS_LOG << "Listening on port " << this->port << " (" << *this << ")." << std::endl;
         return 0;
     }
@@ -126,17 +216,155 @@ namespace http {
     }
 
     ssize_t Server::writeClientSock(const int client, SSL* pSSL, const char* resBuffer, const size_t n) {
-        ssize_t status;
+        size_t totalSent = 0;
+        while (totalSent < n) {
+            ssize_t status;
+            if (this->useTLS) {
+                status = SSL_write(pSSL, resBuffer + totalSent, n - totalSent);
+            } else {
+                #ifndef _WIN32
+                    status = send(client, resBuffer + totalSent, n - totalSent, MSG_NOSIGNAL);
+                #else
+                    status = send(client, resBuffer + totalSent, n - totalSent, 0);
+                #endif
+            }
+
+            if (status > 0) {
+                totalSent += static_cast<size_t>(status);
+                continue;
+            }
+
+            // Non-blocking sockets (event mode) must wait for the send buffer to drain
+            if (status == 0 || !this->isWouldBlock(pSSL, status)) return -1;
+
+            struct pollfd pfd; pfd.fd = client;
+            const ssize_t pollStatus = this->waitForClientWritable(pfd, conf::KEEP_ALIVE_TIMEOUT * 1000);
+            if (pollStatus <= 0 || (pfd.revents & (POLLHUP | POLLERR))) return -1;
+        }
+        return static_cast<ssize_t>(totalSent);
+    }
+
+    // Writes every slice in as few calls as possible, as one sendmsg for plaintext or one coalesced SSL_write for TLS
+    // If hasMore is set, plaintext sends tell the kernel to hold a partial segment back for the rest of the response
+    ssize_t Server::writevClientSock(const int client, SSL* pSSL, const io_slice_t* slices, const size_t numSlices, [[maybe_unused]] const bool hasMore) {
+        #ifndef _WIN32
+            if (!this->useTLS && numSlices <= MAX_IO_SLICES) {
+                struct iovec iov[MAX_IO_SLICES];
+                for (size_t i = 0; i < numSlices; ++i)
+                    iov[i] = { const_cast<char*>(slices[i].data), slices[i].size };
+
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = iov;
+                msg.msg_iovlen = numSlices;
+
+                size_t totalSent = 0;
+                while (msg.msg_iovlen > 0) {
+                    #ifdef __linux__
+                        const ssize_t status = sendmsg(client, &msg, MSG_NOSIGNAL | (hasMore ? MSG_MORE : 0));
+                    #else
+                        const ssize_t status = sendmsg(client, &msg, MSG_NOSIGNAL);
+                    #endif
+
+                    if (status > 0) {
+                        totalSent += static_cast<size_t>(status);
+
+                        // Skip the slices that were fully sent & trim a partially sent one
+                        size_t n = static_cast<size_t>(status);
+                        while (msg.msg_iovlen > 0 && n >= msg.msg_iov->iov_len) {
+                            n -= msg.msg_iov->iov_len;
+                            ++msg.msg_iov;
+                            --msg.msg_iovlen;
+                        }
+
+                        if (msg.msg_iovlen > 0) {
+                            msg.msg_iov->iov_base = static_cast<char*>(msg.msg_iov->iov_base) + n;
+                            msg.msg_iov->iov_len -= n;
+                        }
+                        continue;
+                    }
+
+                    // Non-blocking sockets (event mode) must wait for the send buffer to drain
+                    if (status == 0 || !this->isWouldBlock(pSSL, status)) return -1;
+
+                    struct pollfd pfd; pfd.fd = client;
+                    const ssize_t pollStatus = this->waitForClientWritable(pfd, conf::KEEP_ALIVE_TIMEOUT * 1000);
+                    if (pollStatus <= 0 || (pfd.revents & (POLLHUP | POLLERR))) return -1;
+                }
+                return static_cast<ssize_t>(totalSent);
+            }
+        #endif
+
+        // TLS takes a single buffer per write, so coalesce the slices into one record
+        if (numSlices == 1)
+            return this->writeClientSock(client, pSSL, slices[0].data, slices[0].size);
+
+        std::string coalesced;
+        for (size_t i = 0; i < numSlices; ++i)
+            coalesced.append(slices[i].data, slices[i].size);
+        return this->writeClientSock(client, pSSL, coalesced.data(), coalesced.size());
+    }
+
+    // Sends any segments held back by a plaintext write w/ hasMore set
+    void Server::pushClientSock([[maybe_unused]] const int client) {
+        #ifdef __linux__
+            // Setting TCP_NODELAY (even if already set) flushes pending segments
+            const int optFlag = 1;
+            if (!this->useTLS)
+                setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &optFlag, sizeof(optFlag));
+        #endif
+    }
+
+    #ifdef __linux__
+        // Sends n bytes of fd from offset w/ sendfile, so the file never passes through userspace
+        // TLS connections must have kTLS send offload active, in which case SSL_sendfile is used
+        ssize_t Server::sendFileClientSock(const int client, SSL* pSSL, const int fd, const size_t offset, const size_t n) {
+            off_t fileOffset = static_cast<off_t>(offset);
+            size_t totalSent = 0;
+            while (totalSent < n) {
+                ssize_t status;
+                if (this->useTLS) {
+                    #ifdef HAS_KTLS
+                        status = SSL_sendfile(pSSL, fd, fileOffset, n - totalSent, 0);
+                        if (status > 0) fileOffset += static_cast<off_t>(status);
+                    #else
+                        return -1;
+                    #endif
+                } else {
+                    status = sendfile(client, fd, &fileOffset, n - totalSent);
+                }
+
+                if (status > 0) {
+                    totalSent += static_cast<size_t>(status);
+                    continue;
+                }
+
+                // The file shrank while being sent
+                if (status == 0) return totalSent > 0 ? static_cast<ssize_t>(totalSent) : -1;
+
+                // Non-blocking sockets (event mode) must wait for the send buffer to drain
+                if (!this->isWouldBlock(pSSL, status)) return -1;
+
+                struct pollfd pfd; pfd.fd = client;
+                const ssize_t pollStatus = this->waitForClientWritable(pfd, conf::KEEP_ALIVE_TIMEOUT * 1000);
+                if (pollStatus <= 0 || (pfd.revents & (POLLHUP | POLLERR))) return -1;
+            }
+            return static_cast<ssize_t>(totalSent);
+        }
+    #endif
+
+    // Returns true if a failed read/write only failed because the socket isn't ready
+    bool Server::isWouldBlock(SSL* pSSL, const ssize_t status) const {
         if (this->useTLS) {
-            status = SSL_write(pSSL, resBuffer, n);
-        } else {
-            #ifndef _WIN32
-                status = send(client, resBuffer, n, MSG_NOSIGNAL);
-            #else
-                status = send(client, resBuffer, n, 0);
-            #endif
+            const int err = SSL_get_error(pSSL, static_cast<int>(status));
+            return err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE;
         }
-        return (status <= 0) ? -1 : status;
+
+        #ifdef _WIN32
+            return WSAGetLastError() == WSAEWOULDBLOCK;
+        #else
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        #endif
     }
 
     int Server::closeSocket(const int sock) {
@@ -152,13 +380,40 @@ namespace http {
         return this->closeSocket(sock);
     }
 
-    void Server::drainClientSocket(const int sock, SSL* pSSL, size_t size) {
-        char buffer[SOCKET_DRAIN_BUFFER_SIZE];
-        while (size > 0) {
-            ssize_t bytesRead = this->readClientSock(buffer, sock, pSSL);
-            if (bytesRead <= 0) break; // Connection closed
-            if (static_cast<size_t>(bytesRead) > size) break;
-            size -= static_cast<size_t>(bytesRead);
+    bool Server::isQueueFull() const {
+        return conf::MAX_QUEUED_CONNECTIONS > 0 && threadPool.getNumPending() >= conf::MAX_QUEUED_CONNECTIONS;
+    }
+
+    // True if a connection waited on a thread for longer than MaxQueueWait, by which point the client has likely given up
+    bool Server::hasQueueWaitExpired(const conn_time_t queuedAt) {
+        return conf::MAX_QUEUE_WAIT > 0 &&
+            std::chrono::steady_clock::now() - queuedAt > std::chrono::milliseconds(conf::MAX_QUEUE_WAIT);
+    }
+
+    // Sends a pre-serialized 503 to a connection that's being turned away, the caller then closes it
+    // The write is never retried, since waiting on a slow client is what's being avoided
+    void Server::shedConnection(const int sock, SSL* pSSL) {
+        static const std::string SHED_RESPONSE = "HTTP/1.1 503 Service Unavailable\r\n"
+            "Retry-After: " + std::to_string(conf::LOAD_SHED_RETRY_AFTER) + "\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n\r\n";
+
+        ++numShedConnections;
+        this->writeClientSockOnce(sock, pSSL, SHED_RESPONSE.data(), SHED_RESPONSE.size());
+    }
+
+    // Writes whatever the socket takes right away & drops the rest, for a connection that's about to be closed
+    // TLS connections mid-handshake (pSSL is nullptr, or the handshake isn't finished) are skipped
+    void Server::writeClientSockOnce(const int sock, SSL* pSSL, const char* data, const size_t size) {
+        if (this->useTLS) {
+            if (pSSL != nullptr && SSL_is_init_finished(pSSL))
+                SSL_write(pSSL, data, static_cast<int>(size));
+        } else {
+            #ifdef _WIN32
+                send(sock, data, static_cast<int>(size), 0);
+            #else
+                send(sock, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+            #endif
         }
     }
 
@@ -187,6 +442,12 @@ namespace http {
         return poll(&pfd, 1, timeoutMS);
     }
 
+    ssize_t Server::waitForClientWritable(struct pollfd& pfd, const int timeoutMS) {
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        return poll(&pfd, 1, timeoutMS);
+    }
+
     void Server::trackClient(const int client) {
         std::unique_lock lock(clientsMutex);
         this->clientSocks.insert(client);
@@ -198,22 +459,53 @@ namespace http {
     }
 
     int Server::acceptConnection(struct sockaddr_storage& clientAddr, socklen_t& clientLen) {
-        fd_set fds;
-        FD_ZERO(&fds);
-        FD_SET(this->sock, &fds);
+        #ifdef __linux__
+            // Drain the accept queue, only waiting once it's empty
+            while (!this->isExiting && !this->isDraining) {
+                const int client = accept4(this->sock, (struct sockaddr*)&clientAddr, &clientLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (client >= 0) return client;
+                if (errno == ECONNABORTED || errno == EINTR) continue; // Client gave up, try the next one
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    // Back off while out of fds/memory, since the listening socket stays readable
+                    struct pollfd wakePfd; wakePfd.fd = this->acceptWakeFd; wakePfd.events = POLLIN; wakePfd.revents = 0;
+                    poll(&wakePfd, 1, ACCEPT_ERROR_BACKOFF_MS);
+                    return -1;
+                }
 
-        struct timeval tv;
-        tv.tv_sec = 1; // 1 second timeout
-        tv.tv_usec = 0;
+                // Wait for a new connection or the shutdown signal
+                struct pollfd pfds[2];
+                pfds[0].fd = this->sock; pfds[0].events = POLLIN; pfds[0].revents = 0;
+                pfds[1].fd = this->acceptWakeFd; pfds[1].events = POLLIN; pfds[1].revents = 0;
+                if (poll(pfds, 2, -1) < 0 && errno != EINTR) return -1;
+            }
+            return -1;
+        #else
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(this->sock, &fds);
 
-        int rv = select(this->sock + 1, &fds, nullptr, nullptr, &tv);
-        if (rv <= 0) return -1; // Timeout or error
+            struct timeval tv;
+            tv.tv_sec = 1; // 1 second timeout
+            tv.tv_usec = 0;
 
-        return accept(this->sock, (struct sockaddr*)&clientAddr, &clientLen);
+            int rv = select(this->sock + 1, &fds, nullptr, nullptr, &tv);
+            if (rv <= 0) return -1; // Timeout or error
+
+            return accept(this->sock, (struct sockaddr*)&clientAddr, &clientLen);
+        #endif
     }
 
     void Server::acceptLoop() {
-        while (!this->isExiting) {
+        #ifdef __linux__
+            // Pin the acceptor to the same cores as its workers
+            if (conf::ACCEPT_SHARDS > 1) {
+                cpu_set_t cpuSet;
+                getShardCPUSet(this->shardIndex, conf::ACCEPT_SHARDS, cpuSet);
+                setThreadCPUAffinity(pthread_self(), cpuSet);
+            }
+        #endif
+
+        while (!this->isExiting && !this->isDraining) {
             struct sockaddr_storage clientAddr;
             socklen_t clientLen = sizeof(clientAddr);
             char clientIPStr[INET6_ADDRSTRLEN];
@@ -226,189 +518,699 @@ namespace http {
             this->trackClient(client);
             this->extractClientIP(clientAddr, clientIPStr); // Read client IP
 
+            #ifdef __linux__
+                // Hand the connection to the event loop instead of a dedicated worker
+                // TLS connections always start there, so their handshakes don't hold a worker while waiting on the client
+                if (conf::CONNECTION_MODE == CONN_MODE_EVENT || this->useTLS) {
+                    this->openEventConnection(client, clientIPStr);
+                    continue;
+                }
+            #endif
+
+            // Turn the connection away instead of growing the backlog once every thread is busy
+            if (this->isQueueFull()) {
+                this->shedConnection(client, nullptr);
+                this->closeClientSocket(client, nullptr);
+                continue;
+            }
+
             // Detach new thread
             auto self = shared_from_this(); // Must inherit from enable_shared_from_this
-            threadPool.enqueue([self, client, ip = std::move(clientIPStr)]() mutable {
+            const conn_time_t queuedAt = std::chrono::steady_clock::now();
+            threadPool.enqueue([self, client, ip = std::move(clientIPStr), queuedAt]() mutable {
+                if (hasQueueWaitExpired(queuedAt)) {
+                    self->shedConnection(client, nullptr);
+                    self->closeClientSocket(client, nullptr);
+                    return;
+                }
+
                 self->handleReqs(client, std::move(ip));
             });
         }
     }
 
+    // Performs the TLS handshake on the calling thread, returns false if the connection was closed
+    // Only used where there's no event loop, otherwise handshakes are driven by advanceHandshake
+    bool Server::acceptTLS(const int client, SSL*& pSSL) {
+        pSSL = SSL_new(this->pSSL_CTX);
+        SSL_set_fd(pSSL, client);
+
+        // Wait on the socket between handshake steps, until the handshake deadline
+        const conn_time_t deadline = std::chrono::steady_clock::now() + std::chrono::seconds(conf::TLS_HANDSHAKE_TIMEOUT);
+        int status;
+        while ((status = SSL_accept(pSSL)) <= 0) {
+            const int err = SSL_get_error(pSSL, status);
+            if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE)
+                break;
+
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) break; // Handshake timed out
+
+            struct pollfd pfd; pfd.fd = client;
+            const ssize_t pollStatus = err == SSL_ERROR_WANT_READ ?
+                this->waitForClientData(pfd, static_cast<int>(remaining.count())) :
+                this->waitForClientWritable(pfd, static_cast<int>(remaining.count()));
+            if (pollStatus <= 0 || (pfd.revents & (POLLHUP | POLLERR)))
+                break; // Fatal error or timeout
+        }
+
+        if (status <= 0) {
+            this->closeClientSocket(client, pSSL);
+            return false;
+        }
+
+        recordTLSHandshake(pSSL);
+        return true;
+    }
+
     // Accept requests from clients
     void Server::handleReqs(const int client, const std::string clientIPStr) {
         // Create SSL context
         SSL* pSSL = nullptr;
-        if (this->useTLS) {
-            pSSL = SSL_new(this->pSSL_CTX);
-            SSL_set_fd(pSSL, client);
+        if (this->useTLS && !this->acceptTLS(client, pSSL))
+            return;
 
-            if (SSL_accept(pSSL) <= 0) {
-                this->closeClientSocket(client, pSSL);
-                return;
-            }
+        // Track keep-alive requests for a given connection
+        auto pConn = std::make_unique<Connection>(client, pSSL, clientIPStr, static_cast<int>( conf::MAX_KEEP_ALIVE_REQUESTS ));
+        if (pSSL != nullptr && isHTTP2Negotiated(pSSL))
+            pConn->pHTTP2 = std::make_unique<http2::Session>(conf::HTTP2_MAX_CONCURRENT_STREAMS, conf::MAX_REQUEST_BODY);
+
+        // Stops on connection closed by client, timeout, or bad framing
+        int status = REQUEST_READY;
+        while (pConn->pHTTP2 == nullptr && (status = this->readRequest(*pConn)) == REQUEST_READY && this->processRequest(*pConn)) {
+            pConn->resetRequest(); // Clear previous request
+
+            #ifdef __linux__
+                // Park the idle connection instead of holding this thread until the next request arrives
+                if (pConn->buffer.empty()) {
+                    this->registerConnection(std::move(pConn));
+                    return;
+                }
+            #endif
+        }
+
+        // The rest of the connection is HTTP/2
+        if (pConn->pHTTP2 != nullptr || status == REQUEST_HTTP2) {
+            #ifdef __linux__
+                if (this->serveHTTP2(*pConn, true)) {
+                    this->registerConnection(std::move(pConn));
+                    return;
+                }
+            #else
+                this->serveHTTP2(*pConn, false);
+            #endif
+        }
+
+        // Close client socket & cleanup TLS
+        this->closeClientSocket(client, pSSL);
+    }
+
+    // Parses any newly buffered bytes of the request
+    // Returns REQUEST_READY once the whole request is received, REQUEST_INCOMPLETE if more data is needed,
+    // or REQUEST_INVALID if the connection should be closed (ie. non-CRLF lines, bad body framing headers or chunks)
+    // Plaintext connections may instead open w/ the HTTP/2 preface (prior knowledge), which returns REQUEST_HTTP2
+    // Unless canSpillBody is set, returns REQUEST_LARGE_BODY before loading a body that may have to be spilled to disk
+    int Server::loadRequestFraming(Connection& conn, const bool canSpillBody) {
+        // Only the first request on a connection can switch it to HTTP/2
+        if (conf::ENABLE_HTTP2 && !this->useTLS && conn.keepAliveReqsLeft == static_cast<int>( conf::MAX_KEEP_ALIVE_REQUESTS )) {
+            const size_t n = (std::min)(conn.buffer.size(), static_cast<size_t>(HTTP2_PREFACE_SIZE));
+            if (n > 0 && conn.buffer.compare(0, n, HTTP2_PREFACE, n) == 0)
+                return n < HTTP2_PREFACE_SIZE ? REQUEST_INCOMPLETE : REQUEST_HTTP2;
+        }
+
+        // The header deadline starts w/ the request's first byte
+        if (!conn.buffer.empty()) conn.requestTimer.startHeaders();
+
+        const int status = conn.parser.parse(conn.buffer, conn.headers, conn.reqFlags);
+        if (status != REQUEST_READY) return status;
+
+        // The body is streamed out of the buffer as it arrives, & any pipelined requests are held back until this one is answered
+        conn.requestTimer.startBody();
+        if (!canSpillBody && conn.mayBodySpill(conf::REQUEST_BUFFER_SIZE)) return REQUEST_LARGE_BODY;
+        if (!conn.loadBody()) return REQUEST_INVALID;
+        if (conn.isBodyComplete()) return REQUEST_READY;
+
+        // Let the client know whether to send the body before waiting on it (HTTP/1.0 clients can't be sent 100 Continue)
+        if (!conn.isExpectationAnswered && conn.parser.getVersion(conn.buffer) == "HTTP/1.1") {
+            const std::optional<std::string_view> expect = conn.headers.get("Expect");
+            if (expect.has_value() && caseInsensitiveEquals(*expect, "100-continue"))
+                return REQUEST_CONTINUE;
         }
 
+        return REQUEST_INCOMPLETE;
+    }
+
+    // How long to wait for more of the request, either the keep-alive timeout or whatever's left before its deadline
+    int Server::getReadTimeoutMS(const Connection& conn) {
+        const int keepAliveMS = static_cast<int>(conf::KEEP_ALIVE_TIMEOUT) * 1000;
+        if (!conn.requestTimer.isRunning()) return keepAliveMS;
+
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(conn.requestTimer.getDeadline() - std::chrono::steady_clock::now());
+        return static_cast<int>( (std::clamp)(remaining.count(), static_cast<std::chrono::milliseconds::rep>(0), static_cast<std::chrono::milliseconds::rep>(keepAliveMS)) );
+    }
+
+    // Blocks until the next request is fully received (ConnectionMode "threaded")
+    int Server::readRequest(Connection& conn) {
         // Create read buffer per-thread
         thread_local std::vector<char> readBuffer(conf::REQUEST_BUFFER_SIZE);
-        this->clearBuffer(readBuffer);
 
-        // Track keep-alive requests for a given connection
+        int framingStatus;
+        while ((framingStatus = this->loadRequestFraming(conn)) == REQUEST_INCOMPLETE || framingStatus == REQUEST_CONTINUE) {
+            if (isExiting) return REQUEST_INVALID; // Program closed
+            if (conn.requestTimer.hasExpired(std::chrono::steady_clock::now())) return REQUEST_INVALID; // Too slow sending the request
+
+            // Either invite the body or answer right away w/out it
+            if (framingStatus == REQUEST_CONTINUE && (framingStatus = this->answerExpectation(conn)) != REQUEST_INCOMPLETE)
+                return framingStatus;
+
+            // Poll for data, for no longer than the request has left
+            // Unless TLS already holds some, ie. the rest of a record the event loop left for us w/ REQUEST_LARGE_BODY
+            if (!this->useTLS || !SSL_has_pending(conn.pSSL)) {
+                struct pollfd pfd; pfd.fd = conn.sock;
+                const ssize_t pollStatus = this->waitForClientData(pfd, getReadTimeoutMS(conn));
+                if (pollStatus <= 0 || (pfd.revents & (POLLHUP | POLLERR)))
+                    return REQUEST_INVALID; // Fatal error or timeout
+
+                // Check for POLLIN event
+                if (!(pfd.revents & POLLIN)) continue;
+            }
+
+            // Read buffer (regardless of TLS or not, keep looping if TLS)
+            do {
+                const ssize_t bytesReceived = this->readClientSock(readBuffer.data(), conn.sock, conn.pSSL);
+                if (bytesReceived < 0 && this->isWouldBlock(conn.pSSL, bytesReceived)) break; // ie. partial TLS record
+                if (bytesReceived <= 0) return REQUEST_INVALID; // Connection closed by client
+                if (!conn.receive(readBuffer.data(), bytesReceived)) return REQUEST_INVALID; // ie. the body couldn't be spilled to disk
+            } while (this->useTLS && SSL_pending(conn.pSSL) > 0);
+        }
+
+        return framingStatus;
+    }
+
+    // Answers "Expect: 100-continue" once the headers are in, so the body is only uploaded if the request will be handled
+    // Returns REQUEST_INCOMPLETE once 100 Continue is sent, REQUEST_READY if the request is turned away (its final response is
+    // then sent w/out reading the body), or REQUEST_INVALID if the connection should be closed
+    int Server::answerExpectation(Connection& conn) {
+        conn.isExpectationAnswered = true;
+
+        try {
+            Request request(conn.headers, conn.buffer, conn.parser, conn.body, conn.clientIP, useTLS, conn.reqFlags, conn.getConfig());
+            conn.pRejection = genEarlyResponse(request);
+            conn.reqFlags.isRateLimitCharged = true; // Don't charge the rate limits again once the body is in
+            if (conn.pRejection != nullptr) {
+                conn.reqFlags.isBodyUnread = true; // The connection can't be reused, since the body may still be sent
+                return REQUEST_READY;
+            }
+        } catch (http::Exception& e) {
+            return REQUEST_INVALID; // Handles invalid requests syntax (ie. non-CRLF)
+        }
+
+        static constexpr char CONTINUE_RESPONSE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        if (this->writeClientSock(conn.sock, conn.pSSL, CONTINUE_RESPONSE, sizeof(CONTINUE_RESPONSE) - 1) < 0)
+            return REQUEST_INVALID;
+
+        return REQUEST_INCOMPLETE;
+    }
+
+    // Parses and responds to the buffered request
+    // Returns true if the connection should be kept alive for another request
+    bool Server::processRequest(Connection& conn) {
+        RequestFlags& reqFlags = conn.reqFlags;
+
+        // Close the connection if the request line never finished (ie. an oversized URI w/o CRLF)
+        if (!conn.parser.hasRequestLine())
+            return false;
+
+        // Parse request
+        std::unique_ptr<Response> pResponse = nullptr;
+        try {
+            Request request(conn.headers, conn.buffer, conn.parser, conn.body, conn.clientIP, useTLS, reqFlags, conn.getConfig());
+
+            // Generate response, unless it was already made while answering "Expect: 100-continue"
+            pResponse = conn.pRejection != nullptr ? std::move(conn.pRejection) : genResponse(request);
+
+            // Handle keep-alive requests
+            const std::optional<std::string_view> connHeader = request.getHeader(HEADER_CONNECTION);
+            std::string connValue( connHeader.value_or("") ); // Copy string
+            strToUpper(connValue); // Format copied string
+            if (conf::IS_KEEP_ALIVE_ENABLED &&
+                !reqFlags.isContentTooLarge && !reqFlags.isURITooLong && !reqFlags.isBodyUnread && !this->isDraining &&
+                (connValue == "KEEP-ALIVE" || (connValue == "" && request.getVersion() == "HTTP/1.1"))) {
+                // HTTP/1.1 defaults to keep-alive
+                pResponse->setHeader("Connection", "keep-alive");
+                pResponse->setHeader("Keep-Alive",
+                            "timeout=" + std::to_string(conf::KEEP_ALIVE_TIMEOUT) +
+                            ", max=" + std::to_string(conf::MAX_KEEP_ALIVE_REQUESTS));
+                --conn.keepAliveReqsLeft;
+            } else { // Close connection
+                pResponse->setHeader("Connection", "close");
+                conn.keepAliveReqsLeft = 0;
+            }
+
+            // Load response to buffer
+            const bool omitBody = request.getMethod() == http::METHOD::HEAD;
+            SocketWriter writer(
+                [this, &conn](const io_slice_t* slices, const size_t numSlices, const bool hasMore) -> ssize_t {
+                    return this->writevClientSock(conn.sock, conn.pSSL, slices, numSlices, hasMore);
+                },
+                [this, &conn]() { this->pushClientSock(conn.sock); },
+                conf::RESPONSE_BUFFER_SIZE
+            );
+
+            // File bodies skip the userspace copy over plaintext, or over TLS once the kernel handles encryption
+            #ifdef __linux__
+                #ifdef HAS_KTLS
+                    const bool isZeroCopyAllowed = !this->useTLS || BIO_get_ktls_send(SSL_get_wbio(conn.pSSL));
+                #else
+                    const bool isZeroCopyAllowed = !this->useTLS;
+                #endif
+
+                if (isZeroCopyAllowed) {
+                    writer.setSendFileFunc([this, &conn](const int fd, const size_t offset, const size_t n) -> ssize_t {
+                        return this->sendFileClientSock(conn.sock, conn.pSSL, fd, offset, n);
+                    });
+                }
+            #endif
+
+            // Handle write failure
+            ssize_t sendStatus = pResponse->streamBody(request.isMIMEAccepted("text/html"), omitBody, writer);
+            if (sendStatus >= 0) sendStatus = writer.flush();
+
+            // Log request
+            ACCESS_LOG << request.getMethodStr() << ' '
+                    << formatClientIP( request.getIPStr(), request.isDNT() ) << ' '
+                    << request.getPaths().rawPathFromRequest
+                    << " -- (" << pResponse->getStatus() << ") ["
+                    << request.getVersion() << ']'
+                    << std::endl; // Flush w/ endl vs newline
+
+            // Handle connection closure OR Content Too Large
+            if (sendStatus < 0 || pResponse->getStatus() == 413)
+                return false;
+        } catch (http::Exception& e) {
+            return false; // Handles invalid requests syntax (ie. non-CRLF)
+        }
+
+        return conn.keepAliveReqsLeft > 0 && !reqFlags.isContentTooLarge && !reqFlags.isURITooLong && !reqFlags.isBodyUnread;
+    }
+
+    // Answers requests on an HTTP/2 connection until it's idle or closed
+    // Returns true if the connection should be parked in the event loop until the client sends more (only if isParkingAllowed)
+    bool Server::serveHTTP2(Connection& conn, const bool isParkingAllowed) {
+        thread_local std::vector<char> readBuffer(conf::REQUEST_BUFFER_SIZE);
+
+        if (conn.pHTTP2 == nullptr)
+            conn.pHTTP2 = std::make_unique<http2::Session>(conf::HTTP2_MAX_CONCURRENT_STREAMS, conf::MAX_REQUEST_BODY);
+        http2::Session& session = *conn.pHTTP2;
+
+        // Bytes already read while looking for an HTTP/1.x request (ie. the preface)
+        bool isOpen = conn.buffer.empty() || session.receive(conn.buffer.data(), conn.buffer.size());
+        conn.buffer.clear();
+
+        while (true) {
+            // Answer every complete request, then send what the flow control windows allow
+            // Responses are sent a frame per stream at a time, so a large body doesn't hold up the others
+            while (http2::Stream* pStream = isOpen ? session.nextRequest() : nullptr)
+                this->processHTTP2Request(conn, *pStream);
+
+            session.fillOutput(conf::RESPONSE_BUFFER_SIZE);
+            if (!this->flushHTTP2(conn) || !isOpen || session.isClosed() || this->isExiting)
+                return false;
+
+            // Only wait on the client if there's nothing left to send, ie. until a new request or a WINDOW_UPDATE
+            const bool canSend = session.canSend();
+            if (!this->useTLS || SSL_pending(conn.pSSL) == 0) {
+                struct pollfd pfd; pfd.fd = conn.sock;
+                const ssize_t pollStatus = this->waitForClientData(pfd, canSend || isParkingAllowed ? 0 : conf::KEEP_ALIVE_TIMEOUT * 1000);
+                if (pollStatus < 0 || (pfd.revents & (POLLHUP | POLLERR)))
+                    return false; // Fatal error
+
+                if (pollStatus == 0) {
+                    if (canSend) continue;
+                    if (isParkingAllowed && !this->isDraining) return true; // Wait in the event loop instead
+
+                    // Idle, refuse any new streams before closing
+                    session.goAway(http2::H2_NO_ERROR);
+                    this->flushHTTP2(conn);
+                    return false;
+                }
+
+                if (!(pfd.revents & POLLIN)) continue;
+            }
+
+            do {
+                const ssize_t bytesReceived = this->readClientSock(readBuffer.data(), conn.sock, conn.pSSL);
+                if (bytesReceived < 0 && this->isWouldBlock(conn.pSSL, bytesReceived)) break; // ie. partial TLS record
+                if (bytesReceived <= 0) return false; // Connection closed by client
+                isOpen = session.receive(readBuffer.data(), bytesReceived); // On a connection error, the GOAWAY is sent next
+            } while (isOpen && this->useTLS && SSL_pending(conn.pSSL) > 0);
+        }
+    }
+
+    // Answers a stream's request through the same handlers as HTTP/1.1, the body is then sent by the session
+    void Server::processHTTP2Request(Connection& conn, http2::Stream& stream) {
+        http2::Session& session = *conn.pHTTP2;
+
+        std::string raw;
+        stream.toHTTP1Request(raw);
+
+        bool hasBody;
+        std::unique_ptr<Response> pResponse = genStreamResponse(raw, stream.body, conn.clientIP, "HTTP/2", hasBody);
+        stream.body.clear(); // Only the handlers read it, so drop it (or its temp file) while the response is sent
+        if (pResponse == nullptr) {
+            session.resetStream(stream, http2::H2_PROTOCOL_ERROR);
+            return;
+        }
+
+        session.respond(stream, std::move(pResponse), hasBody);
+    }
+
+    // Generates the response for a request from a multiplexed stream (HTTP/2 or HTTP/3), its head already framed as HTTP/1.1
+    // Returns nullptr if the request is malformed or couldn't be answered, the stream should then be reset
+    std::unique_ptr<Response> Server::genStreamResponse(const std::string& raw, const RequestBody& body, const std::string& clientIP, const char* version, bool& hasBody) {
+        headers_map_t headers;
+        RequestParser parser(conf::MAX_REQUEST_LINE_LENGTH, conf::MAX_REQUEST_BODY);
         RequestFlags reqFlags;
-        int keepAliveReqsLeft = static_cast<int>( conf::MAX_KEEP_ALIVE_REQUESTS );
-        while (keepAliveReqsLeft > 0 && !reqFlags.isContentTooLarge && !reqFlags.isURITooLong) {
-            // Declare container for parsed request headers
-            headers_map_t reqHeaders;
-
-            // Read buffer until headers have loaded
-            thread_local std::string requestStr;
-            requestStr.clear(); // Clear previous content from thread_local
-            requestStr.reserve(conf::REQUEST_BUFFER_SIZE);
-
-            // Poll for data
-            bool isForceClosed = false, isDataReady = true;
-            while (requestStr.find("\r\n\r\n") == std::string::npos && !isForceClosed && isDataReady) {
-                if (isExiting) { // Program closed
-                    isForceClosed = true; break;
+        if (parser.parse(raw, headers, reqFlags) != REQUEST_READY) return nullptr;
+
+        try {
+            Request request(headers, raw, parser, body, clientIP, useTLS, reqFlags, conf::getSnapshot());
+            std::unique_ptr<Response> pResponse = genResponse(request);
+
+            // Framing is left to the stream, so there's never a Content-Length for compressed bodies or chunked encoding
+            pResponse->setVersion(version);
+            const size_t bodySize = pResponse->prepareBody(request.isMIMEAccepted("text/html"));
+
+            // Log request
+            ACCESS_LOG << request.getMethodStr() << ' '
+                    << formatClientIP( request.getIPStr(), request.isDNT() ) << ' '
+                    << request.getPaths().rawPathFromRequest
+                    << " -- (" << pResponse->getStatus() << ") [" << version << ']'
+                    << std::endl; // Flush w/ endl vs newline
+
+            hasBody = request.getMethod() != http::METHOD::HEAD && bodySize > 0;
+            return pResponse;
+        } catch (http::Exception& e) {
+            return nullptr;
+        }
+    }
+
+    // Writes the session's queued frames, returns false if the connection failed
+    bool Server::flushHTTP2(Connection& conn) {
+        std::string& output = conn.pHTTP2->getOutput();
+        if (output.empty()) return true;
+
+        const ssize_t status = this->writeClientSock(conn.sock, conn.pSSL, output.data(), output.size());
+        output.clear();
+        return status >= 0;
+    }
+
+    #ifdef __linux__
+        // Hands a newly accepted client to the event loop
+        void Server::openEventConnection(const int client, const std::string& clientIPStr) {
+            const int keepAliveReqs = static_cast<int>( conf::MAX_KEEP_ALIVE_REQUESTS );
+            if (!this->useTLS) {
+                this->registerConnection(std::make_unique<Connection>(client, nullptr, clientIPStr, keepAliveReqs));
+                return;
+            }
+
+            // Park the connection until the ClientHello arrives, the handshake is then advanced one step per event
+            SSL* pSSL = SSL_new(this->pSSL_CTX);
+            if (pSSL == nullptr || SSL_set_fd(pSSL, client) != 1) {
+                this->closeClientSocket(client, pSSL);
+                return;
+            }
+            SSL_set_accept_state(pSSL);
+
+            auto pConn = std::make_unique<Connection>(client, pSSL, clientIPStr, keepAliveReqs);
+            pConn->isHandshaking = true;
+            pConn->handshakeDeadline = pConn->lastActivity + std::chrono::seconds(conf::TLS_HANDSHAKE_TIMEOUT);
+            this->registerConnection(std::move(pConn));
+        }
+
+        // Starts watching the (already non-blocking) connection for requests
+        void Server::registerConnection(std::unique_ptr<Connection> pConn) {
+            Connection* p = pConn.get();
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                if (!this->isExiting) {
+                    this->connections.emplace(p->sock, std::move(pConn));
+                    if (this->pEventLoop->watch(p->sock, p)) return;
+                    pConn = std::move(this->connections[p->sock]);
+                    this->connections.erase(p->sock);
                 }
+            }
 
-                struct pollfd pfd; pfd.fd = client;
-                const ssize_t pollStatus = this->waitForClientData(pfd, conf::KEEP_ALIVE_TIMEOUT * 1000);
-                if (pollStatus <= 0 || (pfd.revents & (POLLHUP | POLLERR))) {
-                    isForceClosed = true; break; // Fatal error or timeout
+            // Failed to watch, or shutting down
+            this->closeClientSocket(p->sock, p->pSSL);
+        }
+
+        // Re-parks a connection after a request (or handshake step), or closes it
+        void Server::releaseConnection(Connection* p, const bool keepAlive, const bool isWriteInterest) {
+            std::unique_ptr<Connection> pConn;
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                if (keepAlive && !this->isExiting) {
+                    p->isDispatched = false;
+                    p->touch();
+                    if (this->pEventLoop->rearm(p->sock, p, isWriteInterest)) return;
                 }
 
-                // Check for POLLIN event
-                if (!(pfd.revents & POLLIN)) { isDataReady = false; break; }
-                
-                // Read buffer (regardless of TLS or not, keep looping if TLS)
-                do {
-                    this->clearBuffer(readBuffer); // Clear read buffer
-                    const ssize_t bytesReceived = this->readClientSock(readBuffer.data(), client, pSSL);
-                    if (bytesReceived <= 0) { isForceClosed = true; break; } // Connection closed by client
-                    requestStr.append(readBuffer.data(), bytesReceived); // Concat string
-                } while (this->useTLS && SSL_pending(pSSL) > 0);
-
-                // Check for status line
-                const size_t requestLineEnd = requestStr.find("\r\n");
-                if (requestStr.size() > conf::MAX_REQUEST_LINE_LENGTH &&
-                    (requestLineEnd == std::string::npos || requestLineEnd > conf::MAX_REQUEST_LINE_LENGTH)) {
-                    reqFlags.isURITooLong = true; // URI and/or request line is too long
-                    break; // No need to drain client socket since the connection is about to be closed
+                // Take ownership of the connection to close it
+                auto itr = this->connections.find(p->sock);
+                if (itr == this->connections.end()) return;
+                pConn = std::move(itr->second);
+                this->connections.erase(itr);
+                this->pEventLoop->unwatch(pConn->sock);
+            }
+
+            this->closeClientSocket(pConn->sock, pConn->pSSL);
+        }
+
+        // Reads everything available on a readable connection and dispatches it once a full request is received
+        void Server::readConnection(Connection& conn) {
+            static thread_local std::vector<char> readBuffer(conf::REQUEST_BUFFER_SIZE);
+
+            // Bodies that may be spilled to a temp file are left to a worker, so the event loop never blocks on the disk
+            int framingStatus = this->loadRequestFraming(conn, false);
+            while (framingStatus == REQUEST_INCOMPLETE) {
+                const ssize_t bytesReceived = this->readClientSock(readBuffer.data(), conn.sock, conn.pSSL);
+                if (bytesReceived == 0 || (bytesReceived < 0 && !this->isWouldBlock(conn.pSSL, bytesReceived))) {
+                    this->releaseConnection(&conn, false); // Connection closed by client
+                    return;
                 }
+
+                if (bytesReceived < 0) break; // Drained the socket
+                framingStatus = conn.receive(readBuffer.data(), bytesReceived) ? this->loadRequestFraming(conn, false) : REQUEST_INVALID;
             }
 
-            if (!isDataReady) continue; // Handle POLLIN not set
-            if (isForceClosed) break; // Handle connection closed by client
-
-            // Process headers and early info
-            if (!reqFlags.isURITooLong) {
-                loadEarlyHeaders(reqHeaders, requestStr);
-                size_t contentLength;
-                try {
-                    contentLength = reqHeaders.find("CONTENT-LENGTH") != reqHeaders.end() ?
-                        std::stoull(reqHeaders["CONTENT-LENGTH"]) : 0;
-                } catch (std::invalid_argument&) {
-                    break; // Bad Content-Length header, close connection
+            if (framingStatus == REQUEST_INVALID) {
+                this->releaseConnection(&conn, false);
+                return;
+            } else if (framingStatus == REQUEST_INCOMPLETE) {
+                this->releaseConnection(&conn, true); // Wait for the rest of the request
+                return;
+            }
+
+            this->dispatchConnection(conn); // Hand the full request (or one waiting on 100 Continue, or on a large body) to a worker
+        }
+
+        // Hands a parked connection to a worker, which reads & responds to one request before re-parking it
+        void Server::dispatchConnection(Connection& conn) {
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                conn.isDispatched = true;
+            }
+
+            // Turn the request away instead of growing the backlog once every thread is busy
+            if (this->isQueueFull()) {
+                this->shedConnection(conn.sock, conn.pSSL);
+                this->releaseConnection(&conn, false);
+                return;
+            }
+
+            auto self = shared_from_this();
+            Connection* pConn = &conn;
+            const conn_time_t queuedAt = std::chrono::steady_clock::now();
+            threadPool.enqueue([self, pConn, queuedAt]() {
+                if (hasQueueWaitExpired(queuedAt)) {
+                    self->shedConnection(pConn->sock, pConn->pSSL);
+                    self->releaseConnection(pConn, false);
+                    return;
                 }
 
-                // Reject oversized bodies
-                if (contentLength > conf::MAX_REQUEST_BODY) {
-                    contentLength = 0; // Passthru
-                    this->drainClientSocket(client, pSSL, contentLength); // Drain socket
-                    reqFlags.isContentTooLarge = true;
+                self->serveConnection(pConn);
+            });
+        }
+
+        // Reads & responds to requests on a dispatched connection, then re-parks it
+        void Server::serveConnection(Connection* pConn) {
+            // Only blocks when the rest of the request wasn't already buffered by the event loop (ConnectionMode "threaded")
+            // Pipelined requests are answered in order before the connection is re-parked
+            if (pConn->pHTTP2 == nullptr) {
+                int status;
+                bool keepAlive;
+                while ((keepAlive = (status = this->readRequest(*pConn)) == REQUEST_READY && this->processRequest(*pConn))) {
+                    pConn->resetRequest();
+                    if (pConn->buffer.empty()) break;
                 }
 
-                // Account for already read body
-                if (contentLength > 0)
-                    contentLength -= requestStr.length() - (requestStr.find("\r\n\r\n") + 4);
+                if (status != REQUEST_HTTP2) {
+                    this->releaseConnection(pConn, keepAlive);
+                    return;
+                }
+            }
 
-                // Read remaining body
-                while (contentLength > 0 && !isForceClosed && isDataReady) {
-                    struct pollfd pfd; pfd.fd = client;
-                    const ssize_t pollStatus = this->waitForClientData(pfd, conf::KEEP_ALIVE_TIMEOUT * 1000);
-                    if (pollStatus <= 0 || (pfd.revents & (POLLHUP | POLLERR))) {
-                        isForceClosed = true; break; // Fatal error or timeout
-                    }
+            // HTTP/2 connections are served until the session is idle
+            this->releaseConnection(pConn, this->serveHTTP2(*pConn, true));
+        }
+
+        // Runs the next step of a connection's TLS handshake on a worker, which never waits on the client:
+        // the connection is re-parked until the client's next flight arrives (or its socket drains)
+        void Server::advanceHandshake(Connection& conn) {
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                conn.isDispatched = true;
+            }
+
+            // Each step is queued like a request, so a handshake flood is held to the same limits (w/out a 503, it's just closed)
+            if (this->isQueueFull()) {
+                this->shedConnection(conn.sock, conn.pSSL);
+                this->releaseConnection(&conn, false);
+                return;
+            }
+
+            auto self = shared_from_this();
+            Connection* pConn = &conn;
+            const conn_time_t queuedAt = std::chrono::steady_clock::now();
+            threadPool.enqueue([self, pConn, queuedAt]() {
+                if (hasQueueWaitExpired(queuedAt)) {
+                    self->shedConnection(pConn->sock, pConn->pSSL);
+                    self->releaseConnection(pConn, false);
+                    return;
+                }
 
-                    // Check for POLLIN event
-                    if (!(pfd.revents & POLLIN)) { isDataReady = false; break; }
+                const int status = SSL_accept(pConn->pSSL);
+                if (status <= 0) {
+                    const int err = SSL_get_error(pConn->pSSL, status);
+                    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+                        self->releaseConnection(pConn, true, err == SSL_ERROR_WANT_WRITE);
+                    else
+                        self->releaseConnection(pConn, false); // Failed handshake
+                    return;
+                }
 
-                    // Read buffer (regardless of TLS or not, keep looping if TLS)
-                    do {
-                        this->clearBuffer(readBuffer);
-                        const ssize_t bytesReceived = this->readClientSock(readBuffer.data(), client, pSSL);
-                        if (bytesReceived <= 0) { isForceClosed = true; break; } // Connection closed by client
-                        requestStr.append(readBuffer.data(), bytesReceived); // Concat string
+                {
+                    std::lock_guard<std::mutex> lock(self->connectionsMutex);
+                    pConn->isHandshaking = false;
+                }
+                recordTLSHandshake(pConn->pSSL);
+                if (isHTTP2Negotiated(pConn->pSSL))
+                    pConn->pHTTP2 = std::make_unique<http2::Session>(conf::HTTP2_MAX_CONCURRENT_STREAMS, conf::MAX_REQUEST_BODY);
+
+                // A request sent alongside the client's last flight may already be decrypted, so epoll won't report it
+                if (!SSL_has_pending(pConn->pSSL))
+                    self->releaseConnection(pConn, true);
+                else if (conf::CONNECTION_MODE == CONN_MODE_EVENT && pConn->pHTTP2 == nullptr)
+                    self->readConnection(*pConn);
+                else
+                    self->serveConnection(pConn);
+            });
+        }
 
-                        // Update remaining content length
-                        contentLength = (contentLength > static_cast<size_t>(bytesReceived)) ?
-                            (contentLength - bytesReceived) : 0;
-                    } while (this->useTLS && SSL_pending(pSSL) > 0);
+        // Closes connections that have been idle for longer than the keep-alive timeout,
+        // that haven't finished their TLS handshake by its deadline, or that are past their request's deadline
+        // While draining, every connection between requests is closed too
+        void Server::closeIdleConnections() {
+            const conn_time_t now = std::chrono::steady_clock::now();
+            const conn_time_t cutoff = now - std::chrono::seconds(conf::KEEP_ALIVE_TIMEOUT);
+
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            for (auto itr = this->connections.begin(); itr != this->connections.end(); (void)itr) {
+                // A worker owns the rest of a dispatched connection's state, it's re-checked once released
+                Connection& conn = *itr->second;
+                if (conn.isDispatched) {
+                    ++itr;
+                    continue;
                 }
 
-                if (!isDataReady) continue; // Handle POLLIN not set
-                if (isForceClosed) break; // Handle connection closed by client
+                const bool isExpired = conn.isHandshaking ? conn.handshakeDeadline <= now
+                    : conn.lastActivity <= cutoff || conn.requestTimer.hasExpired(now) || (this->isDraining && conn.buffer.empty());
+                if (!isExpired) {
+                    ++itr;
+                    continue;
+                }
+
+                // Refuse any new streams, so the client retries them on the upgraded process
+                // Written once w/out waiting, since a client w/ a full window would otherwise stall the event loop under the lock
+                if (this->isDraining && conn.pHTTP2 != nullptr) {
+                    conn.pHTTP2->goAway(http2::H2_NO_ERROR);
+                    const std::string& output = conn.pHTTP2->getOutput();
+                    this->writeClientSockOnce(conn.sock, conn.pSSL, output.data(), output.size());
+                }
+
+                this->pEventLoop->unwatch(conn.sock);
+                this->closeClientSocket(conn.sock, conn.pSSL);
+                itr = this->connections.erase(itr);
             }
+        }
 
-            // Parse request
-            std::unique_ptr<Response> pResponse = nullptr;
-            try {
-                Request request(reqHeaders, requestStr, clientIPStr, useTLS, reqFlags);
-
-                // Generate response
-                pResponse = genResponse(request);
-
-                // Handle keep-alive requests
-                const std::optional<std::string> connHeader = request.getHeader("Connection");
-                std::string connValue = connHeader.has_value() ? *connHeader : ""; // Copy string
-                strToUpper(connValue); // Format copied string
-                if (conf::IS_KEEP_ALIVE_ENABLED &&
-                    !reqFlags.isContentTooLarge && !reqFlags.isURITooLong &&
-                    (connValue == "KEEP-ALIVE" || (connValue == "" && request.getVersion() == "HTTP/1.1"))) {
-                    // HTTP/1.1 defaults to keep-alive
-                    pResponse->setHeader("Connection", "keep-alive");
-                    pResponse->setHeader("Keep-Alive",
-                                "timeout=" + std::to_string(conf::KEEP_ALIVE_TIMEOUT) +
-                                ", max=" + std::to_string(conf::MAX_KEEP_ALIVE_REQUESTS));
-                    --keepAliveReqsLeft;
-                } else { // Close connection
-                    pResponse->setHeader("Connection", "close");
-                    keepAliveReqsLeft = 0;
+        // Closes every parked connection (for shutdown)
+        void Server::closeAllConnections() {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            for (auto itr = this->connections.begin(); itr != this->connections.end(); (void)itr) {
+                Connection& conn = *itr->second;
+                if (conn.isDispatched) { // Released by its worker
+                    ++itr;
+                    continue;
                 }
 
-                // Load response to buffer
-                const bool omitBody = request.getMethod() == http::METHOD::HEAD;
-                std::function<ssize_t(const char*, const size_t)> sendFunc = [this, client, &pSSL](const char* resBuffer, const size_t n) -> ssize_t {
-                    return this->writeClientSock(client, pSSL, resBuffer, n);
-                };
-
-                // Handle write failure
-                const ssize_t sendStatus = pResponse->streamBody(request.isMIMEAccepted("text/html"), omitBody, sendFunc);
-
-                // Log request
-                ACCESS_LOG << request.getMethodStr() << ' '
-                        << formatClientIP( request.getIPStr(), request.isDNT() ) << ' '
-                        << request.getPaths().rawPathFromRequest
-                        << " -- (" << pResponse->getStatus() << ") ["
-                        << request.getVersion() << ']'
-                        << std::endl; // Flush w/ endl vs newline
-
-                // Handle connection closure OR Content Too Large
-                if (sendStatus < 0 || pResponse->getStatus() == 413)
-                    break;
-            } catch (http::Exception& e) {
-                break; // Handles invalid requests syntax (ie. non-CRLF)
+                this->pEventLoop->unwatch(conn.sock);
+                this->closeClientSocket(conn.sock, conn.pSSL);
+                itr = this->connections.erase(itr);
             }
         }
 
-        // Close client socket & cleanup TLS
-        this->closeClientSocket(client, pSSL);
-    }
+        // Waits for parked connections to become readable (or writable, mid-handshake)
+        void Server::eventLoop() {
+            std::vector<struct epoll_event> events;
+            conn_time_t lastSweep = std::chrono::steady_clock::now();
+
+            while (!this->isExiting) {
+                const int numEvents = this->pEventLoop->wait(events, EVENT_LOOP_SWEEP_MS);
+                for (int i = 0; i < numEvents && !this->isExiting; ++i) {
+                    if (this->pEventLoop->isWakeEvent(events[i])) continue;
+
+                    Connection* pConn = static_cast<Connection*>(events[i].data.ptr);
+                    if (events[i].events & (EPOLLERR | EPOLLHUP))
+                        this->releaseConnection(pConn, false);
+                    else if (pConn->isHandshaking)
+                        this->advanceHandshake(*pConn);
+                    else if (conf::CONNECTION_MODE == CONN_MODE_EVENT && pConn->pHTTP2 == nullptr)
+                        this->readConnection(*pConn);
+                    else
+                        this->dispatchConnection(*pConn); // The next request (or HTTP/2 frame) has started arriving
+                }
+
+                // Sweep idle keep-alive connections
+                const conn_time_t now = std::chrono::steady_clock::now();
+                if (now - lastSweep >= std::chrono::milliseconds(EVENT_LOOP_SWEEP_MS)) {
+                    this->closeIdleConnections();
+                    lastSweep = now;
+                }
+            }
+        }
+    #endif
 
     std::unique_ptr<Response> Server::genResponse(Request& request) {
-        // Handle different HTTP versions
-        std::unique_ptr<Response> pResponse = nullptr;
+        // Turn away clients over RateLimitRequestsPerSecond before doing any other work
+        std::unique_ptr<Response> pResponse = genRateLimitedResponse(request);
+        if (pResponse != nullptr) {
+            this->finishResponse(request, *pResponse);
+            return pResponse;
+        }
 
+        // Handle different HTTP versions
         if (request.getVersion() == "HTTP/1.1") {
             pResponse = version::handler_1_1::genResponse(request);
         } else if (request.getVersion() == "HTTP/1.0" && conf::ENABLE_LEGACY_HTTP) {
@@ -425,28 +1227,62 @@ namespace http {
                 pResponse->loadBodyFromErrorDoc(505);
         }
 
-        // Pass the compression method
-        pResponse->setCompressMethod(request.getCompressMethod(pResponse->getContentType()));
+        this->finishResponse(request, *pResponse);
+        return pResponse;
+    }
 
+    // Only HTTP/1.1 requests can be sent 100 Continue, so only they're checked before the body is read
+    std::unique_ptr<Response> Server::genEarlyResponse(Request& request) {
+        std::unique_ptr<Response> pResponse = genRateLimitedResponse(request);
+        if (pResponse == nullptr) pResponse = version::handler_1_1::genEarlyResponse(request);
+        if (pResponse != nullptr) this->finishResponse(request, *pResponse);
         return pResponse;
     }
 
-    void Server::getUsageInfo(size_t& usedThreads, size_t& totalThreads, size_t& pendingConnections) {
-        threadPool.getUsageInfo(usedThreads, totalThreads, pendingConnections);
+    // Takes a token from the client's RateLimitRequestsPerSecond bucket, returns a 429 if it's empty or nullptr otherwise
+    // The 429 has no error doc so turning a client away stays cheap
+    std::unique_ptr<Response> Server::genRateLimitedResponse(const Request& request) {
+        if (conf::clientRateLimiter == nullptr || request.isRateLimitCharged() || conf::clientRateLimiter->tryAcquire(request.getIPStr()))
+            return nullptr;
+
+        // Answer in the client's version where there's a handler for it
+        const std::string& version = request.getVersion();
+        std::unique_ptr<Response> pResponse = std::unique_ptr<Response>(new Response(version == "HTTP/1.0" || version == "HTTP/0.9" ? version : "HTTP/1.1"));
+        pResponse->setStatus(429);
+        pResponse->setHeader("Retry-After", std::to_string(conf::clientRateLimiter->getRetryAfter()));
+        return pResponse;
+    }
+
+    // Sets what every response gets, regardless of HTTP version
+    void Server::finishResponse(const Request& request, Response& response) {
+        // Pass the compression method
+        response.setCompressMethod(request.getCompressMethod(response.getContentType()));
+
+        // Point TLS clients at the HTTP/3 listener, which they'll try on later connections
+        #ifdef HAS_QUIC
+            if (this->useTLS && !this->usesQUIC() && QUICServer::isListening)
+                response.setHeader("Alt-Svc", "h3=\":" + std::to_string(conf::HTTP3_PORT) + "\"; ma=86400");
+        #endif
     }
 
-    void Server::clearBuffer(std::vector<char>& readBuffer) {
-        std::fill(readBuffer.begin(), readBuffer.end(), 0);
+    void Server::getUsageInfo(size_t& usedThreads, size_t& totalThreads, size_t& pendingConnections, size_t& shedConnections) {
+        threadPool.getUsageInfo(usedThreads, totalThreads, pendingConnections);
+        shedConnections += numShedConnections;
     }
 
     std::ostream& operator<<(std::ostream& os, const Server& server) {
         os << "IPv" << (server.isIPv4() ? "4" : "6");
-        if (server.usesTLS()) os << " w/ TLS";
+        if (server.usesQUIC()) os << " w/ QUIC";
+        else if (server.usesTLS()) os << " w/ TLS";
+        if (conf::ACCEPT_SHARDS > 1 && !server.usesQUIC()) os << " #" << server.getShardIndex();
         return os;
     }
 
 }
 
+#undef EVENT_LOOP_SWEEP_MS
+#undef ACCEPT_ERROR_BACKOFF_MS
+
 #ifdef _WIN32
     #undef close
 #endif
\ No newline at end of file
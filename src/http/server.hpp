@@ -5,6 +5,7 @@
     #include "../winheader.hpp"
 #else
     #include <sys/socket.h>
+    #include <sys/uio.h>
     #include <arpa/inet.h>
     #include <netinet/in.h>
     #include <netinet/tcp.h>
@@ -14,8 +15,13 @@
 
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
+#include <thread>
+#include <unordered_map>
 
+#include "connection.hpp"
+#include "event_loop.hpp"
 #include "request.hpp"
 #include "response.hpp"
 #include "tls.hpp"
@@ -27,6 +33,16 @@
 #define BIND_FAILURE 2
 #define LISTEN_FAILURE 3
 
+// Returned by loadRequestFraming alongside the REQUEST_* parser statuses, once a plaintext connection opens w/ the HTTP/2 preface
+#define REQUEST_HTTP2 3
+
+// Returned by loadRequestFraming once an HTTP/1.1 request's headers ask for "Expect: 100-continue" before its body is sent
+#define REQUEST_CONTINUE 4
+
+// Returned by loadRequestFraming on the event loop once a request's body may outgrow RequestBodyMemoryLimit,
+// so it's read by a worker instead (spilling it to a temp file blocks on the disk)
+#define REQUEST_LARGE_BODY 5
+
 typedef unsigned short port_t;
 
 // Helper function for binding socket options
@@ -41,47 +57,98 @@ namespace http {
 
     class Server : public std::enable_shared_from_this<Server> {
         public:
-            Server(const port_t port, const bool useTLS);
-            virtual ~Server() = default;
+            Server(const port_t port, const bool useTLS, const unsigned int shardIndex=0);
+            virtual ~Server();
 
             // Overridden by IPv6 servers
             virtual int bindSocket();
             inline virtual bool isIPv4() const { return true; };
+
+            // Overridden by the HTTP/3 listener, which runs its own loop over a UDP socket
+            inline virtual bool usesQUIC() const { return false; };
             inline bool usesTLS() const { return useTLS; };
             inline port_t getPort() const { return port; };
+            inline unsigned int getShardIndex() const { return shardIndex; };
 
-            int init();
-            void acceptLoop();
+            virtual int init();
+            virtual void acceptLoop();
             void handleReqs(const int, const std::string);
-            void kill();
+            virtual void kill();
+
+            // Zero-downtime upgrades, the listening socket is handed to the new process
+            inline int getListeningSocket() const { return sock; };
+            virtual void drain();
+            bool isDrained();
             std::unique_ptr<Response> genResponse(Request&);
-            void getUsageInfo(size_t& usedThreads, size_t& totalThreads, size_t& pendingConnections);
+            std::unique_ptr<Response> genEarlyResponse(Request&);
+            static std::unique_ptr<Response> genRateLimitedResponse(const Request&);
+            void finishResponse(const Request&, Response&);
+            void getUsageInfo(size_t& usedThreads, size_t& totalThreads, size_t& pendingConnections, size_t& shedConnections);
         protected:
             // Socket methods
-            void clearBuffer(std::vector<char>&);
             ssize_t readClientSock(char*, const int, SSL*);
             ssize_t writeClientSock(const int, SSL*, const char*, const size_t);
+            void writeClientSockOnce(const int, SSL*, const char*, const size_t);
+            ssize_t writevClientSock(const int, SSL*, const io_slice_t*, const size_t, const bool);
+            void pushClientSock(const int);
+            #ifdef __linux__
+                ssize_t sendFileClientSock(const int, SSL*, const int, const size_t, const size_t);
+            #endif
+            bool isWouldBlock(SSL*, const ssize_t) const;
             int closeSocket(const int);
             int closeClientSocket(const int, SSL*);
-            void drainClientSocket(const int, SSL*, size_t);
+
+            // Admission control, for when every connection thread is busy
+            bool isQueueFull() const;
+            static bool hasQueueWaitExpired(const conn_time_t queuedAt);
+            void shedConnection(const int, SSL*);
 
             // Request loop helper methods
             void extractClientIP(struct sockaddr_storage&, char*) const;
             ssize_t waitForClientData(struct pollfd&, const int);
+            ssize_t waitForClientWritable(struct pollfd&, const int);
             int acceptConnection(struct sockaddr_storage&, socklen_t&);
+            bool acceptTLS(const int, SSL*&);
+            int loadRequestFraming(Connection&, const bool canSpillBody=true);
+            static int getReadTimeoutMS(const Connection&);
+            int readRequest(Connection&);
+            int answerExpectation(Connection&);
+            bool processRequest(Connection&);
+
+            // HTTP/2 connection methods
+            bool serveHTTP2(Connection&, const bool);
+            void processHTTP2Request(Connection&, http2::Stream&);
+            bool flushHTTP2(Connection&);
+            std::unique_ptr<Response> genStreamResponse(const std::string&, const RequestBody&, const std::string&, const char*, bool&);
 
             // Client socket tracking methods
             void trackClient(const int);
             void untrackClient(const int);
 
+            #ifdef __linux__
+                // Event loop for parked keep-alive connections & the event-driven engine (ConnectionMode "event")
+                void openEventConnection(const int, const std::string&);
+                void registerConnection(std::unique_ptr<Connection>);
+                void releaseConnection(Connection*, const bool, const bool isWriteInterest=false);
+                void readConnection(Connection&);
+                void dispatchConnection(Connection&);
+                void serveConnection(Connection*);
+                void advanceHandshake(Connection&);
+                void closeIdleConnections();
+                void closeAllConnections();
+                void eventLoop();
+            #endif
+
             // Protected fields
             const port_t port;
+            const unsigned int shardIndex; // Index of this listening socket when AcceptShards > 1
             int sock = SOCKET_UNSET;
             std::unordered_set<int> clientSocks;
 
             // For multithreading
             std::shared_mutex clientsMutex;
             ThreadPool threadPool;
+            std::atomic<size_t> numShedConnections{0}; // Turned away by MaxQueuedConnections or MaxQueueWait, w/ 503 unless mid-handshake
 
             // OpenSSL
             bool useTLS;
@@ -89,6 +156,18 @@ namespace http {
 
             // Used to gracefully close acceptLoop threads
             std::atomic<bool> isExiting{false};
+            std::atomic<bool> isDraining{false}; // Not accepting, & closing connections once their request is answered
+
+            #ifdef __linux__
+                // Signalled by kill to interrupt acceptConnection
+                int acceptWakeFd = -1;
+
+                // Connections parked in the event loop, keyed by socket
+                std::unique_ptr<EventLoop> pEventLoop;
+                std::thread eventThread;
+                std::unordered_map<int, std::unique_ptr<Connection>> connections;
+                std::mutex connectionsMutex;
+            #endif
     };
 
     // For logs
@@ -0,0 +1,211 @@
+#include "socket_handoff.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <poll.h>
+    #include <signal.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+
+    extern char** environ;
+#endif
+
+#include "../logs/logger.hpp"
+
+#define LISTEN_FDS_START 3 // First passed socket, per systemd's socket activation protocol
+#define UPGRADE_READY_FD_ENV "MERCURY_UPGRADE_READY_FD"
+#define UPGRADE_READY_TIMEOUT_MS 30000
+
+namespace http {
+
+    #ifdef __linux__
+        static std::vector<int> inheritedSocks;
+        static int upgradeReadyFd = -1;
+
+        // True if both addresses have the same family, port & IP
+        static bool isSameAddress(const struct sockaddr_storage& bound, const struct sockaddr* pAddr) {
+            if (bound.ss_family != pAddr->sa_family) return false;
+
+            if (pAddr->sa_family == AF_INET6) {
+                const struct sockaddr_in6& a = reinterpret_cast<const struct sockaddr_in6&>(bound);
+                const struct sockaddr_in6* pB = reinterpret_cast<const struct sockaddr_in6*>(pAddr);
+                return a.sin6_port == pB->sin6_port && memcmp(&a.sin6_addr, &pB->sin6_addr, sizeof(a.sin6_addr)) == 0;
+            }
+
+            const struct sockaddr_in& a = reinterpret_cast<const struct sockaddr_in&>(bound);
+            const struct sockaddr_in* pB = reinterpret_cast<const struct sockaddr_in*>(pAddr);
+            return a.sin_port == pB->sin_port && a.sin_addr.s_addr == pB->sin_addr.s_addr;
+        }
+    #endif
+
+    void loadInheritedSockets() {
+        #ifdef __linux__
+            const char* pidEnv = getenv("LISTEN_PID");
+            const char* fdsEnv = getenv("LISTEN_FDS");
+            const char* readyEnv = getenv(UPGRADE_READY_FD_ENV);
+
+            // The sockets are only meant for this process, not for any it starts (ie. PHP CGI)
+            const bool isForThisProcess = pidEnv != nullptr && fdsEnv != nullptr && std::atoi(pidEnv) == getpid();
+            const int numFds = isForThisProcess ? std::atoi(fdsEnv) : 0;
+            for (int fd = LISTEN_FDS_START; fd < LISTEN_FDS_START + numFds; ++fd) {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+                inheritedSocks.push_back(fd);
+            }
+
+            if (isForThisProcess && readyEnv != nullptr) {
+                upgradeReadyFd = std::atoi(readyEnv);
+                fcntl(upgradeReadyFd, F_SETFD, FD_CLOEXEC);
+            }
+
+            unsetenv("LISTEN_PID");
+            unsetenv("LISTEN_FDS");
+            unsetenv("LISTEN_FDNAMES");
+            unsetenv(UPGRADE_READY_FD_ENV);
+        #endif
+    }
+
+    int takeInheritedSocket([[maybe_unused]] const int type, [[maybe_unused]] const struct sockaddr* pAddr) {
+        #ifdef __linux__
+            for (auto itr = inheritedSocks.begin(); itr != inheritedSocks.end(); ++itr) {
+                struct sockaddr_storage bound;
+                socklen_t boundLen = sizeof(bound);
+                int boundType;
+                socklen_t typeLen = sizeof(boundType);
+                if (getsockname(*itr, reinterpret_cast<struct sockaddr*>(&bound), &boundLen) < 0 ||
+                    getsockopt(*itr, SOL_SOCKET, SO_TYPE, &boundType, &typeLen) < 0) continue;
+
+                if (boundType == type && isSameAddress(bound, pAddr)) {
+                    const int sock = *itr;
+                    inheritedSocks.erase(itr);
+                    return sock;
+                }
+            }
+        #endif
+        return -1;
+    }
+
+    void closeUnclaimedSockets() {
+        #ifdef __linux__
+            for (const int sock : inheritedSocks) {
+                ERROR_LOG << "Closing inherited socket " << sock << ", it isn't used by the current config." << std::endl;
+                close(sock);
+            }
+            inheritedSocks.clear();
+        #endif
+    }
+
+    bool spawnUpgradedProcess([[maybe_unused]] char* argv[], [[maybe_unused]] const std::vector<int>& listenSocks) {
+        #ifdef __linux__
+            // Run whatever is at the executable's path now, which may be a newer build than this process
+            std::error_code ec;
+            std::string exePath = std::filesystem::read_symlink("/proc/self/exe", ec).string();
+            if (ec) {
+                ERROR_LOG << "Upgrade failed, couldn't find the executable." << std::endl;
+                return false;
+            }
+            if (exePath.ends_with(" (deleted)")) exePath.resize(exePath.size() - 10);
+
+            int readyPipe[2];
+            if (pipe2(readyPipe, O_CLOEXEC) < 0) {
+                ERROR_LOG << "Upgrade failed, couldn't create the ready pipe." << std::endl;
+                return false;
+            }
+
+            // Everything the new process needs is built up front, since only async-signal-safe calls are allowed after fork
+            // The sockets go to fds 3 onwards, followed by the ready pipe
+            const int numSocks = static_cast<int>(listenSocks.size());
+            std::vector<int> passedFds(listenSocks);
+            passedFds.push_back(readyPipe[1]);
+
+            std::vector<std::string> envStrs;
+            for (char** pEnv = environ; *pEnv != nullptr; ++pEnv) {
+                const std::string_view env(*pEnv);
+                if (!env.starts_with("LISTEN_PID=") && !env.starts_with("LISTEN_FDS=") && !env.starts_with("LISTEN_FDNAMES=") &&
+                    !env.starts_with(UPGRADE_READY_FD_ENV "="))
+                    envStrs.emplace_back(env);
+            }
+            envStrs.push_back("LISTEN_FDS=" + std::to_string(numSocks));
+            envStrs.push_back(UPGRADE_READY_FD_ENV "=" + std::to_string(LISTEN_FDS_START + numSocks));
+            envStrs.push_back("LISTEN_PID=" + std::string(20, '\0')); // Filled in by the child, once it knows its PID
+
+            std::vector<char*> envp;
+            for (std::string& env : envStrs) envp.push_back(env.data());
+            envp.push_back(nullptr);
+            char* pPidDigits = envStrs.back().data() + strlen("LISTEN_PID=");
+
+            const pid_t pid = fork();
+            if (pid == 0) {
+                // Move every fd above the target range before lining them up, so none are clobbered
+                const int firstFree = LISTEN_FDS_START + static_cast<int>(passedFds.size());
+                for (int& fd : passedFds) {
+                    const int moved = fcntl(fd, F_DUPFD, firstFree);
+                    if (moved < 0) _exit(127);
+                    fcntl(fd, F_SETFD, FD_CLOEXEC); // The original isn't passed on
+                    fd = moved;
+                }
+
+                for (size_t i = 0; i < passedFds.size(); ++i) {
+                    if (dup2(passedFds[i], LISTEN_FDS_START + static_cast<int>(i)) < 0) _exit(127);
+                    close(passedFds[i]);
+                }
+
+                // Write the PID's digits in place
+                char digits[20];
+                int numDigits = 0;
+                for (pid_t n = getpid(); n > 0; n /= 10) digits[numDigits++] = static_cast<char>('0' + n % 10);
+                for (int i = 0; i < numDigits; ++i) pPidDigits[i] = digits[numDigits - 1 - i];
+
+                execve(exePath.c_str(), argv, envp.data());
+                _exit(127);
+            }
+
+            close(readyPipe[1]);
+            if (pid < 0) {
+                close(readyPipe[0]);
+                ERROR_LOG << "Upgrade failed, couldn't fork." << std::endl;
+                return false;
+            }
+
+            // Wait for the new process to start serving, it exits w/out writing anything if it fails to start
+            struct pollfd pfd; pfd.fd = readyPipe[0]; pfd.events = POLLIN; pfd.revents = 0;
+            char ready;
+            const bool isReady = poll(&pfd, 1, UPGRADE_READY_TIMEOUT_MS) > 0 && read(readyPipe[0], &ready, 1) == 1;
+            close(readyPipe[0]);
+
+            if (!isReady) {
+                ::kill(pid, SIGKILL); // Never reported in, so it isn't serving anyone
+                waitpid(pid, nullptr, 0);
+                ERROR_LOG << "Upgrade failed, the new process didn't start (" << exePath << ")." << std::endl;
+                return false;
+            }
+
+            ACCESS_LOG << "Upgraded process started (PID " << pid << ")." << std::endl;
+            return true;
+        #else
+            return false;
+        #endif
+    }
+
+    void notifyUpgradeReady() {
+        #ifdef __linux__
+            if (upgradeReadyFd == -1) return;
+
+            const char ready = '1';
+            if (write(upgradeReadyFd, &ready, 1) != 1)
+                ERROR_LOG << "Failed to notify the previous process of the upgrade." << std::endl;
+            close(upgradeReadyFd);
+            upgradeReadyFd = -1;
+        #endif
+    }
+
+}
+
+#undef LISTEN_FDS_START
+#undef UPGRADE_READY_FD_ENV
+#undef UPGRADE_READY_TIMEOUT_MS
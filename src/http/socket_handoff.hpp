@@ -0,0 +1,36 @@
+#ifndef __HTTP_SOCKET_HANDOFF_HPP
+#define __HTTP_SOCKET_HANDOFF_HPP
+
+#include <vector>
+
+#ifdef _WIN32
+    #include "../winheader.hpp"
+#else
+    #include <sys/socket.h>
+#endif
+
+// Listening socket handoff for zero-downtime upgrades (Linux only)
+// Sockets are passed w/ systemd's socket activation protocol (LISTEN_FDS & LISTEN_PID), so a systemd socket unit works too
+namespace http {
+
+    // Claims the listening sockets passed to this process, must be called before any threads are started
+    void loadInheritedSockets();
+
+    // Returns the inherited socket of the given type bound to addr, or -1 if there isn't one
+    // Each socket can only be taken once
+    int takeInheritedSocket(const int type, const struct sockaddr* pAddr);
+
+    // Closes any inherited sockets that no server took (ie. the config no longer listens on them)
+    void closeUnclaimedSockets();
+
+    // Starts the executable (as it is now on disk) w/ the same arguments & the given listening sockets,
+    // then waits for it to report that it's serving
+    // Returns false if the new process couldn't be started or failed to come up, in which case it's been stopped
+    bool spawnUpgradedProcess(char* argv[], const std::vector<int>& listenSocks);
+
+    // Tells the process that started this one (w/ spawnUpgradedProcess) that it's serving, so it can stop accepting
+    void notifyUpgradeReady();
+
+}
+
+#endif
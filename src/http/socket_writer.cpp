@@ -0,0 +1,71 @@
+#include "socket_writer.hpp"
+
+namespace http {
+
+    ssize_t SocketWriter::write(const io_slice_t* slices, const size_t numSlices) {
+        size_t total = 0;
+        for (size_t i = 0; i < numSlices; ++i)
+            total += slices[i].size;
+
+        // Hold small writes back
+        if (pending.size() + total < threshold) {
+            if (pending.capacity() < threshold) pending.reserve(threshold);
+            for (size_t i = 0; i < numSlices; ++i)
+                pending.append(slices[i].data, slices[i].size);
+            return static_cast<ssize_t>(total);
+        }
+
+        // Send the held back bytes in the same write, unless there are too many slices
+        io_slice_t out[MAX_IO_SLICES];
+        size_t numOut = 0;
+        if (!pending.empty()) {
+            out[numOut++] = { pending.data(), pending.size() };
+            if (numSlices >= MAX_IO_SLICES) {
+                if (writeFunc(out, numOut, true) < 0) return -1;
+                numOut = 0;
+            }
+        }
+
+        for (size_t i = 0; i < numSlices; ++i) {
+            if (numOut == MAX_IO_SLICES) {
+                if (writeFunc(out, numOut, true) < 0) return -1;
+                numOut = 0;
+            }
+            out[numOut++] = slices[i];
+        }
+
+        const ssize_t status = writeFunc(out, numOut, true);
+        pending.clear();
+        isPushNeeded = true;
+        return status < 0 ? status : static_cast<ssize_t>(total);
+    }
+
+    ssize_t SocketWriter::sendFile(const int fd, const size_t offset, const size_t n) {
+        if (!pending.empty()) {
+            const io_slice_t slice = { pending.data(), pending.size() };
+            if (writeFunc(&slice, 1, true) < 0) return -1;
+            pending.clear();
+        }
+
+        // The file's last segment is pushed by the send itself
+        isPushNeeded = false;
+        return sendFileFunc(fd, offset, n);
+    }
+
+    ssize_t SocketWriter::flush() {
+        if (!pending.empty()) {
+            const io_slice_t slice = { pending.data(), pending.size() };
+            const ssize_t status = writeFunc(&slice, 1, false);
+            pending.clear();
+            isPushNeeded = false;
+            return status < 0 ? status : 0;
+        }
+
+        if (isPushNeeded) {
+            pushFunc();
+            isPushNeeded = false;
+        }
+        return 0;
+    }
+
+}
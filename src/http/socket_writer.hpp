@@ -0,0 +1,54 @@
+#ifndef __HTTP_SOCKET_WRITER_HPP
+#define __HTTP_SOCKET_WRITER_HPP
+
+#include <functional>
+#include <string>
+
+#ifdef _WIN32
+    #include "../winheader.hpp"
+#else
+    #include <sys/types.h>
+#endif
+
+#include "tools.hpp"
+
+namespace http {
+
+    // Sits between a Response & the client socket, holding small writes back until threshold bytes are buffered
+    // or the response ends, so small responses leave in a single packet
+    class SocketWriter {
+        public:
+            // Sends every slice, w/ hasMore set if more of the response follows them (ie. for MSG_MORE)
+            typedef std::function<ssize_t(const io_slice_t*, const size_t, const bool)> write_func_t;
+            // Sends n bytes of fd from offset w/o copying them to userspace
+            typedef std::function<ssize_t(const int, const size_t, const size_t)> send_file_func_t;
+
+            // pushFunc sends any segments the kernel is still holding back after a write w/ hasMore set
+            SocketWriter(write_func_t writeFunc, std::function<void()> pushFunc, const size_t threshold)
+                : writeFunc(std::move(writeFunc)), pushFunc(std::move(pushFunc)), threshold(threshold) {};
+
+            inline void setSendFileFunc(send_file_func_t f) { sendFileFunc = std::move(f); };
+            inline bool canSendFile() const { return sendFileFunc != nullptr; };
+
+            // Returns the number of bytes accepted, or < 0 on failure
+            ssize_t write(const io_slice_t* slices, const size_t numSlices);
+            inline ssize_t write(const char* data, const size_t n) { const io_slice_t slice = { data, n }; return write(&slice, 1); };
+
+            // Sends any buffered bytes first, then the file
+            ssize_t sendFile(const int fd, const size_t offset, const size_t n);
+
+            // Sends anything still buffered at the end of a response, returns < 0 on failure
+            ssize_t flush();
+        private:
+            write_func_t writeFunc;
+            send_file_func_t sendFileFunc = nullptr;
+            std::function<void()> pushFunc;
+            const size_t threshold;
+
+            std::string pending;
+            bool isPushNeeded = false; // True if the last write told the kernel more was coming
+    };
+
+}
+
+#endif
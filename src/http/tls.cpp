@@ -1,36 +1,191 @@
 #include "tls.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 
+#include <openssl/rand.h>
+
+#ifdef HAS_QUIC
+    #include <openssl/quic.h>
+#endif
+
+#ifdef HAS_TICKET_KEY_ROTATION
+    #include <openssl/core_names.h>
+    #include <openssl/evp.h>
+#endif
+
 #include "../conf/conf.hpp"
 #include "../logs/logger.hpp"
 
 #define CERT_PATH "conf/ssl/cert.pem"
 #define KEY_PATH "conf/ssl/key.pem"
+#define SESSION_ID_CONTEXT "Mercury"
+#define ALPN_PROTOCOLS "\x02h2\x08http/1.1" // In order of preference, each prefixed by its length
+#define ALPN_PROTOCOLS_QUIC "\x02h3"
 
-SSL_CTX* initTLSContext() {
-    OPENSSL_no_config();
+static SSL_CTX* pSharedCTX = nullptr;
+static std::mutex sharedCTXMutex;
 
-    SSL_CTX* ctx = SSL_CTX_new( TLS_server_method() );
-    if ( !ctx ) {
-        ERROR_LOG << "Failed to create SSL context." << std::endl;
-        return nullptr;
+static std::atomic<size_t> numFullHandshakes = 0;
+static std::atomic<size_t> numResumedHandshakes = 0;
+
+#ifdef HAS_TICKET_KEY_ROTATION
+    typedef struct {
+        unsigned char name[16];
+        unsigned char aesKey[32];
+        unsigned char hmacKey[32];
+    } ticket_key_t;
+
+    // The current key encrypts new tickets, the previous one only decrypts tickets issued before the last rotation
+    static ticket_key_t currentTicketKey, previousTicketKey;
+    static bool hasPreviousTicketKey = false;
+    static std::chrono::steady_clock::time_point ticketKeyCreated;
+    static std::shared_mutex ticketKeysMutex;
+
+    static bool generateTicketKey(ticket_key_t& key) {
+        return RAND_bytes(key.name, sizeof(key.name)) == 1 &&
+            RAND_bytes(key.aesKey, sizeof(key.aesKey)) == 1 &&
+            RAND_bytes(key.hmacKey, sizeof(key.hmacKey)) == 1;
     }
 
-    // Load cert and key
+    // Replaces the current key once it's older than TLSSessionTimeout, so no ticket outlives two keys
+    static void rotateTicketKeys() {
+        const auto now = std::chrono::steady_clock::now();
+        const auto lifetime = std::chrono::seconds(conf::TLS_SESSION_TIMEOUT);
+        {
+            std::shared_lock lock(ticketKeysMutex);
+            if (now - ticketKeyCreated < lifetime) return;
+        }
+
+        std::unique_lock lock(ticketKeysMutex);
+        if (now - ticketKeyCreated < lifetime) return; // Already rotated by another thread
+
+        ticket_key_t nextKey;
+        if (!generateTicketKey(nextKey)) return; // Keep the current key until the RNG recovers
+
+        previousTicketKey = currentTicketKey;
+        currentTicketKey = nextKey;
+        hasPreviousTicketKey = true;
+        ticketKeyCreated = now;
+    }
+
+    static bool setTicketMACKey(EVP_MAC_CTX* pMacCTX, const ticket_key_t& key) {
+        OSSL_PARAM params[3];
+        params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, const_cast<unsigned char*>(key.hmacKey), sizeof(key.hmacKey));
+        params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("SHA256"), 0);
+        params[2] = OSSL_PARAM_construct_end();
+        return EVP_MAC_CTX_set_params(pMacCTX, params) == 1;
+    }
+
+    // Returns 1 if the ticket key was loaded, 2 if the client should also get a new ticket, 0 to fall back to a full handshake, or -1 on error
+    static int ticketKeyCallback(SSL*, unsigned char keyName[16], unsigned char* iv, EVP_CIPHER_CTX* pCipherCTX, EVP_MAC_CTX* pMacCTX, int isEncrypt) {
+        if (isEncrypt) {
+            rotateTicketKeys();
+
+            std::shared_lock lock(ticketKeysMutex);
+            if (RAND_bytes(iv, EVP_CIPHER_get_iv_length(EVP_aes_256_cbc())) != 1) return -1;
+            memcpy(keyName, currentTicketKey.name, sizeof(currentTicketKey.name));
+            if (EVP_EncryptInit_ex(pCipherCTX, EVP_aes_256_cbc(), nullptr, currentTicketKey.aesKey, iv) != 1 ||
+                !setTicketMACKey(pMacCTX, currentTicketKey))
+                return -1;
+            return 1;
+        }
+
+        std::shared_lock lock(ticketKeysMutex);
+        const bool isCurrent = memcmp(keyName, currentTicketKey.name, sizeof(currentTicketKey.name)) == 0;
+        if (!isCurrent && (!hasPreviousTicketKey || memcmp(keyName, previousTicketKey.name, sizeof(previousTicketKey.name)) != 0))
+            return 0; // Issued before the last two rotations (or by another process)
+
+        const ticket_key_t& key = isCurrent ? currentTicketKey : previousTicketKey;
+        if (EVP_DecryptInit_ex(pCipherCTX, EVP_aes_256_cbc(), nullptr, key.aesKey, iv) != 1 || !setTicketMACKey(pMacCTX, key))
+            return -1;
+        return isCurrent ? 1 : 2;
+    }
+#endif
+
+// Picks h2 if the client offers it, otherwise HTTP/1.1
+// Clients that offer neither still complete the handshake & are served as HTTP/1.x
+static int alpnSelectCallback(SSL*, const unsigned char** out, unsigned char* outLen, const unsigned char* in, unsigned int inLen, void*) {
+    unsigned char* selected;
+    const int status = SSL_select_next_proto(&selected, outLen, reinterpret_cast<const unsigned char*>(ALPN_PROTOCOLS),
+        sizeof(ALPN_PROTOCOLS) - 1, in, inLen);
+    if (status != OPENSSL_NPN_NEGOTIATED) return SSL_TLSEXT_ERR_NOACK;
+
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+// Loads the cert and key, returns false (having logged why) if either is missing or invalid
+static bool loadCertificate(SSL_CTX* ctx) {
     const std::string certPath = (conf::CWD / CERT_PATH).string();
     const std::string keyPath = (conf::CWD / KEY_PATH).string();
 
     if ( SSL_CTX_use_certificate_file(ctx, certPath.c_str(), SSL_FILETYPE_PEM) <= 0) {
         ERROR_LOG << "Failed to load ./conf/ssl/cert.pem" << std::endl;
-        return nullptr;
+        return false;
     }
 
     if ( SSL_CTX_use_PrivateKey_file(ctx, keyPath.c_str(), SSL_FILETYPE_PEM) <= 0) {
         ERROR_LOG << "Failed to load ./conf/ssl/key.pem" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+SSL_CTX* initTLSContext() {
+    OPENSSL_no_config();
+
+    SSL_CTX* ctx = SSL_CTX_new( TLS_server_method() );
+    if ( !ctx ) {
+        ERROR_LOG << "Failed to create SSL context." << std::endl;
+        return nullptr;
+    }
+
+    // Load cert and key
+    if (!loadCertificate(ctx)) {
+        SSL_CTX_free(ctx);
         return nullptr;
     }
 
+    // Let OpenSSL hand record encryption to the kernel once the handshake is done, if the kernel & cipher allow it
+    #ifdef HAS_KTLS
+        if (conf::ENABLE_KTLS)
+            SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+    #endif
+
+    // Offer HTTP/2 during the handshake
+    if (conf::ENABLE_HTTP2)
+        SSL_CTX_set_alpn_select_cb(ctx, alpnSelectCallback, nullptr);
+
+    // Session resumption via the server-side cache
+    SSL_CTX_set_session_id_context(ctx, reinterpret_cast<const unsigned char*>(SESSION_ID_CONTEXT), sizeof(SESSION_ID_CONTEXT) - 1);
+    SSL_CTX_set_timeout(ctx, static_cast<long>(conf::TLS_SESSION_TIMEOUT));
+    if (conf::TLS_SESSION_CACHE_SIZE > 0) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx, static_cast<long>(conf::TLS_SESSION_CACHE_SIZE));
+    } else {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+
+    // Session tickets w/ rotating keys, otherwise OpenSSL's built-in key lasts for the life of the context
+    #ifdef HAS_TICKET_KEY_ROTATION
+        {
+            std::unique_lock lock(ticketKeysMutex);
+            if (generateTicketKey(currentTicketKey)) {
+                hasPreviousTicketKey = false;
+                ticketKeyCreated = std::chrono::steady_clock::now();
+                SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticketKeyCallback);
+            } else {
+                ERROR_LOG << "Failed to generate a TLS session ticket key, ticket keys won't be rotated." << std::endl;
+            }
+        }
+    #endif
+
     // Normalize nulls
     if (ctx == NULL)
         ctx = nullptr;
@@ -39,5 +194,75 @@ SSL_CTX* initTLSContext() {
     return ctx;
 }
 
+#ifdef HAS_QUIC
+    // HTTP/3 is the only protocol spoken over QUIC, so clients that don't offer it are refused
+    static int alpnSelectQUICCallback(SSL*, const unsigned char** out, unsigned char* outLen, const unsigned char* in, unsigned int inLen, void*) {
+        unsigned char* selected;
+        const int status = SSL_select_next_proto(&selected, outLen, reinterpret_cast<const unsigned char*>(ALPN_PROTOCOLS_QUIC),
+            sizeof(ALPN_PROTOCOLS_QUIC) - 1, in, inLen);
+        if (status != OPENSSL_NPN_NEGOTIATED) return SSL_TLSEXT_ERR_ALERT_FATAL;
+
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+
+    // Applies KeepAliveTimeout as the idle timeout before the handshake, so it's part of our transport parameters
+    static int pendingQUICConnectionCallback(SSL_CTX*, SSL* pSSL, void*) {
+        return SSL_set_feature_request_uint(pSSL, SSL_VALUE_QUIC_IDLE_TIMEOUT, static_cast<uint64_t>(conf::KEEP_ALIVE_TIMEOUT) * 1000);
+    }
+
+    SSL_CTX* initQUICContext() {
+        SSL_CTX* ctx = SSL_CTX_new( OSSL_QUIC_server_method() );
+        if ( !ctx ) {
+            ERROR_LOG << "Failed to create QUIC context." << std::endl;
+            return nullptr;
+        }
+
+        // The listener is only ever driven from its own thread
+        if (!loadCertificate(ctx) || SSL_CTX_set_domain_flags(ctx, SSL_DOMAIN_FLAG_SINGLE_THREAD) != 1) {
+            SSL_CTX_free(ctx);
+            return nullptr;
+        }
+
+        SSL_CTX_set_alpn_select_cb(ctx, alpnSelectQUICCallback, nullptr);
+        SSL_CTX_set_new_pending_conn_cb(ctx, pendingQUICConnectionCallback, nullptr);
+        return ctx;
+    }
+#endif
+
+SSL_CTX* getSharedTLSContext() {
+    std::unique_lock lock(sharedCTXMutex);
+    if (pSharedCTX == nullptr && (pSharedCTX = initTLSContext()) == nullptr)
+        return nullptr;
+
+    SSL_CTX_up_ref(pSharedCTX);
+    return pSharedCTX;
+}
+
+bool isHTTP2Negotiated(SSL* pSSL) {
+    const unsigned char* protocol;
+    unsigned int length;
+    SSL_get0_alpn_selected(pSSL, &protocol, &length);
+    return length == 2 && memcmp(protocol, "h2", 2) == 0;
+}
+
+void recordTLSHandshake(SSL* pSSL) {
+    if (SSL_session_reused(pSSL))
+        ++numResumedHandshakes;
+    else
+        ++numFullHandshakes;
+}
+
+void getTLSSessionStats(size_t& fullHandshakes, size_t& resumedHandshakes, size_t& cachedSessions) {
+    fullHandshakes = numFullHandshakes;
+    resumedHandshakes = numResumedHandshakes;
+
+    std::unique_lock lock(sharedCTXMutex);
+    cachedSessions = pSharedCTX != nullptr ? static_cast<size_t>( SSL_CTX_sess_number(pSharedCTX) ) : 0;
+}
+
 #undef CERT_PATH
-#undef KEY_PATH
\ No newline at end of file
+#undef KEY_PATH
+#undef SESSION_ID_CONTEXT
+#undef ALPN_PROTOCOLS
+#undef ALPN_PROTOCOLS_QUIC
@@ -1,8 +1,42 @@
 #ifndef __TLS_HPP
 #define __TLS_HPP
 
+#include <cstddef>
+
 #include <openssl/ssl.h>
 
+// Kernel TLS offload & SSL_sendfile need an OpenSSL 3.0+ build w/ kTLS support, on Linux
+#if defined(__linux__) && defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+    #define HAS_KTLS
+#endif
+
+// Custom session ticket keys use the OpenSSL 3.0+ EVP_MAC callback
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    #define HAS_TICKET_KEY_ROTATION
+#endif
+
+// QUIC server support (the HTTP/3 listener) arrived in OpenSSL 3.5, only driven from the Linux poll loop
+#if defined(__linux__) && OPENSSL_VERSION_NUMBER >= 0x30500000L && !defined(OPENSSL_NO_QUIC)
+    #define HAS_QUIC
+#endif
+
+// Creates a new server context w/ the configured cert, session cache & session tickets
 SSL_CTX* initTLSContext();
 
-#endif
\ No newline at end of file
+// Returns the context shared by every TLS listener (created on first use) w/ its reference count incremented,
+// so each caller frees it w/ SSL_CTX_free. Sharing the context lets sessions resume across listeners
+SSL_CTX* getSharedTLSContext();
+
+#ifdef HAS_QUIC
+    // Creates a new QUIC server context w/ the configured cert, which only negotiates HTTP/3
+    SSL_CTX* initQUICContext();
+#endif
+
+// True if the client & server agreed on HTTP/2 via ALPN
+bool isHTTP2Negotiated(SSL* pSSL);
+
+// Counts a completed handshake as either full or resumed
+void recordTLSHandshake(SSL* pSSL);
+void getTLSSessionStats(size_t& fullHandshakes, size_t& resumedHandshakes, size_t& cachedSessions);
+
+#endif
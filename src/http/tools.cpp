@@ -45,50 +45,12 @@ namespace http {
         }
     }
 
-    // Used to extract headers and status info from partial request
-    void loadEarlyHeaders(headers_map_t& headers, const std::string& raw) {
-        // Skip status line
-        std::string line;
-        size_t startIndex = 0;
-        readLine(raw, line, startIndex);
-
-        // Read headers from buffer
-        while (readLine(raw, line, startIndex)) {
-            if (line.size() <= 1) break; // Parse body
-
-            // Check for invalid line format
-            if (line.back() != '\r')
-                throw http::Exception();
-            line.pop_back();
-
-            // Find first colon-space delimiter
-            size_t firstSpaceIndex = line.find(": ");
-            if (firstSpaceIndex != std::string::npos) {
-                std::string key = line.substr(0, firstSpaceIndex);
-                std::string value = line.substr(firstSpaceIndex+2);
-                strToUpper(key);
-
-                // Combine extra list headers
-                if ((key == "ACCEPT" && headers.contains("ACCEPT")) ||
-                    (key == "ACCEPT-ENCODING" && headers.contains("ACCEPT-ENCODING"))) {
-                    headers[key].append(',' + value);
-                } else if (key == "RANGE" && headers.contains("RANGE")) {
-                    size_t bytesEnd = value.find('=');
-                    if (bytesEnd != std::string::npos && bytesEnd + 1 < value.length())
-                        headers[key].append(',' + value.substr(bytesEnd+1) );
-                } else {
-                    headers.insert({key, value});
-                }
-            }
-        }
-    }
-
-    void parseAcceptHeader(std::unordered_set<std::string>& splitVec, std::string& string) {
+    void parseAcceptHeader(std::unordered_set<std::string>& splitVec, const std::string_view string) {
         std::vector<std::string> splitBuf;
         size_t startIndex = 0;
         for (size_t i = 0; i < string.size(); i++) {
             if (string[i] == ',') {
-                std::string substr = string.substr(startIndex, i-startIndex);
+                std::string substr( string.substr(startIndex, i-startIndex) );
                 trimString(substr);
                 if (substr.size() > 0) splitBuf.push_back(substr);
                 startIndex = i+1;
@@ -97,7 +59,7 @@ namespace http {
 
         // Append last snippet
         if (startIndex < string.size()) {
-            std::string substr = string.substr(startIndex);
+            std::string substr( string.substr(startIndex) );
             trimString(substr);
             if (substr.size() > 0) splitBuf.push_back(substr);
         }
@@ -107,7 +69,8 @@ namespace http {
             splitVec.insert(mime.substr(0, mime.find(';')));
     }
 
-    void parseRangeHeader(std::vector<byte_range_t>& splitVec, std::string& rawHeader) {
+    void parseRangeHeader(std::vector<byte_range_t>& splitVec, const std::string_view rangeHeader) {
+        std::string rawHeader(rangeHeader);
         trimString(rawHeader);
         size_t unitStart = rawHeader.find("bytes");
         if (unitStart == std::string::npos) return;
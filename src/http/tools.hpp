@@ -2,11 +2,14 @@
 #define __HTTP_TOOLS_HPP
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "header_map.hpp"
+
 namespace http {
     enum METHOD {
         GET = 0,
@@ -22,20 +25,29 @@ namespace http {
     typedef int Exception;
     typedef std::pair<size_t, size_t> byte_range_t;
 
+    // One buffer of a vectored write
+    typedef struct {
+        const char* data;
+        size_t size;
+    } io_slice_t;
+
+    #define MAX_IO_SLICES 8 // The most slices passed to a single vectored write
+
     // Interval merge helper for byte ranges
     void intervalMergeByteRanges(const std::vector<byte_range_t>& ranges, std::vector<byte_range_t>& sortedRanges, const size_t streamSize);
 
-    // Used to extract headers and status info from partial request
-    typedef std::unordered_map<std::string, std::string> headers_map_t;
-    void loadEarlyHeaders(headers_map_t&, const std::string&);
+    // Request headers, looked up case-insensitively
+    typedef HeaderMap headers_map_t;
 
-    void parseAcceptHeader(std::unordered_set<std::string>&, std::string&);
-    void parseRangeHeader(std::vector<byte_range_t>&, std::string&);
+    void parseAcceptHeader(std::unordered_set<std::string>&, const std::string_view);
+    void parseRangeHeader(std::vector<byte_range_t>&, const std::string_view);
 
     // Used to pass in flags to the Request object (e.g. URI too long, content too large)
     typedef struct RequestFlags {
         bool isContentTooLarge = false;
         bool isURITooLong = false;
+        bool isBodyUnread = false; // Rejected before its body was sent (Expect: 100-continue)
+        bool isRateLimitCharged = false; // Already counted against the rate limits while answering Expect: 100-continue
     } RequestFlags;
 
     // Used to store various copies of the Request path object
@@ -28,7 +28,7 @@ namespace http::version::handler_0_9 {
         }
 
         // Verify access is permitted
-        if (!conf::matchConfigs.empty()) {
+        if (!request.getConfig().matchConfigs.empty()) {
             // Create sanitized IP address
             const std::string decodedURI = request.getDecodedURI();
             const headers_map_t& headers = request.getHeaders();
@@ -36,13 +36,20 @@ namespace http::version::handler_0_9 {
                 conf::SanitizedIP sip( conf::parseSanitizedClientIP(request.getIPStr()) );
 
                 // Check Match patterns
-                for (const std::unique_ptr<conf::Match>& pMatch : conf::matchConfigs) {
+                for (const std::unique_ptr<conf::Match>& pMatch : request.getConfig().matchConfigs) {
                     if (pMatch->doesRequestMatch(decodedURI, headers)) {
                         // Verify access is permitted
                         if (!pMatch->getAccessControl()->isIPAccepted(sip)) {
                             pResponse->setStatus(403);
                             return pResponse;
                         }
+
+                        // Verify the client isn't over the Match's rate limit
+                        const std::unique_ptr<RateLimiter>& pRateLimiter = pMatch->getRateLimiter();
+                        if (pRateLimiter != nullptr && !pRateLimiter->tryAcquire(request.getIPStr())) {
+                            pResponse->setStatus(429);
+                            return pResponse;
+                        }
                     }
                 }
             } catch (std::invalid_argument&) {
@@ -57,7 +64,7 @@ namespace http::version::handler_0_9 {
             return pResponse;
 
         // Lookup file & validate it doesn't have anything wrong with it
-        File file(request.getPaths());
+        File file(request.getPaths(), request.getConfig());
         if (!request.isFileValid(*pResponse, file))
             return pResponse;
 
@@ -40,10 +40,10 @@ namespace http::version::handler_1_0 {
         }
 
         // Handle rewrites
-        if (!conf::rewriteRules.empty()) {
+        if (!request.getConfig().rewriteRules.empty()) {
             // Check rewrite rule patterns
             std::string decodedURI = request.getDecodedURI();
-            for (const std::unique_ptr<conf::Rewrite>& pRewrite : conf::rewriteRules)
+            for (const std::unique_ptr<conf::Rewrite>& pRewrite : request.getConfig().rewriteRules)
                 if (pRewrite->loadRewrittenPath(decodedURI))
                     request.rewriteRawPath(decodedURI);
         }
@@ -55,7 +55,7 @@ namespace http::version::handler_1_0 {
         }
 
         // Verify access is permitted
-        if (!conf::matchConfigs.empty()) {
+        if (!request.getConfig().matchConfigs.empty()) {
             // Create sanitized IP address
             const std::string decodedURI = request.getDecodedURI();
             const headers_map_t& headers = request.getHeaders();
@@ -63,13 +63,21 @@ namespace http::version::handler_1_0 {
                 conf::SanitizedIP sip( conf::parseSanitizedClientIP(request.getIPStr()) );
 
                 // Check Match patterns
-                for (const std::unique_ptr<conf::Match>& pMatch : conf::matchConfigs) {
+                for (const std::unique_ptr<conf::Match>& pMatch : request.getConfig().matchConfigs) {
                     if (pMatch->doesRequestMatch(decodedURI, headers)) {
                         // Verify access is permitted
                         if (!pMatch->getAccessControl()->isIPAccepted(sip)) {
                             setStatusMaybeErrorDoc(request, *pResponse, 403);
                             return pResponse;
                         }
+
+                        // Verify the client isn't over the Match's rate limit (no error doc, to keep it cheap)
+                        const std::unique_ptr<RateLimiter>& pRateLimiter = pMatch->getRateLimiter();
+                        if (pRateLimiter != nullptr && !pRateLimiter->tryAcquire(request.getIPStr())) {
+                            pResponse->setStatus(429);
+                            pResponse->setHeader("Retry-After", std::to_string(pRateLimiter->getRetryAfter()));
+                            return pResponse;
+                        }
                     }
                 }
             } catch (std::invalid_argument&) {
@@ -86,11 +94,11 @@ namespace http::version::handler_1_0 {
         }
         
         // Handle redirects
-        if (!conf::redirectRules.empty()) {
+        if (!request.getConfig().redirectRules.empty()) {
             // Check redirect rule patterns
             const std::string decodedURI = request.getDecodedURI();
             std::string locationBuf;
-            for (const std::unique_ptr<conf::Redirect>& pRedirect : conf::redirectRules) {
+            for (const std::unique_ptr<conf::Redirect>& pRedirect : request.getConfig().redirectRules) {
                 pRedirect->loadRedirectedPath(decodedURI, locationBuf);
                 if (locationBuf.empty()) continue;
 
@@ -108,7 +116,7 @@ namespace http::version::handler_1_0 {
             return pResponse;
 
         // Lookup file & validate it doesn't have anything wrong with it
-        File file(request.getPaths());
+        File file(request.getPaths(), request.getConfig());
         if (!request.isFileValid(*pResponse, file))
             return pResponse;
 
@@ -133,7 +141,7 @@ namespace http::version::handler_1_0 {
                 if (pLastModTS.has_value()) { // Compare timestamps
                     try {
                         // serverTime <= clientTime
-                        if (getFileModTimeT(file.absoluteResourcePath) <= getTimeTFromGMT(*pLastModTS)) {
+                        if (getFileModTimeT(file.absoluteResourcePath) <= getTimeTFromGMT(std::string(*pLastModTS))) {
                             pResponse->setStatus(304);
                             break;
                         }
@@ -159,7 +167,7 @@ namespace http::version::handler_1_0 {
                 // Load additional headers for body loading
                 const std::string reqDecodedURI = request.getDecodedURI();
                 const headers_map_t& reqHeaders = request.getHeaders();
-                for (const std::unique_ptr<conf::Match>& pMatch : conf::matchConfigs)
+                for (const std::unique_ptr<conf::Match>& pMatch : request.getConfig().matchConfigs)
                     if (pMatch->doesRequestMatch(reqDecodedURI, reqHeaders))
                         for (auto [name, value] : pMatch->getHeaders())
                             pResponse->setHeader(name, value);
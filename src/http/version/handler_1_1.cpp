@@ -18,14 +18,13 @@ namespace http::version::handler_1_1 {
             res.loadBodyFromErrorDoc(status);
     }
 
-    std::unique_ptr<Response> genResponse(Request& request) {
-        // Create Response object
-        std::unique_ptr<Response> pResponse = std::unique_ptr<Response>(new Response("HTTP/1.1"));
-
+    // Runs every check that doesn't need the request body (ie. access control, MaxRequestBody & routing)
+    // Returns false once response holds the final response, otherwise file is loaded for the request
+    static bool checkRequest(Request& request, Response& response, std::optional<File>& file) {
         // Verify the URI isn't too large
         if (request.isURITooLong()) {
-            setStatusMaybeErrorDoc(request, *pResponse, 414);
-            return pResponse;
+            setStatusMaybeErrorDoc(request, response, 414);
+            return false;
         }
 
         // Check if method is valid
@@ -33,33 +32,33 @@ namespace http::version::handler_1_1 {
         if (method != METHOD::GET && method != METHOD::HEAD && method != METHOD::OPTIONS
             && method != METHOD::POST && method != METHOD::PUT && method != METHOD::DEL
             && method != METHOD::PATCH) {
-            setStatusMaybeErrorDoc(request, *pResponse, 501); // Not Implemented
-            return pResponse;
+            setStatusMaybeErrorDoc(request, response, 501); // Not Implemented
+            return false;
         }
 
         // Verify no 400 errors have been met
         if ( request.has400Error() ) {
-            pResponse->loadBodyFromErrorDoc(400);
-            return pResponse;
+            response.loadBodyFromErrorDoc(400);
+            return false;
         }
 
         // Handle rewrites
-        if (!conf::rewriteRules.empty()) {
+        if (!request.getConfig().rewriteRules.empty()) {
             // Check rewrite rule patterns
             std::string decodedURI = request.getDecodedURI();
-            for (const std::unique_ptr<conf::Rewrite>& pRewrite : conf::rewriteRules)
+            for (const std::unique_ptr<conf::Rewrite>& pRewrite : request.getConfig().rewriteRules)
                 if (pRewrite->loadRewrittenPath(decodedURI))
                     request.rewriteRawPath(decodedURI);
         }
 
         // Check once more for a 400 error after parsing rewrite rules
         if ( request.has400Error() ) {
-            setStatusMaybeErrorDoc(request, *pResponse, 400);
-            return pResponse;
+            setStatusMaybeErrorDoc(request, response, 400);
+            return false;
         }
 
         // Verify access is permitted
-        if (!conf::matchConfigs.empty()) {
+        if (!request.getConfig().matchConfigs.empty()) {
             // Create sanitized IP address
             const std::string decodedURI = request.getDecodedURI();
             const headers_map_t& headers = request.getHeaders();
@@ -67,75 +66,112 @@ namespace http::version::handler_1_1 {
                 conf::SanitizedIP sip( conf::parseSanitizedClientIP(request.getIPStr()) );
 
                 // Check Match patterns
-                for (const std::unique_ptr<conf::Match>& pMatch : conf::matchConfigs) {
+                for (const std::unique_ptr<conf::Match>& pMatch : request.getConfig().matchConfigs) {
                     if (pMatch->doesRequestMatch(decodedURI, headers)) {
                         // Verify access is permitted
                         if (!pMatch->getAccessControl()->isIPAccepted(sip)) {
-                            setStatusMaybeErrorDoc(request, *pResponse, 403);
-                            return pResponse;
+                            setStatusMaybeErrorDoc(request, response, 403);
+                            return false;
+                        }
+
+                        // Verify the client isn't over the Match's rate limit (no error doc, to keep it cheap)
+                        const std::unique_ptr<RateLimiter>& pRateLimiter = pMatch->getRateLimiter();
+                        if (pRateLimiter != nullptr && !request.isRateLimitCharged() && !pRateLimiter->tryAcquire(request.getIPStr())) {
+                            response.setStatus(429);
+                            response.setHeader("Retry-After", std::to_string(pRateLimiter->getRetryAfter()));
+                            return false;
                         }
                     }
                 }
             } catch (std::invalid_argument&) {
                 ERROR_LOG << "Invalid IP address while parsing sanitized IP (" << request.getIPStr() << ')' << std::endl;
-                setStatusMaybeErrorDoc(request, *pResponse, 500);
-                return pResponse;
+                setStatusMaybeErrorDoc(request, response, 500);
+                return false;
             }
         }
 
         // Verify the body (which is ignored in the Request object) wasn't too large
         if (request.isContentTooLarge()) {
-            setStatusMaybeErrorDoc(request, *pResponse, 413);
-            return pResponse;
+            setStatusMaybeErrorDoc(request, response, 413);
+            return false;
         }
 
         // Handle redirects
-        if (!conf::redirectRules.empty()) {
+        if (!request.getConfig().redirectRules.empty()) {
             // Check redirect rule patterns
             const std::string decodedURI = request.getDecodedURI();
             std::string locationBuf;
-            for (const std::unique_ptr<conf::Redirect>& pRedirect : conf::redirectRules) {
+            for (const std::unique_ptr<conf::Redirect>& pRedirect : request.getConfig().redirectRules) {
                 pRedirect->loadRedirectedPath(decodedURI, locationBuf);
                 if (locationBuf.empty()) continue;
 
                 // New location found, set status
-                pResponse->setStatus( pRedirect->getStatus() );
-                pResponse->setHeader( "Location", locationBuf + request.getDecodedQueryString() );
-                return pResponse;
+                response.setStatus( pRedirect->getStatus() );
+                response.setHeader( "Location", locationBuf + request.getDecodedQueryString() );
+                return false;
             }
         }
 
-        File file(request.getPaths());
+        file.emplace(request.getPaths(), request.getConfig());
 
-        // Bypass document root checks, file checks, and PHP for OPTIONS * (server-wide edge case)
-        if (method != METHOD::OPTIONS || request.getDecodedURI() != "*") {
-            // Verify path is restricted to document root
-            if (!request.isInDocumentRoot(*pResponse, ALLOWED_STATIC_METHODS))
-                return pResponse;
+        // Bypass document root checks & file checks for OPTIONS * (server-wide edge case)
+        if (method == METHOD::OPTIONS && request.getDecodedURI() == "*")
+            return true;
 
-            // Lookup file & validate it doesn't have anything wrong with it
-            if (!request.isFileValid(*pResponse, file))
-                return pResponse;
+        // Verify path is restricted to document root
+        if (!request.isInDocumentRoot(response, ALLOWED_STATIC_METHODS))
+            return false;
 
-            // Check for PHP files
-            if (conf::IS_PHP_ENABLED && file.absoluteResourcePath.ends_with(".php")) {
-                cgi::handlePHPRequest(file, request, *pResponse);
+        // Lookup file & validate it doesn't have anything wrong with it
+        if (!request.isFileValid(response, *file))
+            return false;
 
-                // Load additional headers
-                const std::string reqDecodedURI = request.getDecodedURI();
-                const headers_map_t& reqHeaders = request.getHeaders();
-                for (const std::unique_ptr<conf::Match>& pMatch : conf::matchConfigs)
-                    if (pMatch->doesRequestMatch(reqDecodedURI, reqHeaders))
-                        for (auto [name, value] : pMatch->getHeaders())
-                            pResponse->setHeader(name, value);
+        // Only PHP files take methods w/ a body
+        if ((!conf::IS_PHP_ENABLED || !file->absoluteResourcePath.ends_with(".php")) &&
+            method != METHOD::GET && method != METHOD::HEAD && method != METHOD::OPTIONS) {
+            // If the request allows HTML, return an HTML display
+            response.setHeader("Allow", ALLOWED_STATIC_METHODS);
+            setStatusMaybeErrorDoc(request, response, 405);
+            return false;
+        }
 
-                // Update the byte ranges
-                if (pResponse->getContentLength() > 0)
-                    if (!pResponse->extendByteRanges(request.getByteRanges()))
-                        setStatusMaybeErrorDoc(request, *pResponse, 416); // Range Not Satisfiable            
+        return true;
+    }
 
-                return pResponse;
-            }
+    std::unique_ptr<Response> genEarlyResponse(Request& request) {
+        std::unique_ptr<Response> pResponse = std::unique_ptr<Response>(new Response("HTTP/1.1"));
+        std::optional<File> file;
+        return checkRequest(request, *pResponse, file) ? nullptr : std::move(pResponse);
+    }
+
+    std::unique_ptr<Response> genResponse(Request& request) {
+        // Create Response object
+        std::unique_ptr<Response> pResponse = std::unique_ptr<Response>(new Response("HTTP/1.1"));
+
+        std::optional<File> pFile;
+        if (!checkRequest(request, *pResponse, pFile))
+            return pResponse;
+        File& file = *pFile;
+
+        // Check for PHP files (never the OPTIONS * edge case, which has no file)
+        if (conf::IS_PHP_ENABLED && file.absoluteResourcePath.ends_with(".php") &&
+            (request.getMethod() != METHOD::OPTIONS || request.getDecodedURI() != "*")) {
+            cgi::handlePHPRequest(file, request, *pResponse);
+
+            // Load additional headers
+            const std::string reqDecodedURI = request.getDecodedURI();
+            const headers_map_t& reqHeaders = request.getHeaders();
+            for (const std::unique_ptr<conf::Match>& pMatch : request.getConfig().matchConfigs)
+                if (pMatch->doesRequestMatch(reqDecodedURI, reqHeaders))
+                    for (auto [name, value] : pMatch->getHeaders())
+                        pResponse->setHeader(name, value);
+
+            // Update the byte ranges
+            if (pResponse->getContentLength() > 0)
+                if (!pResponse->extendByteRanges(request.getByteRanges()))
+                    setStatusMaybeErrorDoc(request, *pResponse, 416); // Range Not Satisfiable
+
+            return pResponse;
         }
 
         // Switch on method
@@ -154,7 +190,7 @@ namespace http::version::handler_1_1 {
                     // Compare timestamps
                     try {
                         // serverTime <= clientTime
-                        if (getFileModTimeT(file.absoluteResourcePath) <= getTimeTFromGMT(*pLastModTS)) {
+                        if (getFileModTimeT(file.absoluteResourcePath) <= getTimeTFromGMT(std::string(*pLastModTS))) {
                             pResponse->setStatus(304);
                             break;
                         }
@@ -185,7 +221,7 @@ namespace http::version::handler_1_1 {
                 // Load additional headers for body loading
                 const std::string reqDecodedURI = request.getDecodedURI();
                 const headers_map_t& reqHeaders = request.getHeaders();
-                for (const std::unique_ptr<conf::Match>& pMatch : conf::matchConfigs)
+                for (const std::unique_ptr<conf::Match>& pMatch : request.getConfig().matchConfigs)
                     if (pMatch->doesRequestMatch(reqDecodedURI, reqHeaders))
                         for (auto [name, value] : pMatch->getHeaders())
                             pResponse->setHeader(name, value);
@@ -199,12 +235,7 @@ namespace http::version::handler_1_1 {
                 pResponse->setStatus(204);
                 break;
             }
-            default: { // Method is allowed but invalid for static file
-                // If the request allows HTML, return an HTML display
-                pResponse->setHeader("Allow", ALLOWED_STATIC_METHODS);
-                setStatusMaybeErrorDoc(request, *pResponse, 405);
-                break;
-            }
+            default: break; // Other methods on static files are answered w/ 405 by checkRequest
         }
 
         // Return Response ptr
@@ -8,6 +8,9 @@
 
 namespace http::version::handler_1_1 {
     std::unique_ptr<Response> genResponse(Request&);
+
+    // Returns the final response for a request that's turned away before its body is read, or nullptr if it'd be handled
+    std::unique_ptr<Response> genEarlyResponse(Request&);
 }
 
 #endif
\ No newline at end of file
@@ -5,7 +5,7 @@
 #include "../util/string_tools.hpp"
 #include "../util/toolbox.hpp"
 
-File::File(const http::RequestPath& paths) {
+File::File(const http::RequestPath& paths, const conf::Snapshot& config) {
     this->decodedURIWithoutPathInfo = paths.decodedURI;
     this->queryString = paths.decodedQueryString;
 
@@ -61,7 +61,7 @@ File::File(const http::RequestPath& paths) {
 
     // Check for index file
     if (this->absoluteResourcePath.back() == '/') {
-        for (const std::string& indexFile : conf::INDEX_FILES) {
+        for (const std::string& indexFile : config.INDEX_FILES) {
             if (std::filesystem::exists(absoluteResourcePath + indexFile) &&
                 !std::filesystem::is_directory(absoluteResourcePath + indexFile)) {
                 this->absoluteResourcePath += indexFile;
@@ -80,7 +80,8 @@ File::File(const http::RequestPath& paths) {
         // Lookup MIME type
         std::string ext = std::filesystem::path(this->absoluteResourcePath).extension().string();
         if (ext.size()) ext = ext.substr(1); // Remove leading period
-        this->MIME = conf::MIMES.find(ext) != conf::MIMES.end() ? conf::MIMES[ext] : MIME_UNSET;
+        const auto mimeItr = config.MIMES.find(ext);
+        this->MIME = mimeItr != config.MIMES.end() ? mimeItr->second : MIME_UNSET;
         this->exists = doesFileExist(this->absoluteResourcePath, true);
     }
 
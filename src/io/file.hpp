@@ -8,9 +8,11 @@
 
 #define MIME_UNSET ""
 
+namespace conf { struct Snapshot; }
+
 class File {
     public:
-        File(const http::RequestPath& paths);
+        File(const http::RequestPath& paths, const conf::Snapshot& config);
 
         int loadToBuffer(std::unique_ptr<http::IBodyStream>&);
         std::string getLastModifiedGMT() const;
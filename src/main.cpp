@@ -5,20 +5,35 @@
 #include "conf/conf.hpp"
 #include "http/server.hpp"
 #include "http/server-ipv6.hpp"
+#include "http/server-quic.hpp"
+#include "http/socket_handoff.hpp"
 #include "logs/logger.hpp"
 #include "http/version_checker.hpp"
 #include "util/cli.hpp"
 
-// Global termination flag (atomic)
+#define UPGRADE_DRAIN_POLL_MS 100
+
+// Global termination flag (atomic), wakes the CLI loop
 std::atomic<bool> isExiting{false};
 
+// Why the CLI loop was woken (CLI_ACTION_*), ie. exit, reload the config, or hand the listening sockets to a new process (Linux only)
+std::atomic<int> pendingAction{CLI_ACTION_NONE};
+
 std::vector<std::shared_ptr<http::Server>> serversVec;
 
 /******************** SIGNAL HANDLERS & CLEANUP ********************/
 
 void catchSig(int) {
     std::cout << std::endl;
-    isExiting.store(true);
+    requestCLIAction(pendingAction, isExiting, CLI_ACTION_EXIT);
+}
+
+void catchUpgradeSig(int) {
+    requestCLIAction(pendingAction, isExiting, CLI_ACTION_UPGRADE);
+}
+
+void catchReloadSig(int) {
+    requestCLIAction(pendingAction, isExiting, CLI_ACTION_RELOAD);
 }
 
 #ifdef _WIN32
@@ -50,6 +65,24 @@ void initSigHandler() {
         sigaction(SIGINT, &sigIntHandler, NULL);
         sigaction(SIGTERM, &sigIntHandler, NULL);
 
+        // Graceful upgrade
+        struct sigaction sigUpgradeHandler;
+
+        sigUpgradeHandler.sa_handler = catchUpgradeSig;
+        sigemptyset(&sigUpgradeHandler.sa_mask);
+        sigUpgradeHandler.sa_flags = 0;
+
+        sigaction(SIGUSR2, &sigUpgradeHandler, NULL);
+
+        // Config reload
+        struct sigaction sigReloadHandler;
+
+        sigReloadHandler.sa_handler = catchReloadSig;
+        sigemptyset(&sigReloadHandler.sa_mask);
+        sigReloadHandler.sa_flags = 0;
+
+        sigaction(SIGHUP, &sigReloadHandler, NULL);
+
         // Ignore SIGPIPE
         signal(SIGPIPE, SIG_IGN);
     #endif
@@ -133,6 +166,37 @@ void printDonationBanner() {
         << std::endl;
 }
 
+/******************** UPGRADES ********************/
+
+// Hands every listening socket to a new process, then lets in-flight requests finish (up to UpgradeDrainTimeout)
+// Returns false if the new process didn't start, in which case nothing has changed
+bool upgradeProcess(char* argv[]) {
+    std::vector<int> listenSocks;
+    for (auto& server : serversVec)
+        if (server->getListeningSocket() != SOCKET_UNSET)
+            listenSocks.push_back(server->getListeningSocket());
+
+    std::cout << "> Starting upgraded process..." << std::endl;
+    if (!http::spawnUpgradedProcess(argv, listenSocks))
+        return false;
+
+    std::cout << "> Draining connections..." << std::endl;
+    for (auto& server : serversVec)
+        server->drain();
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(conf::UPGRADE_DRAIN_TIMEOUT);
+    while (std::chrono::steady_clock::now() < deadline) {
+        bool isDrained = true;
+        for (auto& server : serversVec)
+            isDrained = isDrained && server->isDrained();
+        if (isDrained) break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(UPGRADE_DRAIN_POLL_MS));
+    }
+
+    return true;
+}
+
 /******************** ENTRY POINT ********************/
 
 int main(int argc, char* argv[]) {
@@ -156,6 +220,9 @@ int main(int argc, char* argv[]) {
     // Configure interrupt handler
     initSigHandler();
 
+    // Pick up any listening sockets passed on by the process being upgraded (or systemd)
+    http::loadInheritedSockets();
+
     // Load config files
     if (conf::loadConfig(argc, argv) == CONF_FAILURE) {
         cleanExit();
@@ -175,21 +242,34 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    // Init server
-    if (conf::IS_IPV4_ENABLED)
-        serversVec.emplace_back(std::make_shared<http::Server>(conf::PORT, false));
-
-    if (conf::IS_IPV6_ENABLED)
-        serversVec.emplace_back(std::make_shared<http::ServerV6>(conf::PORT, false));
-
-    if (conf::USE_TLS) {
+    // Init server (one listening socket per shard, the kernel balances connections between them)
+    for (unsigned int shard = 0; shard < conf::ACCEPT_SHARDS; ++shard) {
         if (conf::IS_IPV4_ENABLED)
-            serversVec.emplace_back(std::make_shared<http::Server>(conf::TLS_PORT, true));
+            serversVec.emplace_back(std::make_shared<http::Server>(conf::PORT, false, shard));
 
         if (conf::IS_IPV6_ENABLED)
-            serversVec.emplace_back(std::make_shared<http::ServerV6>(conf::TLS_PORT, true));
+            serversVec.emplace_back(std::make_shared<http::ServerV6>(conf::PORT, false, shard));
+
+        if (conf::USE_TLS) {
+            if (conf::IS_IPV4_ENABLED)
+                serversVec.emplace_back(std::make_shared<http::Server>(conf::TLS_PORT, true, shard));
+
+            if (conf::IS_IPV6_ENABLED)
+                serversVec.emplace_back(std::make_shared<http::ServerV6>(conf::TLS_PORT, true, shard));
+        }
     }
 
+    // Experimental HTTP/3 listeners, one per address family since the kernel can't balance QUIC connections between sockets
+    #ifdef HAS_QUIC
+        if (conf::HTTP3_PORT != 0) {
+            if (conf::IS_IPV4_ENABLED)
+                serversVec.emplace_back(std::make_shared<http::QUICServer>(conf::HTTP3_PORT, false));
+
+            if (conf::IS_IPV6_ENABLED)
+                serversVec.emplace_back(std::make_shared<http::QUICServer>(conf::HTTP3_PORT, true));
+        }
+    #endif
+
     // Remove servers that fail to start
     for (auto itr = serversVec.begin(); itr != serversVec.end(); (void)itr) {
         if ((*itr)->init() != 0) {
@@ -208,6 +288,10 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Let the process being upgraded know it can start draining
+    http::closeUnclaimedSockets();
+    http::notifyUpgradeReady();
+
     // Print welcome banner
     if (conf::SHOW_WELCOME_BANNER)
         printWelcomeBanner();
@@ -221,8 +305,26 @@ int main(int argc, char* argv[]) {
     for (auto& server : serversVec)
         threads.emplace_back(std::thread([server]() { server->acceptLoop(); }));
 
-    // Wait for "exit" in cin (sets isExiting if "exit" is found)
-    awaitCLI(isExiting, serversVec);
+    // Wait for "exit" in cin (sets isExiting if "exit" is found), or for an upgrade
+    while (true) {
+        awaitCLI(isExiting, pendingAction, serversVec);
+
+        // Clear the wake-up before taking the action, so anything requested from here on wakes the CLI again
+        isExiting.store(false);
+        const int action = pendingAction.exchange(CLI_ACTION_NONE);
+
+        // Reload on SIGHUP & keep serving
+        if (action == CLI_ACTION_RELOAD) {
+            handleReload();
+            continue;
+        }
+
+        // Exit (also on EOF, which queues no action)
+        if (action != CLI_ACTION_UPGRADE || upgradeProcess(argv)) break;
+
+        // Keep serving if the new process didn't come up
+        std::cout << "> Upgrade failed, see the error log." << std::endl;
+    }
 
     /******* Reached if closing the program *******/
     std::cout << "> Shutting down..." << std::endl;
@@ -239,3 +341,5 @@ int main(int argc, char* argv[]) {
     cleanExit();
     return 0;
 }
+
+#undef UPGRADE_DRAIN_POLL_MS
@@ -3,6 +3,8 @@
 #include <iostream>
 
 #include "../conf/conf.hpp"
+#include "../http/tls.hpp"
+#include "../logs/logger.hpp"
 
 #ifdef _WIN32
     // Only used in Windows builds for canonicalizing the path to the PHP init script
@@ -122,7 +124,18 @@
     }
 #endif
 
-void handleCLICommands(const std::string& buf, std::atomic<bool>& isExiting, std::vector<std::shared_ptr<http::Server>>& serversVec) {
+void handleReload() {
+    std::cout << "> Reloading config..." << std::endl;
+    if (conf::reloadConfig() == CONF_FAILURE) {
+        std::cout << "> Reload failed, still using the previous config." << std::endl;
+        return;
+    }
+
+    ACCESS_LOG << "Config reloaded successfully." << std::endl;
+    std::cout << "> Config reloaded." << std::endl;
+}
+
+void handleCLICommands(const std::string& buf, std::atomic<bool>& isExiting, std::atomic<int>& pendingAction, std::vector<std::shared_ptr<http::Server>>& serversVec) {
     // Clean exit
     if (buf == "CLEAR") {
         std::cout << "\033[2J\033[H" << std::flush;
@@ -130,31 +143,51 @@ void handleCLICommands(const std::string& buf, std::atomic<bool>& isExiting, std
         std::cout << "> Love Mercury? Consider supporting this project:\n"
             "     https://buymeacoffee.com/travis.heavener" << std::endl;
     } else if (buf == "EXIT") {
-        isExiting.store(true);
+        requestCLIAction(pendingAction, isExiting, CLI_ACTION_EXIT);
     } else if (buf == "INFO" || buf == "STATUS") {
         // Print usage info
-        size_t usedThreads = 0, totalThreads = 0, pendingConnections = 0;
+        size_t usedThreads = 0, totalThreads = 0, pendingConnections = 0, shedConnections = 0;
         for (auto& pServer : serversVec)
-            pServer->getUsageInfo(usedThreads, totalThreads, pendingConnections);
+            pServer->getUsageInfo(usedThreads, totalThreads, pendingConnections, shedConnections);
 
         std::cout << std::fixed << std::setprecision(1) << "> "
             << std::min(static_cast<double>(usedThreads) / totalThreads * 100, 100.0) << "% usage ("
-            << usedThreads << '/' << totalThreads << " threads, " << pendingConnections << " pending connections)"
+            << usedThreads << '/' << totalThreads << " threads, " << pendingConnections << " pending connections, "
+            << shedConnections << " shed connections)"
             << std::endl;
+
+        // Print TLS session resumption stats
+        if (conf::USE_TLS) {
+            size_t fullHandshakes = 0, resumedHandshakes = 0, cachedSessions = 0;
+            getTLSSessionStats(fullHandshakes, resumedHandshakes, cachedSessions);
+
+            const size_t totalHandshakes = fullHandshakes + resumedHandshakes;
+            std::cout << "> " << (totalHandshakes == 0 ? 0.0 : static_cast<double>(resumedHandshakes) / totalHandshakes * 100)
+                << "% TLS sessions resumed (" << resumedHandshakes << '/' << totalHandshakes << " handshakes, "
+                << cachedSessions << " cached sessions)" << std::endl;
+        }
     } else if (buf == "PING") {
         std::cout << "> Pong!" << std::endl;
     } else if (buf == "PWD") {
         std::cout << conf::DOCUMENT_ROOT.string() << std::endl;
+    } else if (buf == "RELOAD") {
+        // Same as SIGHUP
+        handleReload();
+    } else if (buf == "UPGRADE") {
+        // Same as SIGUSR2
+        requestCLIAction(pendingAction, isExiting, CLI_ACTION_UPGRADE);
     } else if (buf == "HELP") {
         std::cout << "> Clear: Clears the terminal window\n"
             "  Donate: Shows optional donation URL\n"
             "  Exit: Exit Mercury\n"
             "  Help: List available commands\n"
-            "  Info: View current utilization\n"
+            "  Info: View current utilization, shed connections & TLS session resumption\n"
             "  PHPInit: Initializes platform-specific PHP\n"
             "  Ping: Pong!\n"
             "  Pwd: Prints the document root\n"
-            "  Status: See \"info\""
+            "  Reload: Reloads Match, Redirect, Rewrite & IndexFiles from mercury.conf, & mimes.conf\n"
+            "  Status: See \"info\"\n"
+            "  Upgrade: Hands off to the executable on disk w/out dropping connections (Linux only)"
             << std::endl;
     } else if (buf == "PHPINIT") {
         #ifdef _WIN32 // Windows specific
@@ -223,7 +256,7 @@ void handleCLICommands(const std::string& buf, std::atomic<bool>& isExiting, std
     }
 }
 
-void awaitCLI(std::atomic<bool>& isExiting, std::vector<std::shared_ptr<http::Server>>& serversVec) {
+void awaitCLI(std::atomic<bool>& isExiting, std::atomic<int>& pendingAction, std::vector<std::shared_ptr<http::Server>>& serversVec) {
     #ifdef _WIN32
         // Check if connected to a terminal
         {
@@ -278,7 +311,7 @@ void awaitCLI(std::atomic<bool>& isExiting, std::vector<std::shared_ptr<http::Se
         }
 
         // Handle the CLI commands
-        handleCLICommands(buf, isExiting, serversVec);
+        handleCLICommands(buf, isExiting, pendingAction, serversVec);
 
         if (isExiting) return;
     }
@@ -40,7 +40,24 @@
     void readNextLine(std::atomic<bool>& isExiting, std::vector<std::string>& history, int& historyIndex);
 #endif
 
-void handleCLICommands(const std::string& buf, std::atomic<bool>& isExiting, std::vector<std::shared_ptr<http::Server>>& serversVec);
-void awaitCLI(std::atomic<bool>& isExiting, std::vector<std::shared_ptr<http::Server>>& serversVec);
+// What the main loop does once the CLI returns, ordered by priority
+#define CLI_ACTION_NONE 0
+#define CLI_ACTION_RELOAD 1
+#define CLI_ACTION_UPGRADE 2
+#define CLI_ACTION_EXIT 3
+
+// Queues an action & wakes the CLI, a pending action is only replaced by a higher priority one (ie. nothing replaces an exit)
+// Lock-free, so it's safe from signal handlers
+inline void requestCLIAction(std::atomic<int>& pendingAction, std::atomic<bool>& isExiting, const int action) {
+    int current = pendingAction.load();
+    while (current < action && !pendingAction.compare_exchange_weak(current, action));
+    isExiting.store(true);
+}
+
+// Reloads the config, in-flight requests finish w/ the config they started w/
+void handleReload();
+
+void handleCLICommands(const std::string& buf, std::atomic<bool>& isExiting, std::atomic<int>& pendingAction, std::vector<std::shared_ptr<http::Server>>& serversVec);
+void awaitCLI(std::atomic<bool>& isExiting, std::atomic<int>& pendingAction, std::vector<std::shared_ptr<http::Server>>& serversVec);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "rate_limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// How often each shard drops its idle buckets
+#define RATE_LIMITER_SWEEP_MS 10000
+
+RateLimiter::RateLimiter(const unsigned int requestsPerSecond, const unsigned int burst)
+    : tokensPerSecond(requestsPerSecond), burst((std::max)(burst, 1u)),
+    refillTime(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(this->burst / tokensPerSecond))),
+    retryAfter(static_cast<unsigned int>(std::ceil(1.0 / tokensPerSecond))) {
+    const time_point_t now = std::chrono::steady_clock::now();
+    for (Shard& shard : shards)
+        shard.lastSweep = now;
+}
+
+bool RateLimiter::tryAcquire(const std::string& key, const time_point_t now) {
+    Shard& shard = shards[std::hash<std::string>{}(key) % NUM_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (now - shard.lastSweep >= std::chrono::milliseconds(RATE_LIMITER_SWEEP_MS)) {
+        this->sweep(shard, now);
+        shard.lastSweep = now;
+    }
+
+    // New clients start w/ a full bucket, otherwise top it up for the time since the last request
+    auto [it, isNew] = shard.buckets.try_emplace(key, Bucket{ burst, now });
+    Bucket& bucket = it->second;
+    if (!isNew) {
+        const double elapsed = std::chrono::duration<double>(now - bucket.lastRefill).count();
+        bucket.tokens = (std::min)(burst, bucket.tokens + elapsed * tokensPerSecond);
+        bucket.lastRefill = now;
+    }
+
+    if (bucket.tokens < 1.0) return false;
+    bucket.tokens -= 1.0;
+    return true;
+}
+
+// Drops buckets that have had time to fill back up, they're no different from a new client's
+// Must be called w/ the shard's mutex held
+void RateLimiter::sweep(Shard& shard, const time_point_t now) const {
+    std::erase_if(shard.buckets, [&](const auto& entry) { return now - entry.second.lastRefill >= refillTime; });
+}
+
+#undef RATE_LIMITER_SWEEP_MS
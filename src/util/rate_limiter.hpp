@@ -0,0 +1,50 @@
+#ifndef __RATE_LIMITER_HPP
+#define __RATE_LIMITER_HPP
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Per-client token buckets, each key (ie. a client IP) gets burst tokens that refill at requestsPerSecond
+// The table is split into shards w/ their own lock, so clients rarely contend w/ each other
+class RateLimiter {
+    public:
+        typedef std::chrono::steady_clock::time_point time_point_t;
+
+        RateLimiter(const unsigned int requestsPerSecond, const unsigned int burst);
+
+        // Takes a token from the key's bucket, returns false if it's empty (ie. the request should be turned away)
+        inline bool tryAcquire(const std::string& key) { return tryAcquire(key, std::chrono::steady_clock::now()); };
+
+        // Same as above at a given time, which must never go backwards (the unit tests drive the clock themselves)
+        bool tryAcquire(const std::string& key, const time_point_t now);
+
+        // Seconds until an empty bucket has a token again, used for Retry-After
+        inline unsigned int getRetryAfter() const { return retryAfter; };
+    private:
+        static constexpr size_t NUM_SHARDS = 64;
+
+        struct Bucket {
+            double tokens;
+            time_point_t lastRefill;
+        };
+
+        // Aligned so neighbouring shards' locks don't share a cache line
+        struct alignas(64) Shard {
+            std::mutex mutex;
+            std::unordered_map<std::string, Bucket> buckets;
+            time_point_t lastSweep;
+        };
+
+        void sweep(Shard& shard, const time_point_t now) const;
+
+        const double tokensPerSecond;
+        const double burst;
+        const std::chrono::steady_clock::duration refillTime; // Time for an empty bucket to fill back up
+        const unsigned int retryAfter;
+        std::array<Shard, NUM_SHARDS> shards;
+};
+
+#endif
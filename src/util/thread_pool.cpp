@@ -1,15 +1,20 @@
 #include "thread_pool.hpp"
 
-#include "../conf/conf.hpp"
+#include <algorithm>
+#include <chrono>
 
-ThreadPool::ThreadPool() {
-    // Create idle threads
-    workers.reserve(conf::MAX_THREADS_PER_CHILD);
+// How long an idle temporary thread waits for more work before exiting
+#define TEMP_THREAD_LINGER_MS 250
 
-    for (size_t i = 0; i < conf::IDLE_THREADS_PER_CHILD; ++i) {
-        workers.emplace_back( ThreadWrapper(false) );
-        workers.back().setThread( std::thread([this] { this->workerLoop(workers.back()); }) );
-    }
+ThreadPool::ThreadPool(const size_t idleThreads, const size_t maxThreads) {
+    const size_t totalSlots = (std::max)(idleThreads, maxThreads);
+    workers.reserve(totalSlots);
+    for (size_t i = 0; i < totalSlots; ++i)
+        workers.emplace_back( std::make_unique<ThreadWrapper>(i >= idleThreads) );
+
+    // Create idle threads
+    for (size_t i = 0; i < idleThreads; ++i)
+        this->spawnWorker(i);
 }
 
 ThreadPool::~ThreadPool() {
@@ -17,109 +22,156 @@ ThreadPool::~ThreadPool() {
 }
 
 void ThreadPool::enqueue(std::function<void()> task) {
+    size_t pending;
     {
         std::lock_guard<std::mutex> lock(queueMutex);
         tasks.push(std::move(task));
-
-        // Check if there are too many connections pending
-        if (tasks.size() > workers.size() && workers.size() < conf::MAX_THREADS_PER_CHILD) {
-            // Create a new temporary thread
-            workers.emplace_back( ThreadWrapper(true) );
-            workers.back().setThread( std::thread([this] { this->workerLoop(workers.back()); }) );
-        }
+        pending = ++numPending;
     }
 
+    // Check if there are too many connections pending
+    if (pending > numActive && numActive < workers.size())
+        this->spawnTemporaryWorker();
+
     // Notify next available worker
     condition.notify_one();
 }
 
+// Starts a worker thread in the given slot, must be called w/ spawnMutex held (or before any workers exist)
+void ThreadPool::spawnWorker(const size_t index) {
+    ThreadWrapper& slot = *workers[index];
+
+    // Reap the slot's previous thread, which has already left workerLoop
+    if (slot.getThread().joinable())
+        slot.getThread().join();
+
+    slot.isActive = true;
+    ++numActive;
+    slot.setThread( std::thread([this, &slot] { this->workerLoop(slot); }) );
+
+    #ifdef __linux__
+        if (pinnedCPUs.has_value())
+            setThreadCPUAffinity(slot.getThread().native_handle(), *pinnedCPUs);
+    #endif
+}
+
+// Starts a temporary thread in the first free slot, if any
+void ThreadPool::spawnTemporaryWorker() {
+    std::lock_guard<std::mutex> lock(spawnMutex);
+    if (isStopping) return;
+
+    for (size_t i = 0; i < workers.size(); ++i) {
+        if (workers[i]->isTemporary && !workers[i]->isActive) {
+            this->spawnWorker(i);
+            return;
+        }
+    }
+}
+
 // Continuously load tasks onto worker threads
 void ThreadPool::workerLoop(ThreadWrapper& thisThread) {
+    const auto hasWork = [this] { return isStopping || !tasks.empty(); };
     while (true) {
         std::function<void()> task;
-
         {
-            // Prevent race condition
             std::unique_lock<std::mutex> lock(queueMutex);
-            condition.wait(lock, [this] {
-                return isStopping || !tasks.empty();
-            });
 
-            // Exit early if stopping
-            if (isStopping && tasks.empty())
+            // Temporary threads give up their slot once they've been idle for a while
+            bool hasTask = true;
+            if (thisThread.isTemporary)
+                hasTask = condition.wait_for(lock, std::chrono::milliseconds(TEMP_THREAD_LINGER_MS), hasWork);
+            else
+                condition.wait(lock, hasWork);
+
+            // Exit once idle (temporary threads) or once the backlog is drained while stopping
+            // Given up under the lock, so an enqueue that misses this thread sees it's gone & spawns another
+            if (!hasTask || tasks.empty()) {
+                --numActive;
+                thisThread.isActive = false;
                 return;
+            }
 
             // Pop task from front
             task = std::move(tasks.front());
             tasks.pop();
+            --numPending;
         }
 
         thisThread.isInUse = true;
         task(); // Run task
         thisThread.isInUse = false;
-
-        // If this is a temporary thread and the backlog is decreasing in size, destroy self
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            if (thisThread.isTemporary && tasks.size() < workers.size()) {
-                // Tell the ThreadPool to prune temporary threads
-                thisThread.isDone = true;
-                this->shouldPruneWorkers = true;
-                return;
-            } else if (!thisThread.isTemporary && this->shouldPruneWorkers) {
-                // Invoke prune
-                this->pruneTempThreads();
-            }
-        }
-    }
-}
-
-// Prunes any finished threads
-void ThreadPool::pruneTempThreads() {
-    // Already called while locked, no need to lock here!
-    for (size_t i = 0; i < workers.size(); ++i) {
-        if (!workers[i].isTemporary || !workers[i].isDone) continue;
-
-        // Temp thread is done, erase it
-        std::thread& t = workers[i].getThread();
-        if (t.joinable())
-            t.join();
-
-        workers.erase(workers.begin() + i);
-        --i;
     }
-
-    // Reset flag
-    this->shouldPruneWorkers = false;
 }
 
 // Join each existing thread for shutdown
 void ThreadPool::stop() {
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
+        // Prevent new temporary threads
+        std::lock_guard<std::mutex> spawnLock(spawnMutex);
+        std::lock_guard<std::mutex> queueLock(queueMutex);
         isStopping = true;
     }
 
     condition.notify_all();
 
     // Join all threads
-    while (!workers.empty()) {
-        // Join thread
-        std::thread& t = workers.back().getThread();
+    for (const std::unique_ptr<ThreadWrapper>& pWrapper : workers) {
+        std::thread& t = pWrapper->getThread();
         if (t.joinable())
             t.join();
-
-        // Destroy ThreadWrapper
-        workers.pop_back();
     }
 }
 
 // Gathers usage info for this ThreadPool
 void ThreadPool::getUsageInfo(size_t& usedThreads, size_t& totalThreads, size_t& pendingConnections) {
-    // Protect against consecutive IO to workers
-    std::lock_guard<std::mutex> lock(queueMutex);
-    for (const ThreadWrapper& tw : workers)
-        usedThreads += tw.isInUse ? 1 : 0;
-    totalThreads += workers.size();
-    pendingConnections += tasks.size();
-}
\ No newline at end of file
+    for (const std::unique_ptr<ThreadWrapper>& pWrapper : workers)
+        usedThreads += pWrapper->isInUse ? 1 : 0;
+    totalThreads += numActive;
+    pendingConnections += numPending;
+}
+
+#ifdef __linux__
+    void ThreadPool::setCPUAffinity(const cpu_set_t& cpuSet) {
+        std::lock_guard<std::mutex> lock(spawnMutex);
+        pinnedCPUs = cpuSet;
+        for (const std::unique_ptr<ThreadWrapper>& pWrapper : workers)
+            if (pWrapper->isActive)
+                setThreadCPUAffinity(pWrapper->getThread().native_handle(), cpuSet);
+    }
+
+    // The cores the process started w/, read during static init so it's before any thread is pinned
+    static const cpu_set_t initialCPUSet = [] {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) != 0 || CPU_COUNT(&cpuSet) == 0)
+            for (unsigned int i = 0; i < (std::max)(std::thread::hardware_concurrency(), 1u); ++i)
+                CPU_SET(i, &cpuSet);
+        return cpuSet;
+    }();
+
+    void getShardCPUSet(const unsigned int shardIndex, const unsigned int numShards, cpu_set_t& cpuSet) {
+        std::vector<unsigned int> cpus;
+        for (unsigned int i = 0; i < CPU_SETSIZE; ++i)
+            if (CPU_ISSET(i, &initialCPUSet))
+                cpus.push_back(i);
+
+        CPU_ZERO(&cpuSet);
+        if (numShards > cpus.size()) {
+            CPU_SET(cpus[shardIndex % cpus.size()], &cpuSet);
+            return;
+        }
+
+        for (size_t i = shardIndex % numShards; i < cpus.size(); i += numShards)
+            CPU_SET(cpus[i], &cpuSet);
+    }
+
+    bool setThreadCPUAffinity(pthread_t thread, const cpu_set_t& cpuSet) {
+        return pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet) == 0;
+    }
+
+    bool resetCPUAffinity() {
+        return sched_setaffinity(0, sizeof(initialCPUSet), &initialCPUSet) == 0;
+    }
+#endif
+
+#undef TEMP_THREAD_LINGER_MS
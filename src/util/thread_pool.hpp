@@ -1,7 +1,6 @@
 #ifndef __THREAD_POOL_HPP
 #define __THREAD_POOL_HPP
 
-#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <functional>
@@ -10,38 +9,72 @@
 #include <optional>
 #include <queue>
 #include <thread>
+#include <vector>
+
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+
+    // Fills cpuSet w/ the shard's slice of the cores the process started w/, slices are disjoint across shards
+    // Every numShards-th core goes to the same shard, or a single core if there are more shards than cores
+    void getShardCPUSet(const unsigned int shardIndex, const unsigned int numShards, cpu_set_t& cpuSet);
+
+    // Restricts the thread to the given cores, returns true if successful
+    bool setThreadCPUAffinity(pthread_t thread, const cpu_set_t& cpuSet);
+
+    // Restores the calling thread's cores to the ones the process started w/ (ie. in a forked child), returns true if successful
+    bool resetCPUAffinity();
+#endif
 
 class ThreadWrapper {
     public:
         ThreadWrapper(const bool isTemporary) : isTemporary(isTemporary) {};
         void setThread(std::thread t) { thread = std::move(t); };
         std::thread& getThread() { return thread; };
-        bool isTemporary;
-        bool isDone = false;
-        bool isInUse = false;
+        const bool isTemporary;
+        std::atomic<bool> isActive{false}; // True while a thread is running in this slot
+        std::atomic<bool> isInUse{false};
     private:
         std::thread thread;
 };
 
+// Single queue pool, temporary threads are started (up to maxThreads) while the backlog outgrows the active threads
 class ThreadPool {
     public:
-        ThreadPool();
+        ThreadPool(const size_t idleThreads, const size_t maxThreads);
         ~ThreadPool();
 
         void enqueue(std::function<void()> task);
         void stop();
         void getUsageInfo(size_t& usedThreads, size_t& totalThreads, size_t& pendingConnections);
+        inline size_t getNumPending() const { return numPending; }; // Tasks queued but not yet started
+
+        #ifdef __linux__
+            // Pins all current & future workers to the given cores
+            void setCPUAffinity(const cpu_set_t& cpuSet);
+        #endif
     private:
+        void spawnWorker(const size_t index);
+        void spawnTemporaryWorker();
         void workerLoop(ThreadWrapper& thisThread);
-        void pruneTempThreads();
 
-        std::vector<ThreadWrapper> workers;
-        std::queue<std::function<void()>> tasks;
+        // Every slot is allocated up front so running workers' references are never invalidated
+        // The first idleThreads slots are permanent, the rest are temporary
+        std::vector<std::unique_ptr<ThreadWrapper>> workers;
 
+        std::queue<std::function<void()>> tasks;
         std::mutex queueMutex;
         std::condition_variable condition;
+
+        std::atomic<size_t> numPending{0}; // Mirrors tasks.size(), so it can be read w/out the lock
+        std::atomic<size_t> numActive{0};
+
+        std::mutex spawnMutex;
         std::atomic<bool> isStopping{false};
-        std::atomic<bool> shouldPruneWorkers{false};
+
+        #ifdef __linux__
+            std::optional<cpu_set_t> pinnedCPUs;
+        #endif
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,159 @@
+"""
+
+Author: Travis Heavener (https://github.com/travis-heavener/)
+
+This file benchmarks the Mercury HTTP server by comparing the
+  throughput of different config variants against the same workload.
+
+Usage: python3 benchmark.py <scenario> [--duration SECONDS] [--clients N]
+
+"""
+
+from multiprocessing import Pool
+import argparse
+import os
+import re
+import signal
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+host = "127.0.0.1"
+port = 8080
+
+BASE_CONF = "conf_files/normal.conf"
+
+# Each scenario compares config variants (label, node overrides) against a single request path
+SCENARIOS = {
+    "accept-shards": {
+        "desc": "Single acceptor vs. one SO_REUSEPORT acceptor per core under connection churn",
+        "path": "/index.html",
+        "keep_alive": False,
+        "variants": [
+            ("1 shard", { "AcceptShards": "1" }),
+            ("auto shards", { "AcceptShards": "auto" })
+        ]
+    }
+}
+
+# Writes a copy of the base config w/ the given node values replaced
+def write_conf(overrides: dict) -> str:
+    with open(BASE_CONF, "r") as f:
+        conf = f.read()
+
+    # Disable TLS & PHP so only the plaintext path is measured
+    overrides = { "TLSPort": "off", "EnablePHPCGI": "off", **overrides }
+    for node, value in overrides.items():
+        conf, n = re.subn(rf"<{node}>.*?</{node}>", f"<{node}> {value} </{node}>", conf, count=1)
+        if n == 0:
+            raise KeyError(f"Missing {node} node in {BASE_CONF}")
+
+    fd, path = tempfile.mkstemp(suffix=".conf")
+    with os.fdopen(fd, "w") as f:
+        f.write(conf)
+    return path
+
+# Sleeps the main thread until the server accepts connections
+def wait_until_live() -> bool:
+    start_ts = time.time()
+    while time.time() < start_ts + 15:
+        try:
+            with socket.create_connection((host, port), timeout=1):
+                return True
+        except OSError:
+            time.sleep(0.25)
+    return False
+
+# Reads a single keep-alive response, returns False if the connection closed
+def read_response(s: socket.socket, buf: bytes) -> tuple[bool, bytes]:
+    while b"\r\n\r\n" not in buf:
+        chunk = s.recv(65536)
+        if not chunk: return False, buf
+        buf += chunk
+
+    header_end = buf.find(b"\r\n\r\n") + 4
+    match = re.search(rb"(?i)\r\ncontent-length:\s*(\d+)", buf[:header_end])
+    body_len = int(match.group(1)) if match else 0
+
+    while len(buf) < header_end + body_len:
+        chunk = s.recv(65536)
+        if not chunk: return False, buf
+        buf += chunk
+
+    return True, buf[header_end + body_len:]
+
+# Sends requests until the deadline, returns the number of responses
+# If keep_alive is False, each request opens a new connection
+def client_worker(args: tuple[str, float, bool]) -> int:
+    path, deadline, keep_alive = args
+    request = f"GET {path} HTTP/1.1\r\nHost: {host}\r\nConnection: {'keep-alive' if keep_alive else 'close'}\r\n\r\n".encode()
+
+    num_responses = 0
+    s, buf = None, b""
+    while time.time() < deadline:
+        try:
+            if s is None:
+                s = socket.create_connection((host, port), timeout=5)
+                buf = b""
+
+            s.sendall(request)
+            ok, buf = read_response(s, buf)
+            if not ok:
+                s.close(); s = None # Reconnect once KeepAliveMaxRequests is hit
+                continue
+            num_responses += 1
+
+            if not keep_alive:
+                s.close(); s = None
+        except OSError:
+            if s is not None: s.close()
+            s = None
+
+    if s is not None: s.close()
+    return num_responses
+
+# Runs a single config variant, returns the requests per second
+def run_variant(overrides: dict, path: str, keep_alive: bool, duration: float, clients: int) -> float:
+    conf_path = write_conf(overrides)
+    proc = subprocess.Popen(
+        [ "../bin/mercury", conf_path ],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, stdin=subprocess.PIPE
+    )
+
+    try:
+        if not wait_until_live():
+            raise RuntimeError("Server timed out when starting")
+
+        deadline = time.time() + duration
+        with Pool(clients) as pool:
+            total = sum( pool.map(client_worker, [(path, deadline, keep_alive)] * clients) )
+        return total / duration
+    finally:
+        proc.send_signal(signal.SIGINT)
+        proc.wait()
+        os.remove(conf_path)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Benchmark Mercury config variants")
+    parser.add_argument("scenario", choices=SCENARIOS.keys())
+    parser.add_argument("--duration", type=float, default=5, help="seconds per variant")
+    parser.add_argument("--clients", type=int, default=8, help="concurrent client connections")
+    args = parser.parse_args()
+
+    if sys.platform != "linux":
+        print("[Error] Benchmarks are only supported on Linux, exiting...")
+        exit(1)
+
+    # CD into script directory
+    os.chdir( os.path.dirname( os.path.abspath(__file__) ) )
+
+    scenario = SCENARIOS[args.scenario]
+    print(f"{scenario['desc']} (GET {scenario['path']}, {args.clients} clients, {args.duration}s each)")
+
+    baseline = None
+    for label, overrides in scenario["variants"]:
+        rps = run_variant(overrides, scenario["path"], scenario.get("keep_alive", True), args.duration, args.clients)
+        baseline = baseline if baseline is not None else rps
+        print(f"  {label:<16} {rps:>10.1f} req/s ({rps / baseline * 100:.0f}%)")
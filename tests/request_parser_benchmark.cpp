@@ -0,0 +1,149 @@
+/*
+
+Author: Travis Heavener (https://github.com/travis-heavener/)
+
+This file benchmarks the incremental RequestParser against the previous
+  framing path, which re-scanned the buffer from the start after every read
+  & copied every header into an upper-cased std::string map.
+
+Build & run: make benchmark_request_parser && ./bin/benchmark_request_parser [iterations]
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/http/request_parser.hpp"
+#include "../src/util/string_tools.hpp"
+
+// The previous header storage & loader, kept as a baseline
+typedef std::unordered_map<std::string, std::string> legacy_headers_map_t;
+static void loadEarlyHeaders(legacy_headers_map_t& headers, const std::string& raw) {
+    std::string line;
+    size_t startIndex = 0;
+    readLine(raw, line, startIndex);
+
+    while (readLine(raw, line, startIndex)) {
+        if (line.size() <= 1) break;
+        if (line.back() != '\r') throw 0;
+        line.pop_back();
+
+        size_t firstSpaceIndex = line.find(": ");
+        if (firstSpaceIndex != std::string::npos) {
+            std::string key = line.substr(0, firstSpaceIndex);
+            std::string value = line.substr(firstSpaceIndex+2);
+            strToUpper(key);
+
+            if ((key == "ACCEPT" && headers.contains("ACCEPT")) ||
+                (key == "ACCEPT-ENCODING" && headers.contains("ACCEPT-ENCODING"))) {
+                headers[key].append(',' + value);
+            } else if (key == "RANGE" && headers.contains("RANGE")) {
+                size_t bytesEnd = value.find('=');
+                if (bytesEnd != std::string::npos && bytesEnd + 1 < value.length())
+                    headers[key].append(',' + value.substr(bytesEnd+1) );
+            } else {
+                headers.insert({key, value});
+            }
+        }
+    }
+}
+
+// Frames & splits a request the way the previous path did, returns the body size
+static size_t parseBaseline(const std::string& request, const size_t chunkSize) {
+    std::string buffer;
+    legacy_headers_map_t headers;
+    size_t requestSize = std::string::npos;
+
+    for (size_t i = 0; i < request.size() && buffer.size() != requestSize; i += chunkSize) {
+        buffer.append(request, i, chunkSize);
+
+        if (requestSize == std::string::npos) {
+            const size_t headersEnd = buffer.find("\r\n\r\n");
+            if (headersEnd == std::string::npos) continue;
+
+            loadEarlyHeaders(headers, buffer);
+            const size_t contentLength = headers.contains("CONTENT-LENGTH") ? std::stoull(headers["CONTENT-LENGTH"]) : 0;
+            requestSize = headersEnd + 4 + contentLength;
+        }
+    }
+
+    // Request::Request re-read the request line & searched for the body again
+    std::string line;
+    size_t startIndex = 0;
+    readLine(buffer, line, startIndex);
+    std::string body(buffer);
+    body.erase(0, buffer.find("\r\n\r\n") + 4);
+    return body.size() + line.size();
+}
+
+static size_t parseIncremental(const std::string& request, const size_t chunkSize) {
+    std::string buffer;
+    http::headers_map_t headers;
+    http::RequestFlags reqFlags;
+    http::RequestParser parser(8192, 1 << 20);
+
+    int status = REQUEST_INCOMPLETE;
+    for (size_t i = 0; i < request.size() && status == REQUEST_INCOMPLETE; i += chunkSize) {
+        buffer.append(request, i, chunkSize);
+        status = parser.parse(buffer, headers, reqFlags);
+    }
+
+    const std::string body = buffer.substr(parser.getHeadersEnd());
+    return body.size() + parser.getMethod(buffer).size();
+}
+
+// Returns requests/sec
+static double run(const std::function<size_t(const std::string&, const size_t)>& parse, const std::string& request,
+                  const size_t chunkSize, const size_t iterations) {
+    size_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += parse(request, chunkSize);
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (sink == 0) std::printf(" "); // Keep the work from being optimized out
+    return static_cast<double>(iterations) / elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    const size_t iterations = argc > 1 ? std::stoul(argv[1]) : 20000;
+
+    std::string browser =
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+        "Connection: keep-alive\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "Sec-Fetch-Dest: document\r\n"
+        "Sec-Fetch-Mode: navigate\r\n"
+        "Sec-Fetch-Site: none\r\n"
+        "Sec-Fetch-User: ?1\r\n"
+        "Priority: u=0, i\r\n"
+        "\r\n";
+
+    std::string largeHeaders = "POST /form HTTP/1.1\r\nHost: localhost\r\nContent-Length: 64\r\n";
+    for (int i = 0; i < 64; ++i)
+        largeHeaders += "X-Header-" + std::to_string(i) + ": " + std::string(96, 'a') + "\r\n";
+    largeHeaders += "\r\n" + std::string(64, 'b');
+
+    std::printf("%zu iterations (requests/sec)\n", iterations);
+    std::printf("%-14s %8s  %12s %12s\n", "request", "chunk", "baseline", "incremental");
+
+    const std::pair<const char*, const std::string*> requests[] = { {"browser", &browser}, {"large headers", &largeHeaders} };
+    for (const auto& [name, pRequest] : requests) {
+        for (const size_t chunkSize : { static_cast<size_t>(16384), static_cast<size_t>(512), static_cast<size_t>(64) }) {
+            const double baseline = run(parseBaseline, *pRequest, chunkSize, iterations);
+            const double incremental = run(parseIncremental, *pRequest, chunkSize, iterations);
+            std::printf("%-14s %8zu  %12.0f %12.0f\n", name, chunkSize, baseline, incremental);
+        }
+    }
+
+    return 0;
+}
@@ -20,7 +20,8 @@ def lprint(*args: list[any]):
 class TestCase:
     def __init__(self, method: str, path: str, expectedStatus: int, version: str,
                  headers: dict=None, expected_headers: dict=None,
-                 body: str="", body_match: str=None, body_contains_mode: bool=False, https_only=False):
+                 body: str="", body_match: str=None, body_contains_mode: bool=False, https_only=False,
+                 pipelined: int=1):
         self.method = method
         self.path = path
         self.body = body
@@ -48,7 +49,8 @@ class TestCase:
 
         self.headers["USER-AGENT"] = "Mercury Test Agent"
 
-        if len(self.body) > 0:
+        # Chunked bodies are sent already framed
+        if len(self.body) > 0 and "TRANSFER-ENCODING" not in self.headers:
             self.headers["Content-Length"] = f"{len(self.body)}"
 
         # Format expected_headers
@@ -56,6 +58,7 @@ class TestCase:
         self.expected_headers = { k.upper(): v for k, v in expected_headers.items() }
 
         self.https_only = https_only
+        self.pipelined = pipelined
         self.body_match = body_match
         self.body_contains_mode = body_contains_mode
 
@@ -84,11 +87,24 @@ class TestCase:
         # Auto-pass for HTTPS only requests
         if self.https_only and "SSL" not in test_desc: return True
 
-        # Send payload
-        s.sendall(str(self).encode("utf-8"))
+        if self.pipelined > 1:
+            return self._test_pipelined(s, test_desc)
 
-        # Read response
-        raw = s.recv(READ_BUF_SIZE)
+        # Send payload, holding the body back until the server answers "Expect: 100-continue"
+        if self.headers.get("EXPECT", "").lower() == "100-continue" and len(self.body) > 0:
+            s.sendall(str(self)[:-len(self.body)].encode("utf-8"))
+            raw = s.recv(READ_BUF_SIZE)
+
+            # Otherwise the final response was sent right away
+            if raw.startswith(b"HTTP/1.1 100 "):
+                raw = raw.partition(b"\r\n\r\n")[2]
+                s.sendall(self.body.encode("utf-8"))
+                if len(raw) == 0: raw = s.recv(READ_BUF_SIZE)
+        else:
+            s.sendall(str(self).encode("utf-8"))
+
+            # Read response
+            raw = s.recv(READ_BUF_SIZE)
 
         if self.version == "HTTP/0.9":
             body = raw.decode("utf-8").replace("\r", "")
@@ -206,6 +222,47 @@ class TestCase:
             s += self.body
             return s
 
+    # Sends the request several times in a single write and verifies each response, in order
+    def _test_pipelined(self, s: socket.socket, test_desc: str) -> bool:
+        s.sendall(str(self).encode("utf-8") * self.pipelined)
+
+        buf = b""
+        for i in range(self.pipelined):
+            # Read status line & headers
+            while b"\r\n\r\n" not in buf:
+                chunk = s.recv(READ_BUF_SIZE)
+                if len(chunk) == 0:
+                    lprint(f"Failed {test_desc}: Connection closed after {i}/{self.pipelined} pipelined responses\n", self.inline_desc())
+                    return False
+                buf += chunk
+
+            head, _, buf = buf.partition(b"\r\n\r\n")
+            status_code = int(head.split(b" ")[1])
+            if status_code != self.expected_status:
+                lprint(
+                    f"Failed {test_desc}: Status mismatch on pipelined response {i+1} - expected {self.expected_status}, got {status_code}\n",
+                    self.inline_desc()
+                )
+                return False
+
+            # Skip body
+            headers = {}
+            for line in head.decode("utf-8").split("\r\n")[1:]:
+                key, _, value = line.partition(":")
+                headers[ key.strip().upper() ] = value.strip()
+
+            if self.method == "HEAD": continue
+
+            body, success = read_body(s, headers, b"\r\n\r\n" + buf)
+            if not success:
+                lprint(f"Failed {test_desc}: Connection timed out reading pipelined response {i+1}\n", self.inline_desc())
+                return False
+
+            # Keep any bytes of the next response (only Content-Length bodies can overrun)
+            buf = body[ int(headers["CONTENT-LENGTH"]): ] if "CONTENT-LENGTH" in headers else b""
+
+        return True
+
     # Verify a file is decoded properly
     def _verify_decode(self, path: str, body: str, enc: str) -> bool:
         orig_body = None
@@ -303,7 +360,8 @@ def load_runs() -> list[TestCase]:
                             body=case["body"] if "body" in case else "",
                             body_match=case["expectedBody"] if "expectedBody" in case else None,
                             body_contains_mode=case["expectedBodyContainsMode"] if "expectedBodyContainsMode" in case else False,
-                            https_only=case["httpsOnly"] if "httpsOnly" in case else False
+                            https_only=case["httpsOnly"] if "httpsOnly" in case else False,
+                            pipelined=case["pipelined"] if "pipelined" in case else 1
                         )
                     )
 
@@ -0,0 +1,85 @@
+/*
+
+Author: Travis Heavener (https://github.com/travis-heavener/)
+
+This file benchmarks the ThreadPool scheduler by measuring tasks/sec at 1-64
+  worker threads, for tasks enqueued from outside the pool & from its workers.
+
+Build & run: make benchmark_thread_pool && ./bin/benchmark_thread_pool [tasks] [work]
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <latch>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/util/thread_pool.hpp"
+
+// Simulates a small amount of per-task work
+static std::atomic<unsigned long> sink{0};
+static void spin(const unsigned int work) {
+    unsigned long x = 0;
+    for (unsigned int i = 0; i < work; ++i)
+        x = x * 31 + i;
+    sink += x;
+}
+
+// Enqueues every task from this thread, like an accept loop, returns tasks/sec
+static double runInjected(ThreadPool& pool, const size_t numTasks, const unsigned int work) {
+    std::latch done(static_cast<std::ptrdiff_t>(numTasks));
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numTasks; ++i)
+        pool.enqueue([&done, work] { spin(work); done.count_down(); });
+    done.wait();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(numTasks) / elapsed.count();
+}
+
+// Each injected task fans out into more tasks from inside the pool, returns tasks/sec
+static double runFanOut(ThreadPool& pool, const size_t numTasks, const unsigned int work) {
+    constexpr size_t FAN_OUT = 16;
+    const size_t numRoots = (std::max)(numTasks / (FAN_OUT + 1), static_cast<size_t>(1));
+    std::latch done(static_cast<std::ptrdiff_t>(numRoots * (FAN_OUT + 1)));
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numRoots; ++i) {
+        pool.enqueue([&pool, &done, work] {
+            for (size_t j = 0; j < FAN_OUT; ++j)
+                pool.enqueue([&done, work] { spin(work); done.count_down(); });
+            spin(work);
+            done.count_down();
+        });
+    }
+    done.wait();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(numRoots * (FAN_OUT + 1)) / elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    const size_t numTasks = argc > 1 ? std::stoul(argv[1]) : 200000;
+    const unsigned int work = argc > 2 ? static_cast<unsigned int>(std::stoul(argv[2])) : 200;
+
+    std::printf("%zu tasks, %u work units each (tasks/sec)\n", numTasks, work);
+    std::printf("%8s  %14s %14s\n", "threads", "injected", "fan-out");
+
+    for (size_t numThreads = 1; numThreads <= 64; numThreads *= 2) {
+        // No temporary threads so each row uses exactly numThreads
+        ThreadPool pool(numThreads, numThreads);
+        const double injected = runInjected(pool, numTasks, work);
+        const double fanOut = runFanOut(pool, numTasks, work);
+
+        std::printf("%8zu  %14.0f %14.0f\n", numThreads, injected, fanOut);
+    }
+
+    return 0;
+}
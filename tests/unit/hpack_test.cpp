@@ -0,0 +1,279 @@
+#include <string>
+#include <string_view>
+
+#include "unit_test.hpp"
+#include "../../src/http/http2/hpack.hpp"
+
+using namespace http::http2;
+
+// Turns a hex dump (whitespace ignored) into bytes
+static std::string fromHex(const std::string_view hex) {
+    std::string out;
+    int nibble = -1;
+    for (const char c : hex) {
+        if (c == ' ') continue;
+        const int value = c <= '9' ? c - '0' : c - 'a' + 10;
+        if (nibble < 0) {
+            nibble = value;
+        } else {
+            out.push_back(static_cast<char>((nibble << 4) | value));
+            nibble = -1;
+        }
+    }
+    return out;
+}
+
+static bool decodeBlock(HPACKDecoder& decoder, const std::string& block, header_list_t& headers) {
+    headers.clear();
+    return decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), headers);
+}
+
+/************************** Integers **************************/
+
+// RFC 7541 C.1
+TEST(IntegerEncodingVectors) {
+    std::string out;
+    encodeInteger(out, 0x00, 5, 10);
+    CHECK(out == fromHex("0a"));
+
+    out.clear();
+    encodeInteger(out, 0x00, 5, 1337);
+    CHECK(out == fromHex("1f9a0a"));
+
+    out.clear();
+    encodeInteger(out, 0x00, 8, 42);
+    CHECK(out == fromHex("2a"));
+}
+
+TEST(IntegerRoundTrip) {
+    const size_t values[] = { 0, 1, 30, 31, 32, 126, 127, 128, 255, 256, 1337, 4096, 65535, 1u << 20, (1u << 28) - 1 };
+    for (int prefixBits = 1; prefixBits <= 8; ++prefixBits) {
+        for (const size_t value : values) {
+            std::string out;
+            encodeInteger(out, 0x00, prefixBits, value);
+
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(out.data());
+            const uint8_t* pEnd = p + out.size();
+            size_t decoded = 0;
+            CHECK(decodeInteger(p, pEnd, prefixBits, decoded));
+            CHECK(decoded == value);
+            CHECK(p == pEnd);
+        }
+    }
+}
+
+TEST(IntegerFlagsArePreserved) {
+    std::string out;
+    encodeInteger(out, 0x40, 6, 100);
+    CHECK((static_cast<uint8_t>(out[0]) & 0xc0) == 0x40);
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(out.data());
+    size_t value = 0;
+    CHECK(decodeInteger(p, p + out.size(), 6, value) && value == 100);
+}
+
+TEST(IntegerMalformed) {
+    size_t value;
+
+    // Truncated continuation
+    const std::string truncated = fromHex("1f9a");
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(truncated.data());
+    CHECK(!decodeInteger(p, p + truncated.size(), 5, value));
+
+    // Too many continuation bytes
+    const std::string overflow = fromHex("1fffffffffff01");
+    p = reinterpret_cast<const uint8_t*>(overflow.data());
+    CHECK(!decodeInteger(p, p + overflow.size(), 5, value));
+
+    // Empty input
+    CHECK(!decodeInteger(p, p, 5, value));
+}
+
+/************************** Strings & Huffman **************************/
+
+// RFC 7541 C.4.1's authority, which is shorter once Huffman-encoded
+TEST(HuffmanEncodingVector) {
+    std::string out;
+    encodeString(out, 0x00, 7, "www.example.com");
+    CHECK(out == fromHex("8cf1e3c2e5f23a6ba0ab90f4ff"));
+}
+
+TEST(StringRoundTrip) {
+    std::string allOctets;
+    for (int c = 0; c < 256; ++c)
+        allOctets.push_back(static_cast<char>(c));
+
+    const std::string values[] = { "", "a", "no-cache", "custom-value", "Mon, 21 Oct 2013 20:13:21 GMT", allOctets, std::string(1000, 'z') };
+    for (const std::string& value : values) {
+        std::string out;
+        encodeString(out, 0x00, 7, value);
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(out.data());
+        const uint8_t* pEnd = p + out.size();
+        std::string decoded;
+        CHECK(decodeString(p, pEnd, 7, decoded));
+        CHECK(decoded == value);
+        CHECK(p == pEnd);
+    }
+}
+
+TEST(HuffmanMalformed) {
+    std::string decoded;
+
+    // 'a' (00011) padded w/ the start of EOS, then w/ zeros instead
+    const std::string valid = fromHex("811f");
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(valid.data());
+    CHECK(decodeString(p, p + valid.size(), 7, decoded) && decoded == "a");
+
+    const std::string badPadding = fromHex("8118");
+    p = reinterpret_cast<const uint8_t*>(badPadding.data());
+    decoded.clear();
+    CHECK(!decodeString(p, p + badPadding.size(), 7, decoded));
+
+    // Padding longer than 7 bits
+    const std::string longPadding = fromHex("82ffff");
+    p = reinterpret_cast<const uint8_t*>(longPadding.data());
+    decoded.clear();
+    CHECK(!decodeString(p, p + longPadding.size(), 7, decoded));
+
+    // An encoded EOS
+    const std::string eos = fromHex("84ffffffff");
+    p = reinterpret_cast<const uint8_t*>(eos.data());
+    decoded.clear();
+    CHECK(!decodeString(p, p + eos.size(), 7, decoded));
+
+    // Length past the end of the input
+    const std::string truncated = fromHex("0a6162");
+    p = reinterpret_cast<const uint8_t*>(truncated.data());
+    decoded.clear();
+    CHECK(!decodeString(p, p + truncated.size(), 7, decoded));
+}
+
+/************************** Decoder **************************/
+
+// RFC 7541 C.3, requests w/o Huffman sharing one dynamic table
+TEST(DecoderRequestVectors) {
+    HPACKDecoder decoder(HPACK_DEFAULT_TABLE_SIZE);
+    header_list_t headers;
+
+    CHECK(decodeBlock(decoder, fromHex("828684410f7777772e6578616d706c652e636f6d"), headers));
+    CHECK(headers == header_list_t({ {":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"} }));
+
+    CHECK(decodeBlock(decoder, fromHex("828684be58086e6f2d6361636865"), headers));
+    CHECK(headers == header_list_t({ {":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"},
+        {"cache-control", "no-cache"} }));
+
+    CHECK(decodeBlock(decoder, fromHex("828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565"), headers));
+    CHECK(headers == header_list_t({ {":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"},
+        {"custom-key", "custom-value"} }));
+}
+
+// RFC 7541 C.4, the same requests w/ Huffman
+TEST(DecoderHuffmanRequestVectors) {
+    HPACKDecoder decoder(HPACK_DEFAULT_TABLE_SIZE);
+    header_list_t headers;
+
+    CHECK(decodeBlock(decoder, fromHex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), headers));
+    CHECK(headers == header_list_t({ {":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"} }));
+
+    CHECK(decodeBlock(decoder, fromHex("828684be5886a8eb10649cbf"), headers));
+    CHECK(headers == header_list_t({ {":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"},
+        {"cache-control", "no-cache"} }));
+
+    CHECK(decodeBlock(decoder, fromHex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"), headers));
+    CHECK(headers == header_list_t({ {":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"},
+        {"custom-key", "custom-value"} }));
+}
+
+// RFC 7541 C.6, responses w/ Huffman & a 256 byte table, so entries get evicted
+TEST(DecoderEvictionVectors) {
+    HPACKDecoder decoder(256);
+    header_list_t headers;
+
+    CHECK(decodeBlock(decoder, fromHex(
+        "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3"), headers));
+    CHECK(headers == header_list_t({ {":status", "302"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+        {"location", "https://www.example.com"} }));
+
+    CHECK(decodeBlock(decoder, fromHex("4883640effc1c0bf"), headers));
+    CHECK(headers == header_list_t({ {":status", "307"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+        {"location", "https://www.example.com"} }));
+
+    CHECK(decodeBlock(decoder, fromHex(
+        "88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007"), headers));
+    CHECK(headers == header_list_t({ {":status", "200"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:22 GMT"},
+        {"location", "https://www.example.com"}, {"content-encoding", "gzip"},
+        {"set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"} }));
+}
+
+TEST(DecoderMalformed) {
+    header_list_t headers;
+
+    // Index 0, & an index past the (empty) dynamic table
+    HPACKDecoder decoder(HPACK_DEFAULT_TABLE_SIZE);
+    CHECK(!decodeBlock(decoder, fromHex("80"), headers));
+    CHECK(!decodeBlock(decoder, fromHex("be"), headers));
+
+    // A table size update larger than the advertised size
+    std::string block;
+    encodeInteger(block, 0x20, 5, HPACK_DEFAULT_TABLE_SIZE + 1);
+    CHECK(!decodeBlock(decoder, block, headers));
+
+    // A table size update after a field
+    CHECK(!decodeBlock(decoder, fromHex("8220"), headers));
+
+    // A literal cut off before its value
+    CHECK(!decodeBlock(decoder, fromHex("4003666f6f"), headers));
+}
+
+/************************** Encoder **************************/
+
+TEST(EncoderRoundTrip) {
+    HPACKEncoder encoder;
+    HPACKDecoder decoder(HPACK_DEFAULT_TABLE_SIZE);
+
+    const header_list_t responses[] = {
+        { {":status", "200"}, {"content-type", "text/html"}, {"content-length", "1234"}, {"server", "Mercury"} },
+        { {":status", "200"}, {"content-type", "text/html"}, {"content-length", "99"}, {"server", "Mercury"} },
+        { {":status", "404"}, {"content-type", "text/plain"}, {"x-custom", std::string(300, 'x')}, {"server", "Mercury"} }
+    };
+
+    size_t previousSize = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        std::string block;
+        encoder.encode(responses[i], block);
+
+        header_list_t headers;
+        CHECK(decodeBlock(decoder, block, headers));
+        CHECK(headers == responses[i]);
+
+        // The repeated response should mostly be table references
+        if (i == 1) CHECK(block.size() < previousSize);
+        previousSize = block.size();
+    }
+}
+
+TEST(EncoderTableSizeUpdate) {
+    HPACKEncoder encoder;
+    HPACKDecoder decoder(HPACK_DEFAULT_TABLE_SIZE);
+    const header_list_t fields = { {":status", "200"}, {"server", "Mercury"} };
+
+    std::string block;
+    encoder.encode(fields, block);
+    header_list_t headers;
+    CHECK(decodeBlock(decoder, block, headers) && headers == fields);
+
+    // Shrinking then growing the table announces both sizes, smallest first, before any field
+    encoder.setMaxTableSize(0);
+    encoder.setMaxTableSize(1024);
+    block.clear();
+    encoder.encode(fields, block);
+    CHECK(block.size() >= 2 && static_cast<uint8_t>(block[0]) == 0x20);
+    CHECK(decodeBlock(decoder, block, headers) && headers == fields);
+
+    // Nothing is announced once it's settled
+    block.clear();
+    encoder.encode(fields, block);
+    CHECK((static_cast<uint8_t>(block[0]) & 0xe0) != 0x20);
+    CHECK(decodeBlock(decoder, block, headers) && headers == fields);
+}
@@ -0,0 +1,389 @@
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "unit_test.hpp"
+#include "../../src/conf/conf.hpp"
+#include "../../src/http/http2/session.hpp"
+
+using namespace http::http2;
+
+typedef struct {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t streamId;
+    std::string payload;
+} frame_t;
+
+static std::string uint32ToBytes(const uint32_t value) {
+    return { static_cast<char>(value >> 24), static_cast<char>(value >> 16), static_cast<char>(value >> 8), static_cast<char>(value) };
+}
+
+static std::string makeFrame(const uint8_t type, const uint8_t flags, const uint32_t streamId, const std::string_view payload) {
+    std::string frame = { static_cast<char>(payload.size() >> 16), static_cast<char>(payload.size() >> 8),
+        static_cast<char>(payload.size()), static_cast<char>(type), static_cast<char>(flags) };
+    return frame.append(uint32ToBytes(streamId)).append(payload);
+}
+
+static std::string makeRequest(HPACKEncoder& encoder, const uint32_t streamId, const uint8_t flags, const header_list_t& extraFields={}) {
+    header_list_t fields = { {":method", "GET"}, {":scheme", "https"}, {":path", "/"}, {":authority", "localhost"} };
+    fields.insert(fields.end(), extraFields.begin(), extraFields.end());
+
+    std::string block;
+    encoder.encode(fields, block);
+    return makeFrame(FRAME_HEADERS, flags | HTTP2_FLAG_END_HEADERS, streamId, block);
+}
+
+static bool send(Session& session, const std::string& bytes) {
+    return session.receive(bytes.data(), bytes.size());
+}
+
+// Sends the client preface & SETTINGS, & drops the server's preface from the output
+static void startSession(Session& session) {
+    CHECK(send(session, std::string(HTTP2_PREFACE) + makeFrame(FRAME_SETTINGS, 0, 0, "")));
+    session.getOutput().clear();
+}
+
+static std::vector<frame_t> takeFrames(Session& session) {
+    std::vector<frame_t> frames;
+    const std::string& out = session.getOutput();
+    for (size_t i = 0; i + HTTP2_FRAME_HEADER_SIZE <= out.size();) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(out.data()) + i;
+        const size_t length = (static_cast<size_t>(p[0]) << 16) | (static_cast<size_t>(p[1]) << 8) | p[2];
+        const uint32_t streamId = ((static_cast<uint32_t>(p[5]) << 24) | (p[6] << 16) | (p[7] << 8) | p[8]) & HTTP2_MAX_WINDOW_SIZE;
+        frames.push_back({ p[3], p[4], streamId, out.substr(i + HTTP2_FRAME_HEADER_SIZE, length) });
+        i += HTTP2_FRAME_HEADER_SIZE + length;
+    }
+    session.getOutput().clear();
+    return frames;
+}
+
+static uint32_t bytesToUint32(const std::string& s, const size_t offset) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(s[offset])) << 24) | (static_cast<uint8_t>(s[offset + 1]) << 16) |
+        (static_cast<uint8_t>(s[offset + 2]) << 8) | static_cast<uint8_t>(s[offset + 3]);
+}
+
+// Returns the error code of the GOAWAY sent, or -1 if there wasn't one
+static int64_t takeGoAwayError(Session& session) {
+    for (const frame_t& frame : takeFrames(session))
+        if (frame.type == FRAME_GOAWAY && frame.payload.size() == 8)
+            return bytesToUint32(frame.payload, 4);
+    return -1;
+}
+
+// Returns the error code of the stream's RST_STREAM, or -1 if there wasn't one
+static int64_t takeResetError(Session& session, const uint32_t streamId) {
+    for (const frame_t& frame : takeFrames(session))
+        if (frame.type == FRAME_RST_STREAM && frame.streamId == streamId && frame.payload.size() == 4)
+            return bytesToUint32(frame.payload, 0);
+    return -1;
+}
+
+/************************** Preface & settings **************************/
+
+TEST(ServerPrefaceAndSettingsAck) {
+    Session session(100, 1024);
+    const std::vector<frame_t> preface = takeFrames(session);
+    CHECK(preface.size() == 1 && preface[0].type == FRAME_SETTINGS && preface[0].flags == 0);
+
+    CHECK(send(session, std::string(HTTP2_PREFACE) + makeFrame(FRAME_SETTINGS, 0, 0, "")));
+    const std::vector<frame_t> frames = takeFrames(session);
+    CHECK(frames.size() == 1 && frames[0].type == FRAME_SETTINGS && frames[0].flags == HTTP2_FLAG_ACK);
+}
+
+TEST(BadPreface) {
+    Session session(100, 1024);
+    CHECK(!send(session, "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    CHECK(takeGoAwayError(session) == H2_PROTOCOL_ERROR);
+    CHECK(session.isClosed());
+}
+
+TEST(FrameBeforeSettings) {
+    Session session(100, 1024);
+    CHECK(!send(session, std::string(HTTP2_PREFACE) + makeFrame(FRAME_PING, 0, 0, std::string(8, '\0'))));
+    CHECK(takeGoAwayError(session) == H2_PROTOCOL_ERROR);
+}
+
+TEST(SettingsErrors) {
+    Session badLength(100, 1024);
+    startSession(badLength);
+    CHECK(!send(badLength, makeFrame(FRAME_SETTINGS, 0, 0, std::string(5, '\0'))));
+    CHECK(takeGoAwayError(badLength) == H2_FRAME_SIZE_ERROR);
+
+    Session badWindow(100, 1024);
+    startSession(badWindow);
+    CHECK(!send(badWindow, makeFrame(FRAME_SETTINGS, 0, 0, std::string("\0\x04", 2) + uint32ToBytes(0x80000000))));
+    CHECK(takeGoAwayError(badWindow) == H2_FLOW_CONTROL_ERROR);
+
+    Session badFrameSize(100, 1024);
+    startSession(badFrameSize);
+    CHECK(!send(badFrameSize, makeFrame(FRAME_SETTINGS, 0, 0, std::string("\0\x05", 2) + uint32ToBytes(1024))));
+    CHECK(takeGoAwayError(badFrameSize) == H2_PROTOCOL_ERROR);
+}
+
+/************************** Framing **************************/
+
+TEST(PingIsEchoed) {
+    Session session(100, 1024);
+    startSession(session);
+    CHECK(send(session, makeFrame(FRAME_PING, 0, 0, "12345678")));
+
+    const std::vector<frame_t> frames = takeFrames(session);
+    CHECK(frames.size() == 1 && frames[0].type == FRAME_PING && frames[0].flags == HTTP2_FLAG_ACK && frames[0].payload == "12345678");
+}
+
+TEST(FramingErrors) {
+    Session oversized(100, 1024);
+    startSession(oversized);
+    CHECK(!send(oversized, makeFrame(FRAME_DATA, 0, 1, std::string(HTTP2_MIN_MAX_FRAME_SIZE + 1, 'x'))));
+    CHECK(takeGoAwayError(oversized) == H2_FRAME_SIZE_ERROR);
+
+    Session badPing(100, 1024);
+    startSession(badPing);
+    CHECK(!send(badPing, makeFrame(FRAME_PING, 0, 0, "1234567")));
+    CHECK(takeGoAwayError(badPing) == H2_FRAME_SIZE_ERROR);
+
+    Session pingOnStream(100, 1024);
+    startSession(pingOnStream);
+    CHECK(!send(pingOnStream, makeFrame(FRAME_PING, 0, 1, "12345678")));
+    CHECK(takeGoAwayError(pingOnStream) == H2_PROTOCOL_ERROR);
+
+    Session pushPromise(100, 1024);
+    startSession(pushPromise);
+    CHECK(!send(pushPromise, makeFrame(FRAME_PUSH_PROMISE, HTTP2_FLAG_END_HEADERS, 1, std::string(4, '\0'))));
+    CHECK(takeGoAwayError(pushPromise) == H2_PROTOCOL_ERROR);
+
+    Session evenStream(100, 1024);
+    HPACKEncoder encoder;
+    startSession(evenStream);
+    CHECK(!send(evenStream, makeRequest(encoder, 2, HTTP2_FLAG_END_STREAM)));
+    CHECK(takeGoAwayError(evenStream) == H2_PROTOCOL_ERROR);
+
+    Session idleData(100, 1024);
+    startSession(idleData);
+    CHECK(!send(idleData, makeFrame(FRAME_DATA, 0, 1, "x")));
+    CHECK(takeGoAwayError(idleData) == H2_PROTOCOL_ERROR);
+
+    Session badBlock(100, 1024);
+    startSession(badBlock);
+    CHECK(!send(badBlock, makeFrame(FRAME_HEADERS, HTTP2_FLAG_END_HEADERS | HTTP2_FLAG_END_STREAM, 1, "\x80")));
+    CHECK(takeGoAwayError(badBlock) == H2_COMPRESSION_ERROR);
+}
+
+TEST(HeaderBlockContinuation) {
+    Session session(100, 1024);
+    HPACKEncoder encoder;
+    startSession(session);
+
+    // A block split across HEADERS & CONTINUATION
+    const std::string frame = makeRequest(encoder, 1, HTTP2_FLAG_END_STREAM);
+    const std::string block = frame.substr(HTTP2_FRAME_HEADER_SIZE);
+    CHECK(send(session, makeFrame(FRAME_HEADERS, HTTP2_FLAG_END_STREAM, 1, block.substr(0, 3))));
+    CHECK(send(session, makeFrame(FRAME_CONTINUATION, HTTP2_FLAG_END_HEADERS, 1, block.substr(3))));
+
+    Stream* pStream = session.nextRequest();
+    CHECK(pStream != nullptr && pStream->id == 1 && pStream->isRemoteClosed);
+
+    // Nothing may come between them
+    Session interrupted(100, 1024);
+    startSession(interrupted);
+    CHECK(send(interrupted, makeFrame(FRAME_HEADERS, HTTP2_FLAG_END_STREAM, 1, block.substr(0, 3))));
+    CHECK(!send(interrupted, makeFrame(FRAME_PING, 0, 0, "12345678")));
+    CHECK(takeGoAwayError(interrupted) == H2_PROTOCOL_ERROR);
+
+    Session orphaned(100, 1024);
+    startSession(orphaned);
+    CHECK(!send(orphaned, makeFrame(FRAME_CONTINUATION, HTTP2_FLAG_END_HEADERS, 1, block)));
+    CHECK(takeGoAwayError(orphaned) == H2_PROTOCOL_ERROR);
+}
+
+TEST(MalformedRequests) {
+    Session session(100, 1024);
+    HPACKEncoder encoder;
+    startSession(session);
+
+    // A Content-Length that doesn't match the body
+    CHECK(send(session, makeRequest(encoder, 1, HTTP2_FLAG_END_STREAM, { {"content-length", "5"} })));
+    CHECK(takeResetError(session, 1) == H2_PROTOCOL_ERROR);
+
+    // Connection-specific fields
+    CHECK(send(session, makeRequest(encoder, 3, HTTP2_FLAG_END_STREAM, { {"connection", "keep-alive"} })));
+    CHECK(takeResetError(session, 3) == H2_PROTOCOL_ERROR);
+    CHECK(session.nextRequest() == nullptr);
+
+    // Reused stream ids
+    CHECK(!send(session, makeRequest(encoder, 1, HTTP2_FLAG_END_STREAM)));
+    CHECK(takeGoAwayError(session) == H2_STREAM_CLOSED);
+}
+
+// Shared w/ HTTP/3, values are compared as numbers
+TEST(ContentLengthMatch) {
+    CHECK(isContentLengthMatched({}, 5));
+    CHECK(isContentLengthMatched({ {"content-length", "5"} }, 5));
+    CHECK(isContentLengthMatched({ {"content-length", "05"}, {"content-length", "5"} }, 5));
+
+    CHECK(!isContentLengthMatched({ {"content-length", "6"} }, 5));
+    CHECK(!isContentLengthMatched({ {"content-length", "5"}, {"content-length", "6"} }, 5));
+    CHECK(!isContentLengthMatched({ {"content-length", ""} }, 0));
+    CHECK(!isContentLengthMatched({ {"content-length", "+5"} }, 5));
+    CHECK(!isContentLengthMatched({ {"content-length", "-0"} }, 0));
+    CHECK(!isContentLengthMatched({ {"content-length", "5 "} }, 5));
+    CHECK(!isContentLengthMatched({ {"content-length", "99999999999999999999999"} }, 5));
+}
+
+TEST(ConcurrentStreamLimit) {
+    Session session(2, 1024);
+    HPACKEncoder encoder;
+    startSession(session);
+
+    CHECK(send(session, makeRequest(encoder, 1, 0)));
+    CHECK(send(session, makeRequest(encoder, 3, 0)));
+    CHECK(send(session, makeRequest(encoder, 5, 0)));
+    CHECK(takeResetError(session, 5) == H2_REFUSED_STREAM);
+}
+
+/************************** Flow control **************************/
+
+TEST(WindowUpdateErrors) {
+    Session overflow(100, 1024);
+    startSession(overflow);
+    CHECK(!send(overflow, makeFrame(FRAME_WINDOW_UPDATE, 0, 0, uint32ToBytes(HTTP2_MAX_WINDOW_SIZE))));
+    CHECK(takeGoAwayError(overflow) == H2_FLOW_CONTROL_ERROR);
+
+    Session zero(100, 1024);
+    startSession(zero);
+    CHECK(!send(zero, makeFrame(FRAME_WINDOW_UPDATE, 0, 0, uint32ToBytes(0))));
+    CHECK(takeGoAwayError(zero) == H2_PROTOCOL_ERROR);
+
+    Session badLength(100, 1024);
+    startSession(badLength);
+    CHECK(!send(badLength, makeFrame(FRAME_WINDOW_UPDATE, 0, 0, "123")));
+    CHECK(takeGoAwayError(badLength) == H2_FRAME_SIZE_ERROR);
+
+    // Stream-level errors only reset the stream
+    Session stream(100, 1024);
+    HPACKEncoder encoder;
+    startSession(stream);
+    CHECK(send(stream, makeRequest(encoder, 1, 0)));
+    CHECK(send(stream, makeFrame(FRAME_WINDOW_UPDATE, 0, 1, uint32ToBytes(0))));
+    CHECK(takeResetError(stream, 1) == H2_PROTOCOL_ERROR);
+
+    CHECK(send(stream, makeRequest(encoder, 3, 0)));
+    CHECK(send(stream, makeFrame(FRAME_WINDOW_UPDATE, 0, 3, uint32ToBytes(HTTP2_MAX_WINDOW_SIZE))));
+    CHECK(takeResetError(stream, 3) == H2_FLOW_CONTROL_ERROR);
+}
+
+TEST(ReceiveWindowIsReplenished) {
+    conf::REQUEST_BODY_MEMORY_LIMIT = 1 << 20; // Keep the body in memory
+    Session session(100, 1 << 20);
+    HPACKEncoder encoder;
+    startSession(session);
+    CHECK(send(session, makeRequest(encoder, 1, 0)));
+
+    // More than a whole default window, which only fits if WINDOW_UPDATEs are sent along the way
+    const std::string data(HTTP2_MIN_MAX_FRAME_SIZE, 'x');
+    bool hasConnUpdate = false, hasStreamUpdate = false;
+    for (int i = 0; i < 8; ++i) {
+        CHECK(send(session, makeFrame(FRAME_DATA, 0, 1, data)));
+        for (const frame_t& frame : takeFrames(session)) {
+            hasConnUpdate |= frame.type == FRAME_WINDOW_UPDATE && frame.streamId == 0;
+            hasStreamUpdate |= frame.type == FRAME_WINDOW_UPDATE && frame.streamId == 1;
+            CHECK(frame.type != FRAME_RST_STREAM && frame.type != FRAME_GOAWAY);
+        }
+    }
+    CHECK(hasConnUpdate && hasStreamUpdate);
+}
+
+TEST(StreamReceiveWindowExceeded) {
+    // Once the body is too large the stream's window is no longer replenished
+    Session session(100, 0);
+    HPACKEncoder encoder;
+    startSession(session);
+    CHECK(send(session, makeRequest(encoder, 1, 0)));
+
+    const std::string data(HTTP2_MIN_MAX_FRAME_SIZE, 'x');
+    CHECK(send(session, makeFrame(FRAME_DATA, 0, 1, "x")));
+    for (int i = 0; i < 3; ++i)
+        CHECK(send(session, makeFrame(FRAME_DATA, 0, 1, data)));
+    CHECK(takeResetError(session, 1) == -1);
+
+    CHECK(send(session, makeFrame(FRAME_DATA, 0, 1, data)));
+    CHECK(takeResetError(session, 1) == H2_FLOW_CONTROL_ERROR);
+}
+
+TEST(PaddingErrors) {
+    Session session(100, 1024);
+    HPACKEncoder encoder;
+    startSession(session);
+    CHECK(send(session, makeRequest(encoder, 1, 0)));
+
+    // Padding as long as the frame itself
+    CHECK(!send(session, makeFrame(FRAME_DATA, HTTP2_FLAG_PADDED, 1, std::string("\x03xx", 3))));
+    CHECK(takeGoAwayError(session) == H2_PROTOCOL_ERROR);
+}
+
+/************************** Resets **************************/
+
+TEST(ResetStreamErrors) {
+    Session streamZero(100, 1024);
+    startSession(streamZero);
+    CHECK(!send(streamZero, makeFrame(FRAME_RST_STREAM, 0, 0, uint32ToBytes(H2_NO_ERROR))));
+    CHECK(takeGoAwayError(streamZero) == H2_PROTOCOL_ERROR);
+
+    Session idle(100, 1024);
+    startSession(idle);
+    CHECK(!send(idle, makeFrame(FRAME_RST_STREAM, 0, 1, uint32ToBytes(H2_NO_ERROR))));
+    CHECK(takeGoAwayError(idle) == H2_PROTOCOL_ERROR);
+
+    Session badLength(100, 1024);
+    HPACKEncoder encoder;
+    startSession(badLength);
+    CHECK(send(badLength, makeRequest(encoder, 1, 0)));
+    CHECK(!send(badLength, makeFrame(FRAME_RST_STREAM, 0, 1, "123")));
+    CHECK(takeGoAwayError(badLength) == H2_FRAME_SIZE_ERROR);
+}
+
+TEST(ResetStreamIsSkipped) {
+    Session session(100, 1024);
+    HPACKEncoder encoder;
+    startSession(session);
+
+    CHECK(send(session, makeRequest(encoder, 1, HTTP2_FLAG_END_STREAM)));
+    CHECK(send(session, makeRequest(encoder, 3, HTTP2_FLAG_END_STREAM)));
+    CHECK(send(session, makeFrame(FRAME_RST_STREAM, 0, 1, uint32ToBytes(H2_CANCEL))));
+
+    Stream* pStream = session.nextRequest();
+    CHECK(pStream != nullptr && pStream->id == 3);
+    CHECK(session.nextRequest() == nullptr);
+}
+
+// Opening & immediately cancelling streams never hits the concurrency limit, so resets are capped separately (CVE-2023-44487)
+TEST(RapidReset) {
+    Session session(100, 1024);
+    HPACKEncoder encoder;
+    startSession(session);
+
+    uint32_t streamId = 1;
+    for (int i = 0; i < HTTP2_MAX_CLIENT_RESETS; ++i, streamId += 2) {
+        CHECK(send(session, makeRequest(encoder, streamId, HTTP2_FLAG_END_STREAM) +
+            makeFrame(FRAME_RST_STREAM, 0, streamId, uint32ToBytes(H2_CANCEL))));
+    }
+    CHECK(takeGoAwayError(session) == -1);
+
+    CHECK(!send(session, makeRequest(encoder, streamId, HTTP2_FLAG_END_STREAM) +
+        makeFrame(FRAME_RST_STREAM, 0, streamId, uint32ToBytes(H2_CANCEL))));
+    CHECK(takeGoAwayError(session) == H2_ENHANCE_YOUR_CALM);
+    CHECK(session.isClosed());
+}
+
+TEST(ResetOfClosedStreamIsFree) {
+    Session session(100, 1024);
+    HPACKEncoder encoder;
+    startSession(session);
+
+    // Streams the server already closed cost nothing to reset, so they don't count
+    CHECK(send(session, makeRequest(encoder, 1, HTTP2_FLAG_END_STREAM, { {"content-length", "5"} })));
+    for (int i = 0; i <= HTTP2_MAX_CLIENT_RESETS; ++i)
+        CHECK(send(session, makeFrame(FRAME_RST_STREAM, 0, 1, uint32ToBytes(H2_CANCEL))));
+    CHECK(takeGoAwayError(session) == -1);
+}
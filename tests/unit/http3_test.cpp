@@ -0,0 +1,278 @@
+#include <string>
+#include <string_view>
+
+#include "unit_test.hpp"
+#include "../../src/conf/conf.hpp"
+#include "../../src/http/http3/qpack.hpp"
+#include "../../src/http/http3/stream.hpp"
+
+using namespace http::http3;
+
+// Turns a hex dump (whitespace ignored) into bytes
+static std::string fromHex(const std::string_view hex) {
+    std::string out;
+    int nibble = -1;
+    for (const char c : hex) {
+        if (c == ' ') continue;
+        const int value = c <= '9' ? c - '0' : c - 'a' + 10;
+        if (nibble < 0) {
+            nibble = value;
+        } else {
+            out.push_back(static_cast<char>((nibble << 4) | value));
+            nibble = -1;
+        }
+    }
+    return out;
+}
+
+static bool decodeSection(const std::string& section, header_list_t& headers) {
+    headers.clear();
+    return QPACKDecoder::decode(reinterpret_cast<const uint8_t*>(section.data()), section.size(), headers);
+}
+
+static std::string makeFrame(const uint64_t type, const std::string_view payload) {
+    std::string frame;
+    appendVarint(frame, type);
+    appendVarint(frame, payload.size());
+    return frame.append(payload);
+}
+
+static std::string makeHeaders(const header_list_t& extraFields={}) {
+    header_list_t fields = { {":method", "POST"}, {":scheme", "https"}, {":path", "/upload"}, {":authority", "localhost"} };
+    fields.insert(fields.end(), extraFields.begin(), extraFields.end());
+
+    std::string section;
+    QPACKEncoder::encode(fields, section);
+    return makeFrame(FRAME_HEADERS, section);
+}
+
+static ERROR_CODE receive(RequestStream& stream, const std::string& bytes) {
+    return stream.receive(bytes.data(), bytes.size());
+}
+
+/************************** Varints **************************/
+
+// RFC 9000 A.1
+TEST(VarintVectors) {
+    const std::pair<std::string, uint64_t> vectors[] = {
+        { fromHex("c2197c5eff14e88c"), 151288809941952652ULL },
+        { fromHex("9d7f3e7d"), 494878333 },
+        { fromHex("7bbd"), 15293 },
+        { fromHex("25"), 37 }
+    };
+
+    for (const auto& [bytes, expected] : vectors) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(bytes.data());
+        const uint8_t* pEnd = p + bytes.size();
+        uint64_t value = 0;
+        CHECK(decodeVarint(p, pEnd, value) && value == expected && p == pEnd);
+
+        std::string out;
+        appendVarint(out, expected);
+        CHECK(out == bytes);
+    }
+
+    // Non-minimal encodings still decode
+    const std::string longForm = fromHex("4025");
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(longForm.data());
+    uint64_t value = 0;
+    CHECK(decodeVarint(p, p + longForm.size(), value) && value == 37);
+}
+
+TEST(VarintIncomplete) {
+    const std::string truncated = fromHex("c2197c5e");
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(truncated.data());
+    uint64_t value;
+    CHECK(!decodeVarint(p, p + truncated.size(), value));
+    CHECK(!decodeVarint(p, p, value));
+}
+
+TEST(ControlStreamPreface) {
+    std::string out;
+    writeControlStreamPreface(out);
+
+    // Stream type, then SETTINGS w/ only SETTINGS_MAX_FIELD_SECTION_SIZE
+    std::string settings;
+    appendVarint(settings, SETTINGS_MAX_FIELD_SECTION_SIZE);
+    appendVarint(settings, HTTP3_MAX_FIELD_SECTION_SIZE);
+    CHECK(out == std::string(1, STREAM_CONTROL) + makeFrame(FRAME_SETTINGS, settings));
+}
+
+/************************** QPACK **************************/
+
+// RFC 9204 B.1, a literal w/ a static name reference
+TEST(QPACKDecodeVector) {
+    header_list_t headers;
+    CHECK(decodeSection(fromHex("0000510b2f696e6465782e68746d6c"), headers));
+    CHECK(headers == header_list_t({ {":path", "/index.html"} }));
+}
+
+TEST(QPACKStaticTable) {
+    header_list_t headers;
+
+    // Indexed lines for ":method: GET" (17) & ":path: /" (1)
+    CHECK(decodeSection(fromHex("0000d1c1"), headers));
+    CHECK(headers == header_list_t({ {":method", "GET"}, {":path", "/"} }));
+
+    // Exact matches are encoded as indexed lines
+    std::string section;
+    QPACKEncoder::encode({ {":method", "GET"}, {":path", "/"} }, section);
+    CHECK(section == fromHex("0000d1c1"));
+}
+
+TEST(QPACKRoundTrip) {
+    const header_list_t fields = {
+        {":status", "200"}, {"content-type", "text/html; charset=utf-8"}, {"content-length", "1234"},
+        {"server", "Mercury"}, {"x-custom", std::string(300, 'x')}, {"set-cookie", "a=b; Path=/"}
+    };
+
+    std::string section;
+    QPACKEncoder::encode(fields, section);
+
+    header_list_t headers;
+    CHECK(decodeSection(section, headers));
+    CHECK(headers == fields);
+}
+
+TEST(QPACKMalformed) {
+    header_list_t headers;
+
+    // A Required Insert Count, which needs a dynamic table
+    CHECK(!decodeSection(fromHex("0100c1"), headers));
+
+    // Dynamic table references, indexed, by name & post-base
+    CHECK(!decodeSection(fromHex("000081"), headers));
+    CHECK(!decodeSection(fromHex("0000410161"), headers));
+    CHECK(!decodeSection(fromHex("000010"), headers));
+
+    // Past the end of the static table (99)
+    CHECK(!decodeSection(fromHex("0000ff24"), headers));
+
+    // A value cut off partway
+    CHECK(!decodeSection(fromHex("0000510b2f696e"), headers));
+
+    // A missing prefix
+    CHECK(!decodeSection("", headers));
+}
+
+/************************** Request streams **************************/
+
+TEST(RequestStreamBody) {
+    conf::REQUEST_BODY_MEMORY_LIMIT = 1 << 20; // Keep the body in memory
+
+    RequestStream stream(1024);
+    CHECK(receive(stream, makeHeaders({ {"content-length", "11"} })) == H3_NO_ERROR);
+    CHECK(receive(stream, makeFrame(FRAME_DATA, "hello ") + makeFrame(FRAME_DATA, "world")) == H3_NO_ERROR);
+    CHECK(!stream.isRequestDone());
+
+    CHECK(stream.finish() == H3_NO_ERROR);
+    CHECK(stream.isRequestDone());
+    CHECK(stream.bodySize == 11 && stream.body.size() == 11);
+
+    std::string raw;
+    stream.toHTTP1Request(raw);
+    CHECK(raw.rfind("POST /upload HTTP/1.1\r\n", 0) == 0);
+    CHECK(raw.find("host: localhost\r\n") != std::string::npos);
+    CHECK(raw.find("content-length: 11\r\n") != std::string::npos);
+}
+
+TEST(RequestStreamByteByByte) {
+    conf::REQUEST_BODY_MEMORY_LIMIT = 1 << 20;
+
+    // Frames split at every possible point, incl. inside varints
+    const std::string bytes = makeFrame(0x21, "grease") + makeHeaders() + makeFrame(FRAME_DATA, "body") + makeFrame(0x21, "");
+    RequestStream stream(1024);
+    for (const char c : bytes)
+        CHECK(stream.receive(&c, 1) == H3_NO_ERROR);
+
+    CHECK(stream.finish() == H3_NO_ERROR);
+    CHECK(stream.headers.size() == 4 && stream.bodySize == 4);
+}
+
+TEST(RequestStreamTooLarge) {
+    RequestStream stream(4);
+    CHECK(receive(stream, makeHeaders()) == H3_NO_ERROR);
+    CHECK(receive(stream, makeFrame(FRAME_DATA, "0123456789")) == H3_NO_ERROR);
+
+    // Answered early, w/ the body dropped
+    CHECK(stream.isRequestDone());
+    CHECK(stream.bodySize > 4 && stream.body.empty());
+    CHECK(receive(stream, makeFrame(FRAME_DATA, "more")) == H3_NO_ERROR);
+}
+
+TEST(RequestStreamTrailers) {
+    conf::REQUEST_BODY_MEMORY_LIMIT = 1 << 20;
+
+    std::string trailers;
+    QPACKEncoder::encode({ {"x-checksum", "1"} }, trailers);
+
+    RequestStream stream(1024);
+    CHECK(receive(stream, makeHeaders() + makeFrame(FRAME_DATA, "body") + makeFrame(FRAME_HEADERS, trailers)) == H3_NO_ERROR);
+    CHECK(stream.finish() == H3_NO_ERROR);
+    CHECK(stream.headers.size() == 4);
+
+    // Nothing may follow the trailers
+    RequestStream late(1024);
+    CHECK(receive(late, makeHeaders() + makeFrame(FRAME_HEADERS, trailers)) == H3_NO_ERROR);
+    CHECK(receive(late, makeFrame(FRAME_DATA, "body")) == H3_FRAME_UNEXPECTED);
+}
+
+TEST(RequestStreamFrameErrors) {
+    RequestStream dataFirst(1024);
+    CHECK(receive(dataFirst, makeFrame(FRAME_DATA, "body")) == H3_FRAME_UNEXPECTED);
+
+    // Control stream frames & HTTP/2 frame types aren't allowed on a request stream
+    const uint64_t forbiddenTypes[] = { FRAME_CANCEL_PUSH, FRAME_SETTINGS, FRAME_PUSH_PROMISE, FRAME_GOAWAY, FRAME_MAX_PUSH_ID, 0x2, 0x6, 0x8, 0x9 };
+    for (const uint64_t type : forbiddenTypes) {
+        RequestStream stream(1024);
+        CHECK(receive(stream, makeFrame(type, "")) == H3_FRAME_UNEXPECTED);
+    }
+
+    // The field section limit is checked before the frame arrives
+    std::string oversized;
+    appendVarint(oversized, FRAME_HEADERS);
+    appendVarint(oversized, HTTP3_MAX_FIELD_SECTION_SIZE + 1);
+    RequestStream tooLarge(1024);
+    CHECK(receive(tooLarge, oversized) == H3_EXCESSIVE_LOAD);
+
+    RequestStream badSection(1024);
+    CHECK(receive(badSection, makeFrame(FRAME_HEADERS, fromHex("0100c1"))) == H3_QPACK_DECOMPRESSION_FAILED);
+}
+
+TEST(RequestStreamMessageErrors) {
+    // Missing :method, & a connection-specific field
+    std::string section;
+    QPACKEncoder::encode({ {":scheme", "https"}, {":path", "/"} }, section);
+    RequestStream noMethod(1024);
+    CHECK(receive(noMethod, makeFrame(FRAME_HEADERS, section)) == H3_MESSAGE_ERROR);
+
+    RequestStream connectionField(1024);
+    CHECK(receive(connectionField, makeHeaders({ {"connection", "close"} })) == H3_MESSAGE_ERROR);
+
+    // A Content-Length that doesn't match the body
+    RequestStream mismatch(1024);
+    CHECK(receive(mismatch, makeHeaders({ {"content-length", "5"} })) == H3_NO_ERROR);
+    CHECK(mismatch.finish() == H3_MESSAGE_ERROR);
+
+    // Leading zeros still match
+    conf::REQUEST_BODY_MEMORY_LIMIT = 1 << 20;
+    RequestStream leadingZero(1024);
+    CHECK(receive(leadingZero, makeHeaders({ {"content-length", "05"} }) + makeFrame(FRAME_DATA, "hello")) == H3_NO_ERROR);
+    CHECK(leadingZero.finish() == H3_NO_ERROR);
+}
+
+TEST(RequestStreamEndedEarly) {
+    RequestStream noHeaders(1024);
+    CHECK(noHeaders.finish() == H3_REQUEST_INCOMPLETE);
+
+    // Ended partway through a DATA frame, & partway through a frame header
+    conf::REQUEST_BODY_MEMORY_LIMIT = 1 << 20;
+    RequestStream partialData(1024);
+    const std::string data = makeFrame(FRAME_DATA, "body");
+    CHECK(receive(partialData, makeHeaders() + data.substr(0, data.size() - 1)) == H3_NO_ERROR);
+    CHECK(partialData.finish() == H3_FRAME_ERROR);
+
+    RequestStream partialHeader(1024);
+    CHECK(receive(partialHeader, makeHeaders() + fromHex("00")) == H3_NO_ERROR);
+    CHECK(partialHeader.finish() == H3_FRAME_ERROR);
+}
@@ -0,0 +1,29 @@
+/*
+
+Author: Travis Heavener (https://github.com/travis-heavener/)
+
+Runs every unit test, for the internals the Python end-to-end tests can't pin down
+  (ie. exact encodings, error paths a real client never takes, or timing).
+
+Build & run: make unit_tests
+
+*/
+
+#include <cstdio>
+
+#include "unit_test.hpp"
+
+int main() {
+    size_t numFailedTests = 0;
+    for (const auto& [name, pFunc] : unit::getTests()) {
+        const int numFailedBefore = unit::numFailedChecks;
+        pFunc();
+
+        const bool isPassed = unit::numFailedChecks == numFailedBefore;
+        std::printf("%s %s\n", isPassed ? "[PASS]" : "[FAIL]", name);
+        if (!isPassed) ++numFailedTests;
+    }
+
+    std::printf("\n%zu/%zu tests passed\n", unit::getTests().size() - numFailedTests, unit::getTests().size());
+    return numFailedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <string>
+
+#include "unit_test.hpp"
+#include "../../src/util/rate_limiter.hpp"
+
+using namespace std::chrono_literals;
+
+// Takes tokens until the bucket is empty, returns how many were taken
+static int drain(RateLimiter& limiter, const std::string& key, const RateLimiter::time_point_t now) {
+    int numAcquired = 0;
+    while (numAcquired < 1000 && limiter.tryAcquire(key, now))
+        ++numAcquired;
+    return numAcquired;
+}
+
+TEST(RateLimiterBurst) {
+    RateLimiter limiter(1, 3);
+    const RateLimiter::time_point_t start = std::chrono::steady_clock::now();
+
+    // New clients start w/ a full bucket
+    CHECK(drain(limiter, "127.0.0.1", start) == 3);
+    CHECK(!limiter.tryAcquire("127.0.0.1", start + 999ms));
+}
+
+TEST(RateLimiterRefill) {
+    RateLimiter limiter(4, 2);
+    const RateLimiter::time_point_t start = std::chrono::steady_clock::now();
+    CHECK(drain(limiter, "127.0.0.1", start) == 2);
+
+    // A token every 250ms
+    CHECK(!limiter.tryAcquire("127.0.0.1", start + 200ms));
+    CHECK(limiter.tryAcquire("127.0.0.1", start + 300ms));
+    CHECK(!limiter.tryAcquire("127.0.0.1", start + 300ms));
+
+    // Partial tokens carry over between requests
+    CHECK(!limiter.tryAcquire("127.0.0.1", start + 400ms));
+    CHECK(limiter.tryAcquire("127.0.0.1", start + 600ms));
+}
+
+TEST(RateLimiterRefillIsCapped) {
+    RateLimiter limiter(10, 5);
+    const RateLimiter::time_point_t start = std::chrono::steady_clock::now();
+    CHECK(drain(limiter, "::1", start) == 5);
+
+    // A long idle period only refills up to the burst size
+    CHECK(drain(limiter, "::1", start + 1h) == 5);
+}
+
+TEST(RateLimiterKeysAreIndependent) {
+    RateLimiter limiter(1, 1);
+    const RateLimiter::time_point_t start = std::chrono::steady_clock::now();
+
+    CHECK(limiter.tryAcquire("127.0.0.1", start));
+    CHECK(!limiter.tryAcquire("127.0.0.1", start));
+    CHECK(limiter.tryAcquire("::1", start));
+    CHECK(limiter.tryAcquire("10.0.0.1", start));
+}
+
+TEST(RateLimiterIdleBucketsAreSwept) {
+    RateLimiter limiter(1, 2);
+    const RateLimiter::time_point_t start = std::chrono::steady_clock::now();
+    CHECK(drain(limiter, "127.0.0.1", start) == 2);
+
+    // Past the sweep, a dropped bucket is no different from a refilled one
+    CHECK(drain(limiter, "127.0.0.1", start + 30s) == 2);
+    CHECK(!limiter.tryAcquire("127.0.0.1", start + 30s));
+}
+
+TEST(RateLimiterRetryAfter) {
+    CHECK(RateLimiter(1, 1).getRetryAfter() == 1);
+    CHECK(RateLimiter(100, 1).getRetryAfter() == 1);
+
+    // A zero burst still lets one request through
+    RateLimiter limiter(1, 0);
+    const RateLimiter::time_point_t start = std::chrono::steady_clock::now();
+    CHECK(drain(limiter, "127.0.0.1", start) == 1);
+}
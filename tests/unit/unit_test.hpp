@@ -0,0 +1,42 @@
+#ifndef __TESTS_UNIT_UNIT_TEST_HPP
+#define __TESTS_UNIT_UNIT_TEST_HPP
+
+#include <cstdio>
+#include <vector>
+
+// A minimal harness for the unit tests, each TEST registers itself w/ the runner in main.cpp
+namespace unit {
+
+    typedef struct {
+        const char* name;
+        void (*pFunc)();
+    } test_case_t;
+
+    inline std::vector<test_case_t>& getTests() {
+        static std::vector<test_case_t> tests;
+        return tests;
+    }
+
+    inline int numFailedChecks = 0;
+
+    struct Registrar {
+        Registrar(const char* name, void (*pFunc)()) { getTests().push_back({ name, pFunc }); }
+    };
+
+}
+
+#define TEST(name) \
+    static void name(); \
+    static const unit::Registrar name##Registrar(#name, name); \
+    static void name()
+
+// Failed checks are reported but don't stop the test, so every failure in it shows up at once
+#define CHECK(expr) \
+    do { \
+        if (!(expr)) { \
+            ++unit::numFailedChecks; \
+            std::fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+        } \
+    } while (0)
+
+#endif